@@ -29,10 +29,14 @@ class Camera {
     bool firstMouse;
 
     const float CAMERA_SPEED = 2.5f;
+    // closest the camera gets to the ground, a few times the near plane
+    const float GROUND_CLEARANCE = 0.3f;
 
     Camera(glm::vec3 posIn, glm::vec3 upIn, int screenWidth, int screenHeight);
     void ProcessKeyboard(Camera_Movement DIRECTION, float deltaTime);
     void ProcessMouse(double xpos, double ypos);
     void ProcessScroll(double yoffset);
+    // lifts the camera back up if it went under groundHeight + GROUND_CLEARANCE
+    void KeepAbove(float groundHeight);
     glm::mat4 GetViewMatrix();
 };
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "height_bounds.hpp"
+
+// continuous distance dependent level of detail (CDLOD, Strugar 2010) for the
+// terrain mesh. A quadtree over the square terrain picks nodes each frame
+// whose size doubles with distance from the camera, and every node is drawn
+// with the same grid patch, so the triangle count follows how much of the
+// screen the terrain covers rather than how big it is. Towards the end of its
+// range a level morphs its odd vertices onto the grid of the next coarser one
+// (terrain.vert), so neighbouring levels meet without cracks and nodes switch
+// level without popping.
+//
+// LOD distances are measured to the plane half way up the terrain rather than
+// to the surface, so terrain.vert can work out the morph before it samples the
+// height and the ranges stay crack free whatever the relief. Nodes are culled
+// as boxes over the whole height range, or over the heights under them once
+// setHeightBounds has a min / max pyramid of the heightmap.
+
+#define CDLOD_MAX_LEVELS 16
+
+struct Cdlod_Params {
+    float size = 48.0f;                 // world units across the terrain, centred on the origin
+    float minHeight = 0.0f;             // world y of heightmap values 0 and 1, bounds every node for culling
+    float maxHeight = 10.0f;
+
+    int levels = 8;                     // level 0 has the smallest nodes, levels - 1 is the whole terrain
+    int nodeQuads = 32;                 // grid quads per side of a node at any level, a multiple of 4
+
+    float finestRange = 1.5f;           // distance level 0 reaches to, raised to the smallest crack free value
+    float rangeRatio = 2.0f;            // each level reaches this much further than the one below
+    float morphStartRatio = 0.66f;      // how far through its band of distances a level starts morphing
+};
+
+// one quarter of a selected node, drawn as an instance of the shared patch of
+// nodeQuads / 2 quads per side. Laid out as the vec4 instance attribute terrain.vert reads
+struct Cdlod_Patch {
+    float x;                            // world x and z of the min corner
+    float z;
+    float quadSize;                     // world size of a grid quad, size / nodeQuads of its node
+    float level;
+};
+
+class CdlodQuadtree {
+
+    public:
+
+    Cdlod_Params params;
+
+    // distance each level reaches to, and the band it morphs over before that
+    float ranges[CDLOD_MAX_LEVELS];
+    float morphStart[CDLOD_MAX_LEVELS];
+    float morphEnd[CDLOD_MAX_LEVELS];
+
+    // filled by select()
+    std::vector<Cdlod_Patch> patches;
+
+    CdlodQuadtree(const Cdlod_Params& paramsIn);
+
+    // picks the patches to draw for a camera at eye, leaving out nodes outside
+    // the frustum of viewProjection. Returns the number of patches
+    int select(glm::vec3 eye, const glm::mat4& viewProjection);
+
+    // height of the plane LOD distances are measured to
+    float lodHeight() const { return 0.5f * (params.minHeight + params.maxHeight); }
+
+    // (end / (end - start), 1 / (end - start)) of a level's morph band,
+    // terrain.vert morphs by 1 - clamp(x - distance * y, 0, 1)
+    glm::vec2 morphConstants(int level) const;
+
+    int patchQuads() const { return params.nodeQuads / 2; }
+    int triangleCount() const { return int(patches.size()) * patchQuads() * patchQuads() * 2; }
+
+    // culls against the heights under each node instead of the whole range.
+    // bounds is over the heightmap texture terrain.vert samples at
+    // (world xz / size + 0.5) * uvScale + uvOffset, wrapping, and floorHeight
+    // is the heightmap value it lifts lower heights to (its WATER_LEVEL).
+    // nullptr goes back to the whole range
+    void setHeightBounds(const HeightBounds* bounds, glm::vec2 uvOffset, float uvScale, float floorHeight);
+
+    private:
+
+    glm::vec4 frustumPlanes[6];
+
+    const HeightBounds* heightBounds;
+    glm::vec2 boundsUvOffset;
+    float boundsUvScale;
+    float boundsFloor;
+
+    glm::vec2 nodeHeights(float x, float z, float size) const;
+
+    bool selectNode(float x, float z, float size, int level, glm::vec3 eye);
+    void addQuarter(float x, float z, float nodeSize, int level);
+    bool inRange(float x, float z, float size, int level, glm::vec3 eye) const;
+    bool inFrustum(float x, float z, float size) const;
+};
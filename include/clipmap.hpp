@@ -0,0 +1,81 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "job_pool.hpp"
+#include "noise.hpp"
+#include "toroidal.hpp"
+
+// geometry clipmaps (Losasso & Hoppe 2004) for view distances far past one
+// heightmap. Every level is the same gridQuads x gridQuads grid centred on the
+// eye, each with twice the spacing of the one inside it, and each backed by
+// its own toroidal heightfield, so moving the eye only generates the strips
+// of every level that came into view. Memory is levels * texSize^2 floats
+// whatever the size of the world, and the work per frame is bounded by the
+// strips crossed rather than by how far the terrain reaches.
+//
+// Level l holds samples at st = texel * 2^l / texRes, on the corners of its
+// grid, so every other sample of a level is a sample of the next coarser one
+// and the grids nest exactly. A level covers the hole in the middle of the
+// next coarser one, which is gridQuads / 2 of that level's quads across and
+// sits holeMin() or holeMin() + 1 quads in along each axis depending on how
+// the eye snapped. terrain.vert blends heights towards the next coarser level
+// over the outer blendWidth() texels, reaching it at the edge, so neighbouring
+// levels meet without cracks.
+
+#define CLIPMAP_MAX_LEVELS 16
+
+struct Clipmap_Params {
+    int levels = 12;
+    int gridQuads = 122;                // quads per side of every level, 2 more than a multiple of 4
+    float texRes = 2048.0f;             // level 0 samples per st unit, halved by each coarser level
+};
+
+// a rectangle of one level's ring that was regenerated
+struct Clipmap_Rect {
+    int level;
+    Toroidal_Rect rect;
+};
+
+class Clipmap {
+
+    public:
+
+    Clipmap_Params params;
+    Noise_Type type;
+
+    // width of every level's ring, the power of two that holds a level's grid
+    // plus the one texel border its normals are differenced from
+    int texSize;
+
+    std::vector<ToroidalHeightfield> levels;
+
+    // level texel under grid vertex (0, 0) of each level, set by update()
+    glm::ivec2 gridOrigins[CLIPMAP_MAX_LEVELS];
+
+    Clipmap(Noise_Type typeIn, const Clipmap_Params& paramsIn);
+
+    // recentres every level on eye (in st) and generates the strips that came
+    // into view across the pool. Returns the ring rectangles rewritten, to upload
+    std::vector<Clipmap_Rect> update(glm::vec2 eye, const Noise& noise, JobPool& pool);
+
+    // every level is regenerated on the next update, e.g. after the noise changed
+    void invalidate();
+
+    // grid quad of level where level - 1 starts, holeMin() or holeMin() + 1 on each axis
+    glm::ivec2 holeOffset(int level) const { return gridOrigins[level - 1] / 2 - gridOrigins[level]; }
+    int holeMin() const { return (params.gridQuads / 2 - 1) / 2; }
+
+    // texels over which a level blends into the next coarser one
+    float blendWidth() const { return float(params.gridQuads) / 10.0f; }
+
+    // samples per st unit of a level
+    float levelTexRes(int level) const { return params.texRes / float(1 << level); }
+
+    // level sample at a level texel inside its current grid
+    float height(int level, glm::ivec2 texel) const { return levels[level].at(texel.x, texel.y); }
+
+    size_t memoryBytes() const { return size_t(params.levels) * texSize * texSize * sizeof(float); }
+};
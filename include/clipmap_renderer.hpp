@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "clipmap.hpp"
+#include "job_pool.hpp"
+#include "noise.hpp"
+#include "shader.hpp"
+
+// gpu side of a Clipmap: every level's ring in one layer of an R32F texture
+// array, updated a strip at a time as the levels scroll, and the grids drawn
+// with terrain.vert built with CLIPMAP 1. Level 0 is the whole grid, the
+// coarser levels the grid less the hole the level inside them covers, one
+// index range for each of the 4 places the hole can sit. Every level but the
+// last also draws a seam of zero area triangles round its edge
+class ClipmapRenderer {
+
+    public:
+
+    Clipmap clipmap;
+
+    unsigned int texture;
+
+    ClipmapRenderer(Noise_Type type, const Clipmap_Params& params);
+    ~ClipmapRenderer();
+
+    // recentres on eye (in st) and uploads what was regenerated, returns the texels uploaded
+    int update(glm::vec2 eye, const Noise& noise, JobPool& pool);
+
+    // uniforms that only change with the clipmap, worldPerSt is the world size of one st unit
+    void setUniforms(Shader& shader, float worldPerSt, int textureUnit) const;
+
+    // draws every level with shader, which must be in use with setUniforms
+    // done and the texture bound. worldOffset moves with posOffset so it's set
+    // here. Returns the triangles drawn
+    int draw(Shader& shader, glm::vec2 worldOffset);
+
+    private:
+
+    unsigned int vao, gridVBO, ebo;
+
+    // first index and index count of the full grid, then of each hole position
+    // (x - holeMin() + 2 * (y - holeMin())), then of the seam around the edge
+    int rangeFirst[6];
+    int rangeCount[6];
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "heightfield.hpp"
+#include "job_pool.hpp"
+
+// diamond-square (midpoint displacement) heightfield generator. Fills a square
+// field of 2^n + 1 texels a level at a time: every level sets the centre of
+// each square (diamond step) and then the midpoint of each edge (square step)
+// to the average of its neighbours plus a random offset, halving the spacing
+// until every texel is set.
+//
+// Offsets are a hash of the texel and the seed rather than a running random
+// stream, so a seed gives the same field on any number of threads and in any
+// traversal order.
+
+#define DIAMOND_SQUARE_MIN_SIZE 3
+#define DIAMOND_SQUARE_MAX_SIZE 16385
+
+// points per side of one parallelFor job within a level, a block of the finest
+// level plus the rows either side of it stay in L2
+#define DIAMOND_SQUARE_BLOCK 64
+
+struct Diamond_Square_Params {
+    unsigned int seed = 0;
+
+    float base = 0.5f;          // height the corners start around
+    float amplitude = 0.5f;     // largest offset of the corners, each level after that is scaled by roughness
+    float roughness = 0.5f;     // like the fbm gain, lower is smoother
+
+    // wraps the neighbours of the outer edges around, so the last row and
+    // column repeat the first and copies of the field tile seamlessly
+    bool tileable = true;
+};
+
+// field has to be square with a side of 2^n + 1 (3 to DIAMOND_SQUARE_MAX_SIZE), returns false otherwise
+bool generateDiamondSquare(Heightfield& field, const Diamond_Square_Params& params, JobPool& pool);
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "heightfield.hpp"
+#include "job_pool.hpp"
+
+// particle based hydraulic erosion: each droplet rolls downhill over the
+// heightfield, picking up sediment while it speeds up and dropping it when it
+// slows down or the slope flattens out. Heights are eroded/deposited in place.
+
+// tiles the deterministic schedule splits the field into. A droplet never
+// strays more than half a tile from the tile it starts in, so tiles two apart
+// in x and y can run at the same time without touching the same texels
+#define EROSION_TILE_SIZE 128
+// droplets each tile runs per pass over the four tile colours, keeps
+// neighbouring tiles eroding in step instead of one tile finishing first
+#define EROSION_DROPLETS_PER_BATCH 256
+
+struct Erosion_Params {
+    int dropletCount = 1 << 20;
+    unsigned int seed = 0;
+
+    // true runs the tiled schedule above, which gives the same heights for a
+    // given seed on any number of threads. false lets droplets roam the whole
+    // field with atomic (compare-exchange) height updates: no tile margin limits
+    // how far a droplet can travel, but the result depends on thread timing
+    // and every brush texel costs an atomic add
+    bool deterministic = true;
+
+    int maxLifetime = 30;
+    int radius = 3;                     // erosion brush radius in texels
+    float inertia = 0.05f;              // how much of its old direction a droplet keeps each step
+    float sedimentCapacity = 4.0f;
+    float minSedimentCapacity = 0.01f;  // keeps flat ground from holding no sediment at all
+    float erodeSpeed = 0.3f;
+    float depositSpeed = 0.3f;
+    float evaporateSpeed = 0.01f;
+    float gravity = 4.0f;
+    float initialWater = 1.0f;
+    float initialSpeed = 1.0f;
+
+    // texels per unit of height, so slopes are measured in the same units as
+    // the distance a droplet moves. main.cpp draws a height of 1 about 850 texels tall at TEX_RES 4096
+    float heightScale = 512.0f;
+};
+
+void erodeDroplets(Heightfield& field, const Erosion_Params& params, JobPool& pool);
@@ -0,0 +1,31 @@
+#pragma once
+
+// lattice gradient hashes shared by Noise, the simd kernels and noisegen.frag,
+// the values here have to match the HASH_* defines in the shader
+
+enum Hash_Type {
+    HASH_SIN,           // original fract(sin(x) * 43758.5453) hash, differs between gpus
+    HASH_PCG,           // pcg2d (Jarzynski & Olano), integer only
+    HASH_XXHASH,        // xxhash32 style mix of both coordinates, integer only
+    HASH_PERMUTATION    // classic Perlin permutation table with 8 gradient directions
+};
+
+#define HASH_TYPE_COUNT 4
+
+#define PCG_MULTIPLIER 1664525u
+#define PCG_INCREMENT  1013904223u
+
+#define XXHASH_PRIME2 2246822519u
+#define XXHASH_PRIME3 3266489917u
+#define XXHASH_PRIME4 668265263u
+#define XXHASH_PRIME5 374761393u
+
+#define PERM_SIZE 256
+
+// integer hashes keep 16 bits per component, mapped exactly onto [-1, 1)
+#define HASH_UNIT_SCALE (1.0f / 32768.0f)
+
+#define GRAD_DIAGONAL 0.70710678f
+
+static const float PERM_GRAD_X[8] = { 1.0f, -1.0f, 0.0f, 0.0f, GRAD_DIAGONAL, -GRAD_DIAGONAL, GRAD_DIAGONAL, -GRAD_DIAGONAL };
+static const float PERM_GRAD_Y[8] = { 0.0f, 0.0f, 1.0f, -1.0f, GRAD_DIAGONAL, GRAD_DIAGONAL, -GRAD_DIAGONAL, -GRAD_DIAGONAL };
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "heightfield.hpp"
+#include "job_pool.hpp"
+
+// min / max pyramid over a heightfield, so culling, LOD metrics and ray
+// queries can tell how high and low the terrain under an area goes without
+// reading every texel of it. Level 0 cells hold the range of 2x2 texels and
+// each level above the range of 2x2 cells of the one below, so a level l cell
+// covers 2^(l + 1) texels a side, up to a single cell over the whole field.
+// Odd sizes round up, the last cell of a row or column covering what's left.
+//
+// Bounds are of the texel samples. Anything interpolated between texels stays
+// inside the range of the texels around it, so a query over every texel a
+// shape reads is conservative for that shape.
+
+// cell rows per job when a level is built across the pool
+#define HEIGHT_BOUNDS_BAND_ROWS 32
+
+struct Height_Bounds_Level {
+    int width;
+    int height;
+    std::vector<float> minHeights;
+    std::vector<float> maxHeights;
+};
+
+class HeightBounds {
+
+    public:
+
+    // texels covered
+    int width;
+    int height;
+
+    // queries read no level below this one, for pyramids whose finer levels
+    // were never filled (HeightBoundsReducer reads back coarse levels only)
+    int firstLevel;
+
+    std::vector<Height_Bounds_Level> levels;
+
+    HeightBounds(int widthIn, int heightIn);
+
+    // every level from a width x height field
+    void build(const Heightfield& field, JobPool& pool);
+
+    // the texels of source were just written at texel (x, y): refreshes the
+    // cells they touch on every level and leaves the rest. x and y must be
+    // even, and source an even size or reach the right / top edge, so no
+    // level 0 cell is only partly covered
+    void update(const Heightfield& source, int x, int y, JobPool& pool);
+
+    // fills the levels above level from its cells, after they were written from elsewhere
+    void buildAbove(int level, JobPool& pool);
+
+    // (min, max) of one cell
+    glm::vec2 cell(int level, int x, int y) const;
+
+    // (min, max) over texels first to last inclusive, from at most 3x3 cells
+    // of the finest level that covers the region that way, so the range can be
+    // wider than the texels' own. wrap takes texels modulo the size (toroidal
+    // heightmaps), otherwise the region is clamped to the field
+    glm::vec2 regionBounds(glm::ivec2 first, glm::ivec2 last, bool wrap) const;
+
+    int levelCount() const { return int(levels.size()); }
+
+    private:
+
+    void reduceLevel(int level, int firstRow, int lastRow, int firstColumn, int lastColumn, JobPool& pool);
+    glm::vec2 clampedBounds(glm::ivec2 first, glm::ivec2 last) const;
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "height_bounds.hpp"
+#include "job_pool.hpp"
+#include "shader.hpp"
+
+// builds the HeightBounds pyramid of a heightmap texture on the gpu, one
+// fragment pass per level into an RG32F (min, max) texture per level, so
+// heightmaps made by noisegen never have to come back whole. Only the coarse
+// levels culling needs are read back. Not one mip chain, as mips round their
+// sizes down where the pyramid rounds up
+class HeightBoundsReducer {
+
+    public:
+
+    // RG32F, one per level of the pyramid
+    std::vector<unsigned int> textures;
+
+    int width;
+    int height;
+    int levels;
+
+    HeightBoundsReducer(const std::string& buildPath, int widthIn, int heightIn);
+    ~HeightBoundsReducer();
+
+    HeightBoundsReducer(const HeightBoundsReducer&) = delete;
+    HeightBoundsReducer& operator=(const HeightBoundsReducer&) = delete;
+
+    // every level from heightTexture, a width x height R32F texture. Leaves
+    // the framebuffer unbound and the viewport changed
+    void reduce(unsigned int heightTexture);
+
+    // copies level and the levels above it into bounds, which must be width x
+    // height, and sets its firstLevel to level. Waits for reduce to finish
+    void read(int level, HeightBounds& bounds, JobPool& pool);
+
+    private:
+
+    Shader shader;
+    unsigned int fbo, vao;
+    int firstPassLoc, sourceSizeLoc;
+
+    std::vector<float> readBuffer;
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "height_bounds.hpp"
+#include "heightfield.hpp"
+#include "job_pool.hpp"
+
+// height queries over a cpu heightfield, read the way terrain.vert samples the
+// heightmap: bilinear between texel centres. Positions are in field space, x
+// and z in texels with texel (i, j)'s centre at (i + 0.5, j + 0.5) and z along
+// the field's rows, y in the field's own height units. Mapping that to world
+// space is left to the caller, a ray stays a ray through any such scaling.
+//
+// wrap takes texels modulo the size (toroidal heightmaps, world texel
+// coordinates can be passed straight in), otherwise positions are clamped to
+// the field and rays end at its edge.
+
+// rays step along the ray this far past each cell boundary so they can't get
+// stuck on it, a hit inside the gap is still found as the ray being under
+#define HEIGHT_QUERY_RAY_EPSILON 1e-4f
+// points per job when a batch is spread over the pool
+#define HEIGHT_QUERY_BATCH_BLOCK 4096
+
+struct Height_Hit {
+    // along the ray, in multiples of direction
+    float distance;
+    glm::vec3 position;
+};
+
+class HeightQuery {
+
+    public:
+
+    // field and bounds must outlive the query. Without bounds raycasts test
+    // every texel square along the ray, with them they skip the cells the ray
+    // passes over, bounds must then be the same size as field
+    HeightQuery(const Heightfield& fieldIn, const HeightBounds* boundsIn, bool wrapIn);
+
+    float texel(int x, int y) const;
+
+    // bilinear height at p
+    float height(glm::vec2 p) const;
+
+    // out[i] = height(points[i])
+    void heights(const glm::vec2* points, float* out, int count) const;
+    void heights(const glm::vec2* points, float* out, int count, JobPool& pool) const;
+
+    // first point within maxDistance of origin where the ray is at or under
+    // the surface, a ray starting under it hits at distance 0
+    bool raycast(glm::vec3 origin, glm::vec3 direction, float maxDistance, Height_Hit& hit) const;
+
+    private:
+
+    const Heightfield& field;
+    const HeightBounds* bounds;
+    bool wrap;
+
+    bool squareHit(glm::ivec2 square, glm::vec3 start, glm::vec3 direction, float begin, float end, float& distance) const;
+};
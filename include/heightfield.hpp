@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "job_pool.hpp"
+#include "noise.hpp"
+
+// square tiles the threaded generators split a heightfield into, small enough
+// that a tile row plus the batch scratch buffers stay in L1
+#define HEIGHTFIELD_TILE_SIZE 64
+
+// row-major float heightfield, same layout as the R32F noiseTex (row 0 is the bottom row)
+class Heightfield {
+
+    public:
+
+    int width;
+    int height;
+    std::vector<float> data;
+
+    Heightfield(int widthIn, int heightIn);
+
+    float& at(int x, int y) { return data[size_t(y) * width + x]; }
+    float at(int x, int y) const { return data[size_t(y) * width + x]; }
+    float* row(int y) { return &data[size_t(y) * width]; }
+    const float* row(int y) const { return &data[size_t(y) * width]; }
+};
+
+// fills field the way noisegen.frag fills noiseTex: texel (x, y) is sampled at
+// st = origin + (x + 0.5, y + 0.5) / texRes, i.e. gl_FragCoord.xy / TEX_RES offset by origin
+void generateHeightfield(Heightfield& field, const Noise& noise, Noise_Type type, glm::vec2 origin, float texRes);
+
+// only fills the width x height texels starting at (x0, y0), sampled as if the whole field was generated
+void generateHeightfieldRegion(Heightfield& field, const Noise& noise, Noise_Type type, glm::vec2 origin, float texRes,
+                               int x0, int y0, int width, int height);
+
+// count texels of world row worldY starting at world texel worldX, sampled at
+// st = (worldX + i + texelOffset, worldY + texelOffset) / texRes. Used where
+// storage and world positions don't line up (toroidal heightmaps). A texelOffset
+// of 0 samples the corners of the texRes grid instead of the centres, so grids
+// of half the texRes land on every other sample (Clipmap)
+void generateRow(float* out, int worldX, int worldY, int count, const Noise& noise, Noise_Type type, float texRes,
+                 float texelOffset = 0.5f);
+
+// same output as generateHeightfield, split into tileSize squares spread over the pool
+void generateHeightfieldTiled(Heightfield& field, const Noise& noise, Noise_Type type, glm::vec2 origin, float texRes,
+                              JobPool& pool, int tileSize = HEIGHTFIELD_TILE_SIZE);
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "heightfield.hpp"
+
+// heightmap files for other tools, written a few rows at a time so a map far
+// bigger than memory can be streamed out of tile buffers as they're generated.
+// Rows go in top first (image order), the reverse of Heightfield and noiseTex.
+//
+//   png     16 bit greyscale PNG, stored (uncompressed) deflate so rows stream straight out
+//   r16     raw little endian uint16, no header
+//   r32f    raw little endian float, no header
+//   pfm     greyscale portable float map, little endian. PFM stores the bottom
+//           row first, so rows are seeked into place and the file can't go to a pipe
+//
+// The 16 bit formats map [minHeight, maxHeight] onto [0, 65535] and clamp
+// outside it, the float formats keep heights as they are.
+
+enum Heightmap_Format {
+    HEIGHTMAP_PNG16,
+    HEIGHTMAP_R16,
+    HEIGHTMAP_R32F,
+    HEIGHTMAP_PFM,
+    HEIGHTMAP_FORMAT_COUNT,
+};
+
+// the names above, also the file extension
+const char* heightmapFormatName(Heightmap_Format format);
+
+// bytes of the file a width x height map is written to
+size_t heightmapFileSize(Heightmap_Format format, int width, int height);
+
+class HeightmapWriter {
+
+    public:
+
+    // false once anything failed to write, the error has been printed
+    bool valid;
+
+    Heightmap_Format format;
+    int width;
+    int height;
+    float minHeight;
+    float maxHeight;
+
+    // rows written so far
+    int rows;
+
+    HeightmapWriter(const std::string& path, Heightmap_Format formatIn, int widthIn, int heightIn,
+                    float minHeightIn = 0.0f, float maxHeightIn = 1.0f);
+
+    // the next count rows down from the top, width floats each and stride
+    // floats apart in memory: width when they're packed top first, -width for
+    // a Heightfield's rows from its top one
+    void writeRows(const float* first, int count, std::ptrdiff_t stride);
+
+    // every row of a band width texels wide, its top row first
+    void writeBand(const Heightfield& band);
+
+    // ends the file, every row must have been written. Returns valid
+    bool finish();
+
+    private:
+
+    std::string path;
+    std::ofstream file;
+
+    // one row converted to the file's bytes, and the png chunk it's wrapped in
+    std::vector<unsigned char> rowBytes;
+    std::vector<unsigned char> pngChunk;
+
+    // png: running adler32 of the zlib stream's uncompressed bytes
+    unsigned int adler;
+
+    void writeBytes(const unsigned char* bytes, size_t count);
+    void writePngChunk(const char type[4], const unsigned char* data, size_t count);
+    void writePngRow(const float* row);
+};
+
+// writes the whole field in one go, rows flipped to top first
+bool exportHeightmap(const std::string& path, Heightmap_Format format, const Heightfield& field,
+                     float minHeight = 0.0f, float maxHeight = 1.0f);
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// fixed set of worker threads running parallelFor jobs with work stealing.
+// Each worker (the calling thread is worker 0) starts with a contiguous block
+// of job indices so neighbouring tiles stay on one core, pops its own queue
+// from the back and steals from the front of the others once it runs dry.
+class JobPool {
+
+    public:
+
+    // 0 uses every hardware thread
+    JobPool(int threadCountIn = 0);
+    ~JobPool();
+
+    JobPool(const JobPool&) = delete;
+    JobPool& operator=(const JobPool&) = delete;
+
+    // runs job(i) for every i in [0, count) and returns once all have finished
+    void parallelFor(int count, const std::function<void(int)>& job);
+
+    int threadCount() const { return int(queues.size()); }
+
+    private:
+
+    struct Job_Queue {
+        std::mutex mutex;
+        std::deque<int> jobs;
+    };
+
+    std::vector<std::unique_ptr<Job_Queue>> queues;
+    std::vector<std::thread> threads;
+
+    std::mutex stateMutex;
+    std::condition_variable wakeCondition;
+    std::condition_variable doneCondition;
+
+    const std::function<void(int)>* currentJob;
+    std::atomic<int> remaining;
+    unsigned int generation;
+    bool stopping;
+
+    void workerLoop(int workerIndex);
+    bool runOne(int workerIndex);
+    bool popJob(int workerIndex, int& jobIndex);
+};
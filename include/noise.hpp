@@ -0,0 +1,120 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "hash.hpp"
+#include "simd.hpp"
+
+// CPU port of src/shaders/noisegen/noisegen.frag, kept function-for-function
+// with the shader so heightfields can be generated without a GL context
+
+enum Noise_Type {
+    NOISE_PERLIN,
+    NOISE_FBM,
+    NOISE_RIDGE,
+    NOISE_TURBULENCE,
+    NOISE_DOMAIN_WARP_FBM,
+    NOISE_VORONOI,              // worley F1, distance to the nearest feature point
+    NOISE_VORONOI_F2,           // distance to the second nearest
+    NOISE_VORONOI_F2_MINUS_F1   // F2 - F1, zero along cell borders
+};
+
+#define NOISE_TYPE_COUNT 8
+
+// gradient noise the fractals (fbm, turbulence, ridge, domain warp) sum octaves of
+enum Noise_Basis {
+    NOISE_BASIS_PERLIN,         // 4 corner square lattice
+    NOISE_BASIS_SIMPLEX         // 3 corner triangle lattice, fewer gradients and no axis aligned streaks
+};
+
+#define NOISE_BASIS_COUNT 2
+
+// simplex skews st onto a lattice of equilateral triangles, (sqrt(3) - 1) / 2 and (3 - sqrt(3)) / 6
+#define SIMPLEX_SKEW 0.36602540378f
+#define SIMPLEX_UNSKEW 0.21132486541f
+#define SIMPLEX_UNSKEW_2 0.42264973081f
+// brings simplex to the rms of perlin so swapping the basis keeps the fractals' heights
+#define SIMPLEX_SCALE 40.0f
+
+// voronoi cells per unit of st
+#define VORONOI_SCALE 16
+// feature points sit at cell centre + rand2 * WORLEY_JITTER. rand2 components are
+// at most 1 in magnitude unrotated, so points sit in [0.146, 0.854] of their cell;
+// the timeOffset rotation can take the pcg and xxhash ones up to sqrt(2), which
+// still keeps them in [0, 1]. Neither makes the 3x3 neighbourhood search exact, a
+// point two cells over can be nearer than the cell's own. It was checked rather
+// than guaranteed: 5x5 brute force found no F1 or F2 mismatches over every hash
+// at a few time offsets (tens of millions of samples)
+#define WORLEY_JITTER 0.35355339f
+
+// octaves fbm and turbulence sum, noisegen.frag takes the same value as a variant define
+#define NOISE_OCTAVES 5
+
+// samples the *Batch functions work through at a time on the stack
+#define NOISE_BATCH_SIZE 256
+
+class Noise {
+
+    public:
+
+    float timeOffset;
+
+    // which lattice hash rand2 uses, set with setHash so the tables stay in sync
+    Hash_Type hashType;
+    unsigned int seed;
+
+    // (cos, sin) of timeOffset, integer hashes animate by rotating their gradients
+    glm::vec2 gradRotation;
+
+    // seeded shuffle of 0..PERM_SIZE-1 used by HASH_PERMUTATION
+    int perm[PERM_SIZE];
+
+    // kernel the *Batch functions dispatch to, defaults to the widest the cpu supports
+    Simd_Target simdTarget;
+
+    // octave noise of the fractals, NOISE_PERLIN samples are always perlin
+    Noise_Basis basisType;
+
+    Noise(float timeOffsetIn = 0.0f, Hash_Type hashTypeIn = HASH_PCG, unsigned int seedIn = 0);
+    void setTimeOffset(float timeOffsetIn);
+    void setHash(Hash_Type hashTypeIn, unsigned int seedIn);
+
+    float sample(Noise_Type type, glm::vec2 st) const;
+
+    float domainWarpFBM(glm::vec2 st) const;
+    float fbm(glm::vec2 st) const;
+    float perlin(glm::vec2 st) const;
+    float simplex(glm::vec2 st) const;
+    // perlin or simplex by basisType
+    float basis(glm::vec2 st) const;
+    float ridge(glm::vec2 st) const;
+    float turbulence(glm::vec2 st) const;
+    // (F1, F2) distances to the nearest feature points, points are hashed from
+    // their cell coordinates so the domain is unbounded
+    glm::vec2 worley(glm::vec2 st) const;
+
+    // out[i] = sample(type, (xs[i], ys[i])), bit identical to the per sample functions
+    void sampleBatch(Noise_Type type, const float* xs, const float* ys, float* out, int count) const;
+    void domainWarpFBMBatch(const float* xs, const float* ys, float* out, int count) const;
+    void fbmBatch(const float* xs, const float* ys, float* out, int count) const;
+    void perlinBatch(const float* xs, const float* ys, float* out, int count) const;
+    void simplexBatch(const float* xs, const float* ys, float* out, int count) const;
+    void basisBatch(const float* xs, const float* ys, float* out, int count) const;
+    void ridgeBatch(const float* xs, const float* ys, float* out, int count) const;
+    void turbulenceBatch(const float* xs, const float* ys, float* out, int count) const;
+    void worleyBatch(const float* xs, const float* ys, float* f1, float* f2, int count) const;
+
+    static float fade(float t);
+    // sin used by the hashes, a fixed polynomial so every simd target (and every
+    // libm) hashes to the same value
+    static float hashSin(float x);
+    static float rand(glm::vec2 st);
+    // gradient at lattice point p (p is always integral)
+    glm::vec2 rand2(glm::vec2 p) const;
+    glm::vec2 hashGradient(int x, int y) const;
+};
+
+// short lowercase names, for command lines and reports
+const char* noiseTypeName(Noise_Type type);
+const char* noiseBasisName(Noise_Basis basis);
+const char* hashTypeName(Hash_Type type);
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "hash.hpp"
+#include "noise.hpp"
+
+// everything the noisegen output depends on, the heightmap only has to be
+// regenerated when one of these changes
+struct Noise_Params {
+    Noise_Type type;
+    Hash_Type hashType;
+    unsigned int seed;
+    glm::vec2 posOffset;
+    float timeOffset;
+    Noise_Basis basisType;
+
+    bool operator==(const Noise_Params& other) const;
+    bool operator!=(const Noise_Params& other) const { return !(*this == other); }
+
+    // same values at the same st, i.e. equal apart from where the view is scrolled to
+    bool sameField(const Noise_Params& other) const;
+};
+
+// decides when a cached heightmap is stale. Unchanged parameters never
+// regenerate, changed ones regenerate at most maxRate times a second
+// (0 = as often as they change) so animated terrain doesn't cost a full
+// noise pass every frame
+class NoiseDirtyTracker {
+
+    public:
+
+    float maxRate;
+
+    NoiseDirtyTracker(float maxRateIn = 0.0f);
+
+    bool needsRegenerate(const Noise_Params& current, double time) const;
+    void markGenerated(const Noise_Params& current, double time);
+
+    // force the next needsRegenerate to return true, e.g. after the target was resized
+    void invalidate() { valid = false; }
+
+    bool hasGenerated() const { return valid; }
+    const Noise_Params& lastGenerated() const { return generated; }
+
+    private:
+
+    Noise_Params generated;
+    double generatedTime;
+    bool valid;
+};
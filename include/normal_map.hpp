@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "heightfield.hpp"
+#include "job_pool.hpp"
+#include "simd.hpp"
+
+// unit surface normals of a heightfield from central differences, worked out
+// once per regeneration and sampled by the terrain shader (no geometry stage).
+// Only x and z are stored, interleaved like a GL_RG texture; y is always
+// positive and comes back as sqrt(1 - x^2 - z^2). Every target and thread
+// count gives the same bits.
+
+// rows per parallelFor job
+#define NORMAL_MAP_BAND_ROWS 32
+
+struct Normal_Map_Params {
+    float heightScale = 10.0f;          // world units per unit of height, the terrain.vert amplitude
+    float texelSize = 1.0f;             // world units between neighbouring texels
+
+    // neighbours past an edge wrap round (tileable fields) instead of clamping to the edge
+    bool wrap = false;
+
+    // row kernels to run, every target gives the same normals
+    Simd_Target simdTarget = detectSimdTarget();
+};
+
+// same layout as Heightfield with an (x, z) pair per texel
+class NormalMap {
+
+    public:
+
+    int width;
+    int height;
+    std::vector<float> data;
+
+    NormalMap(int widthIn, int heightIn);
+
+    float* row(int y) { return &data[size_t(y) * width * 2]; }
+    const float* row(int y) const { return &data[size_t(y) * width * 2]; }
+
+    // full normal, y rebuilt from x and z
+    glm::vec3 at(int x, int y) const;
+};
+
+// normals has to be the same size as field
+void generateNormalMap(const Heightfield& field, NormalMap& normals, const Normal_Map_Params& params, JobPool& pool);
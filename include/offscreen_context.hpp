@@ -0,0 +1,37 @@
+#pragma once
+
+// GL 3.3 core context with no window or display, so the shader pipeline can
+// run on headless hosts (CI, containers, Mesa's llvmpipe). An EGL surfaceless
+// display is tried first, then a 1x1 pbuffer on the default display.
+// Everything has to render into framebuffer objects. Only built with EGL
+// (TERRAIN_EGL), otherwise valid is always false
+class OffscreenContext {
+
+    public:
+
+    bool valid;
+
+    OffscreenContext();
+    ~OffscreenContext();
+
+    OffscreenContext(const OffscreenContext&) = delete;
+    OffscreenContext& operator=(const OffscreenContext&) = delete;
+
+    // for gladLoadGLLoader
+    static void* getProcAddress(const char* name);
+
+    private:
+
+    // EGLDisplay, EGLContext and EGLSurface, opaque so including this needs no EGL headers
+    void* display;
+    void* context;
+    void* surface;
+
+    // EGL error of the last failed createContext, the cleanup after it resets eglGetError
+    int error;
+
+    // on failure everything created on displayIn is destroyed and it's terminated again
+    bool createContext(void* displayIn, bool pbuffer);
+    // destroys the context and surface and terminates display, back to the EGL_NO_* values
+    void destroyContext();
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vector>
+
+#include "heightfield.hpp"
+#include "job_pool.hpp"
+#include "simd.hpp"
+
+// grid based hydraulic erosion (shallow water pipe model). Every cell carries
+// water, dissolved sediment and outflow flux through virtual pipes to its four
+// neighbours; water follows the surface gradient, dissolves terrain where it
+// runs fast and drops it where it slows. Unlike erodeDroplets the state lives
+// on after each call, so it can be stepped a few iterations per frame.
+
+// rows per parallelFor job, each of the four sweeps per iteration is one parallelFor
+#define PIPE_EROSION_BAND_ROWS 16
+
+struct Pipe_Erosion_Params {
+    float timeStep = 0.05f;
+    float rainRate = 0.02f;             // water depth added per unit of time, everywhere
+    float gravity = 9.81f;
+    float pipeArea = 1.0f;
+    float pipeLength = 1.0f;            // distance between cell centres, in the same units as heights * heightScale
+    float sedimentCapacity = 1.0f;
+    float minTilt = 0.05f;              // flat ground still carries some sediment
+    float dissolveRate = 0.3f;
+    float depositRate = 0.3f;
+    float evaporationRate = 0.015f;
+
+    // texels per unit of height, as in Erosion_Params
+    float heightScale = 512.0f;
+};
+
+class PipeErosion {
+
+    public:
+
+    int width;
+    int height;
+
+    // which kernels the sweeps run, defaults to the widest the cpu supports
+    Simd_Target simdTarget;
+
+    PipeErosion(int widthIn, int heightIn);
+
+    // runs iterations steps of the solver over field (which must be width x height),
+    // reading its heights at the start and writing them back at the end
+    void run(Heightfield& field, const Pipe_Erosion_Params& params, int iterations, JobPool& pool);
+
+    // drains all water and sediment
+    void reset();
+
+    float waterAt(int x, int y) const { return water[index(x, y)]; }
+    float sedimentAt(int x, int y) const { return sediment[index(x, y)]; }
+
+    private:
+
+    // structure of arrays, each (height + 2) x stride with a ring of ghost cells
+    // (see Pipe_Kernel_State in src/simd/pipe_erosion_kernels.hpp)
+    int stride;
+
+    std::vector<float> terrain;
+    std::vector<float> water;
+    std::vector<float> sediment;
+    std::vector<float> sedimentNext;
+    std::vector<float> fluxLeft;
+    std::vector<float> fluxRight;
+    std::vector<float> fluxBottom;
+    std::vector<float> fluxTop;
+    std::vector<float> velocityX;
+    std::vector<float> velocityY;
+    std::vector<float> capacity;
+
+    std::vector<float> mask;
+    std::vector<float> column;
+
+    size_t index(int x, int y) const { return size_t(y + 1) * stride + x + 1; }
+    void copyEdgesToGhosts();
+};
+
+// one pipeline stage: a fresh solver run for iterations steps over field
+void erodePipes(Heightfield& field, const Pipe_Erosion_Params& params, int iterations, JobPool& pool);
@@ -1,22 +1,46 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 
+// linked programs are saved under the build path and reloaded with glProgramBinary
+// when the sources and driver match, set to 0 to always compile from source
+#define SHADER_BINARY_CACHE 1
+#define SHADER_CACHE_DIR "shader_cache/"
+#define SHADER_CACHE_MAGIC 0x42505447u
+
+// (name, value) pairs written as #defines between the #version line and the
+// rest of the source, so one file can be compiled into specialised permutations
+typedef std::vector<std::pair<std::string, std::string>> Shader_Defines;
+
 class Shader {
 
     public:
         unsigned int ID;
+        // true when the program came from the binary cache instead of being compiled
+        bool loadedFromCache;
 
-        Shader(std::string buildPath, const std::string shaderName);
+        Shader(std::string buildPath, const std::string shaderName, const Shader_Defines &defines = Shader_Defines());
         void use(); 
+
+        // locations are looked up once after linking, -1 for names the program doesn't use.
+        // Hot paths should keep the location and use the int overloads below,
+        // which skip the string hashing as well as the driver call
+        int getUniformLocation(const std::string &name) const;
         void setBool(const std::string &name, bool value) const;
         void setInt(const std::string &name, int value) const;
+        void setIntArray(const std::string &name, const int* values, int count) const;
         void setFloat(const std::string &name, float value) const;
         void setVec2(const std::string &name, const glm::vec2 &value) const;
         void setVec2(const std::string &name, float x, float y) const;
+        void setVec2Array(const std::string &name, const glm::vec2* values, int count) const;
+        void setIVec2(const std::string &name, const glm::ivec2 &value) const;
         void setVec3(const std::string &name, const glm::vec3 &value) const;
         void setVec3(const std::string &name, float x, float y, float z) const;
         void setVec4(const std::string &name, const glm::vec4 &value) const;
@@ -24,4 +48,42 @@ class Shader {
         void setMat2(const std::string &name, const glm::mat2 &mat) const;
         void setMat3(const std::string &name, const glm::mat3 &mat) const;
         void setMat4(const std::string &name, const glm::mat4 &mat) const;
+
+        void setBool(int location, bool value) const;
+        void setInt(int location, int value) const;
+        void setIntArray(int location, const int* values, int count) const;
+        void setFloat(int location, float value) const;
+        void setVec2(int location, const glm::vec2 &value) const;
+        void setVec2Array(int location, const glm::vec2* values, int count) const;
+        void setIVec2(int location, const glm::ivec2 &value) const;
+        void setVec3(int location, const glm::vec3 &value) const;
+        void setVec4(int location, const glm::vec4 &value) const;
+        void setMat2(int location, const glm::mat2 &mat) const;
+        void setMat3(int location, const glm::mat3 &mat) const;
+        void setMat4(int location, const glm::mat4 &mat) const;
+
+    private:
+        std::unordered_map<std::string, int> uniformLocations;
+
+        void cacheUniformLocations();
+
+        static bool programBinarySupported();
+        bool loadProgramBinary(const std::string &cachePath, uint64_t cacheKey);
+        void saveProgramBinary(const std::string &cachePath, uint64_t cacheKey) const;
+};
+
+// every define permutation of one shader asked for so far, each compiled (or
+// loaded from the binary cache) the first time it's requested
+class ShaderVariants {
+
+    public:
+        ShaderVariants(std::string buildPathIn, const std::string shaderNameIn);
+
+        Shader& get(const Shader_Defines &defines);
+        int variantCount() const { return int(variants.size()); }
+
+    private:
+        std::string buildPath;
+        std::string shaderName;
+        std::unordered_map<std::string, Shader> variants;
 };
@@ -0,0 +1,16 @@
+#pragma once
+
+// instruction sets the batch noise kernels are built for, in increasing order of width
+enum Simd_Target {
+    SIMD_SCALAR,
+    SIMD_SSE42,
+    SIMD_AVX2,
+    SIMD_AVX512
+};
+
+#define SIMD_TARGET_COUNT 4
+
+// widest target both this build and the running cpu support
+Simd_Target detectSimdTarget();
+bool simdTargetSupported(Simd_Target target);
+const char* simdTargetName(Simd_Target target);
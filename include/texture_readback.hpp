@@ -0,0 +1,93 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "heightfield.hpp"
+#include "job_pool.hpp"
+
+// copies that can be in flight at once, enough for a request every frame
+// while the gpu runs two frames behind
+#define TEXTURE_READBACK_BUFFERS 3
+
+// what a request fills in, shared by the ReadbackFuture and the buffer it's in flight in
+struct Readback_Result {
+    Heightfield field;
+    bool ready;
+    // set along with ready when the wait or the map failed, field is then left zeroed
+    bool failed;
+
+    Readback_Result(int width, int height) : field(width, height), ready(false), failed(false) {}
+};
+
+// a heightfield that arrives some frames after it was requested
+class ReadbackFuture {
+
+    public:
+
+    ReadbackFuture() {}
+    explicit ReadbackFuture(std::shared_ptr<Readback_Result> resultIn) : result(std::move(resultIn)) {}
+
+    // false for a default future, or a request that found every buffer in flight
+    bool valid() const { return result != nullptr; }
+
+    // the copy has reached the cpu, only changes in TextureReadback::poll
+    bool ready() const { return result && result->ready; }
+
+    // ready, but the copy didn't make it and get() holds zeros rather than the texture
+    bool failed() const { return result && result->ready && result->failed; }
+
+    // the texture as it was when requested, bottom row first like the
+    // texture. Only once ready, and still there after the future is gone for
+    // whoever kept share()
+    const Heightfield& get() const { return result->field; }
+    std::shared_ptr<const Readback_Result> share() const { return result; }
+
+    private:
+
+    std::shared_ptr<Readback_Result> result;
+};
+
+// one pixel buffer object and the request in flight in it, if any
+struct Readback_Buffer {
+    unsigned int pbo;
+    // GLsync, opaque so including this needs no GL header
+    void* fence;
+    std::shared_ptr<Readback_Result> result;
+};
+
+// reads a width x height R32F texture back without stalling on it: request
+// queues the copy into a pixel buffer object and fences it, poll picks up the
+// copies the gpu has finished, a frame or two later. With several buffers a
+// request can be made every frame while the ones before it are still in flight
+class TextureReadback {
+
+    public:
+
+    int width;
+    int height;
+
+    TextureReadback(int widthIn, int heightIn, int bufferCount = TEXTURE_READBACK_BUFFERS);
+    ~TextureReadback();
+
+    TextureReadback(const TextureReadback&) = delete;
+    TextureReadback& operator=(const TextureReadback&) = delete;
+
+    // queues a copy of level 0 of texture as it is after the commands issued
+    // so far. Never waits: if every buffer is in flight the future is invalid
+    ReadbackFuture request(unsigned int texture);
+
+    // checks the fences without waiting and copies every finished buffer into
+    // its future, rows spread across the pool. Returns how many became ready
+    int poll(JobPool& pool);
+
+    // waits for everything in flight, then polls
+    int finish(JobPool& pool);
+
+    // requests not yet ready
+    int pending() const;
+
+    private:
+
+    std::vector<Readback_Buffer> buffers;
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "heightfield.hpp"
+#include "job_pool.hpp"
+#include "simd.hpp"
+
+// thermal erosion (talus relaxation): wherever the drop to a neighbour is
+// steeper than the talus angle, part of the excess slides down to it, which
+// rounds off the knife edge crests ridge() leaves. Material only moves
+// between neighbours, so the total height is kept.
+//
+// Since it moves one texel per pass, a naive relaxation needs about
+// 16x the passes for every 4x in resolution. By default the field is first
+// relaxed on a pyramid of 2x downsampled copies, coarsest first, and each
+// level's change is upsampled into the next finer one before that gets relaxed
+// in turn; most of the movement then happens on small grids. Every target and
+// thread count gives the same heights.
+
+// rows per parallelFor job in a relaxation pass
+#define THERMAL_BAND_ROWS 32
+
+struct Thermal_Erosion_Params {
+    float talusAngle = 35.0f;           // degrees, steeper slopes get relaxed
+    float rate = 1.0f;                  // (0, 1], fraction of the excess moved per iteration
+    float tolerance = 0.5f;             // a level is done once no slope is over talus by more than this fraction of it
+    int maxIterations = 4096;           // per level
+
+    bool multigrid = true;
+    int coarsestSize = 64;              // stop downsampling once either side would go below this
+    float coarseTalusScale = 0.9f;      // coarse levels settle to this fraction of the talus slope
+
+    // texels per unit of height, as in Erosion_Params
+    float heightScale = 512.0f;
+
+    // relaxation kernels to run, every target gives the same heights
+    Simd_Target simdTarget = detectSimdTarget();
+};
+
+struct Thermal_Erosion_Stats {
+    int levels;                         // 1 without multigrid
+    int fineIterations;                 // passes applied at full resolution, not counting the one that found it settled
+    float workIterations;               // every level's applied passes weighted by its size, in full resolution passes
+    float maxExcess;                    // steepest slope left over talus, as a fraction of talus
+};
+
+Thermal_Erosion_Stats erodeThermal(Heightfield& field, const Thermal_Erosion_Params& params, JobPool& pool);
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+#include <glm/glm.hpp>
+
+#include "heightfield.hpp"
+#include "job_pool.hpp"
+#include "noise.hpp"
+
+// integer tile coordinates, tile (x, y) covers texels [x * tileRes, (x + 1) * tileRes)
+// of the infinite texRes-per-unit grid noisegen.frag samples
+struct Tile_Coord {
+    int x;
+    int y;
+
+    bool operator==(const Tile_Coord& other) const { return x == other.x && y == other.y; }
+    bool operator!=(const Tile_Coord& other) const { return !(*this == other); }
+};
+
+struct Tile_Coord_Hash {
+    size_t operator()(const Tile_Coord& coord) const {
+        return size_t(unsigned(coord.x)) * 73856093u ^ size_t(unsigned(coord.y)) * 19349663u;
+    }
+};
+
+// fixed size heightfield tiles generated on demand and kept in least recently
+// used order under a memory budget, so a scrolling view only pays for the
+// tiles that newly come into range
+class TileCache {
+
+    public:
+
+    Noise_Type type;
+    int tileRes;
+    float texRes;
+    size_t memoryBudget;
+
+    // running totals, reset by clear()
+    size_t hits;
+    size_t generated;
+    size_t evicted;
+
+    TileCache(Noise_Type typeIn, int tileResIn, float texResIn, size_t memoryBudgetIn);
+
+    // makes every tile in [min, max] (inclusive) resident, generating the missing
+    // ones across the pool. Tiles outside the range are evicted oldest first to
+    // stay under budget, tiles inside it never are. Returns how many were generated.
+    int request(Tile_Coord min, Tile_Coord max, const Noise& noise, JobPool& pool);
+
+    // nullptr if the tile isn't resident, otherwise marks it as just used
+    const Heightfield* find(Tile_Coord coord);
+
+    // drop everything, needed whenever noise parameters change
+    void clear();
+
+    glm::vec2 tileOrigin(Tile_Coord coord) const;
+    Tile_Coord tileAt(glm::vec2 st) const;
+
+    size_t tileBytes() const { return size_t(tileRes) * tileRes * sizeof(float); }
+    size_t tileCount() const { return tiles.size(); }
+    size_t memoryUsage() const { return tiles.size() * tileBytes(); }
+
+    private:
+
+    struct Tile_Entry {
+        std::unique_ptr<Heightfield> field;
+        std::list<Tile_Coord>::iterator lruPos;
+    };
+
+    // front is the most recently used
+    std::list<Tile_Coord> lru;
+    std::unordered_map<Tile_Coord, Tile_Entry, Tile_Coord_Hash> tiles;
+
+    void touch(Tile_Entry& entry);
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "height_bounds.hpp"
+#include "job_pool.hpp"
+#include "noise.hpp"
+#include "normal_map.hpp"
+#include "tile_cache.hpp"
+
+// keeps a window of cpu generated tiles resident in a GL_REPEAT R32F texture,
+// with their normals (generateNormalMap) in a matching RG16F one. Tiles live
+// at slot (coord mod windowTiles), so scrolling posOffset only uploads the
+// tiles that newly enter the window and the terrain shader reads through
+// heightMapOffset / heightMapScale
+class TileStreamer {
+
+    public:
+
+    unsigned int texture;
+    unsigned int normalTexture;
+
+    Normal_Map_Params normalParams;
+
+    int windowTiles;
+    int texSize;
+
+    // set by update(), texcoord = aTexCoords * heightMapScale + heightMapOffset
+    glm::vec2 heightMapOffset;
+    float heightMapScale;
+
+    TileCache cache;
+
+    // min / max pyramid of texture, kept up to date a tile at a time for culling
+    HeightBounds bounds;
+
+    // the window covers the same 1x1 st square noisegen renders, plus one tile of slack
+    TileStreamer(Noise_Type type, int tileRes, int texRes, size_t memoryBudget, const Normal_Map_Params& normalParamsIn);
+    ~TileStreamer();
+
+    // returns the number of tiles uploaded this call
+    int update(glm::vec2 posOffset, const Noise& noise, JobPool& pool);
+
+    // forget every resident tile, e.g. after the noise parameters changed
+    void invalidate();
+
+    private:
+
+    // tile currently uploaded to each slot
+    std::vector<Tile_Coord> slots;
+    std::vector<bool> slotValid;
+
+    // tile with a one texel border of its neighbours, so normals along its
+    // edges match the tiles either side
+    Heightfield paddedTile;
+    NormalMap paddedNormals;
+
+    void padTile(Tile_Coord coord, const Heightfield& tile, const Noise& noise);
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "heightfield.hpp"
+#include "job_pool.hpp"
+#include "noise.hpp"
+
+// A toroidal (ring buffer) heightmap stores world texel (x, y) of the
+// texRes-per-unit grid at (x mod size, y mod size), so when the window moves
+// only the texels that newly come into view have to be generated, everything
+// else stays where it is. World texel (x, y) is sampled at st = (x + 0.5, y + 0.5) / texRes.
+
+// a rectangle of texels in ring (texture) space, and the world texel its corner holds
+struct Toroidal_Rect {
+    int x;
+    int y;
+    int width;
+    int height;
+    int worldX;
+    int worldY;
+};
+
+// rectangles that enter a size x size window when its world origin moves from
+// oldOrigin to newOrigin, already split at the wrap seams so each one is
+// contiguous in the texture. full (or a jump of a whole window) returns the entire window
+std::vector<Toroidal_Rect> toroidalExposedRects(glm::ivec2 oldOrigin, glm::ivec2 newOrigin, int size, bool full);
+
+// cpu side ring heightmap, regenerated a strip at a time as the window scrolls
+class ToroidalHeightfield {
+
+    public:
+
+    Heightfield field;
+    // world texel at the bottom left of the window
+    glm::ivec2 origin;
+    // where in its world texel each sample is taken, see generateRow
+    float texelOffset;
+
+    ToroidalHeightfield(int size);
+
+    // moves the window to newOrigin, generating only the exposed strips across
+    // the pool. Returns the ring rectangles that were rewritten (e.g. to upload)
+    std::vector<Toroidal_Rect> scroll(glm::ivec2 newOrigin, const Noise& noise, Noise_Type type, float texRes, JobPool& pool);
+
+    // world texel lookup, only valid inside the current window
+    float at(int worldX, int worldY) const;
+
+    // the next scroll regenerates the whole window
+    void invalidate() { valid = false; }
+
+    private:
+
+    bool valid;
+};
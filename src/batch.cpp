@@ -0,0 +1,442 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "hash.hpp"
+#include "heightfield.hpp"
+#include "heightmap_export.hpp"
+#include "job_pool.hpp"
+#include "noise.hpp"
+#include "tile_cache.hpp"
+
+// terrain-gen-batch [options]
+// bakes heightmap tiles with the cpu noise path, no window or GL context needed
+//
+//   --seed N                 hash seed (0)
+//   --hash NAME              sin, pcg, xxhash, permutation (pcg)
+//   --type NAME              perlin, fbm, ridge, turbulence, domain-warp, voronoi, voronoi-f2, voronoi-f2-f1 (ridge)
+//   --basis NAME             perlin, simplex (perlin)
+//   --time T                 timeOffset the field is frozen at (0)
+//   --region X0 Y0 X1 Y1     tiles to write, inclusive (0 0 3 3)
+//   --tile-res N             texels a side of each tile (512)
+//   --tex-res N              texels per unit of st, main.cpp's TEX_RES (4096)
+//   --threads N              generation threads, 0 uses every core (0)
+//   --out DIR                (tiles)
+//   --map FILE               stitch the region into one heightmap file instead of writing tiles
+//   --format NAME            the map's format: png, r16, r32f, pfm (png)
+//   --range MIN MAX          heights mapped onto 0 and 65535 by png and r16 (0 1)
+//
+// Tiles are on TileCache's grid, tile (x, y) covering texels [x * tileRes, (x + 1) * tileRes)
+// of the texRes per unit grid noisegen.frag samples, and are written to
+// DIR/tile_X_Y.r32 as tileRes^2 native endian floats, bottom row first like noiseTex.
+// A map is generated a row of tiles at a time from the top and streamed through
+// HeightmapWriter, so it never needs more than two rows of tiles in memory
+
+// tiles generated per thread before they're handed to the writer, enough to
+// split into row blocks for every core even when the region is one tile wide
+#define BATCH_TILES_PER_THREAD 2
+// seconds between progress lines
+#define BATCH_PROGRESS_INTERVAL 1.0
+
+struct Batch_Options {
+    unsigned int seed = 0;
+    Hash_Type hashType = HASH_PCG;
+    Noise_Type type = NOISE_RIDGE;
+    Noise_Basis basisType = NOISE_BASIS_PERLIN;
+    float timeOffset = 0.0f;
+    Tile_Coord first = { 0, 0 };
+    Tile_Coord last = { 3, 3 };
+    int tileRes = 512;
+    float texRes = 4096.0f;
+    int threads = 0;
+    std::string outDir = "tiles";
+    std::string mapPath;
+    Heightmap_Format mapFormat = HEIGHTMAP_PNG16;
+    float minHeight = 0.0f;
+    float maxHeight = 1.0f;
+};
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void printUsage() {
+    std::cout << "usage: terrain-gen-batch [--seed N] [--hash NAME] [--type NAME] [--basis NAME] [--time T]\n"
+                 "                         [--region X0 Y0 X1 Y1] [--tile-res N] [--tex-res N] [--threads N] [--out DIR]\n"
+                 "                         [--map FILE] [--format NAME] [--range MIN MAX]\n";
+
+    std::cout << "\tnoise types:";
+    for (int type = 0; type < NOISE_TYPE_COUNT; type++) {
+        std::cout << " " << noiseTypeName(Noise_Type(type));
+    }
+    std::cout << "\n\tbases:";
+    for (int basis = 0; basis < NOISE_BASIS_COUNT; basis++) {
+        std::cout << " " << noiseBasisName(Noise_Basis(basis));
+    }
+    std::cout << "\n\thashes:";
+    for (int hash = 0; hash < HASH_TYPE_COUNT; hash++) {
+        std::cout << " " << hashTypeName(Hash_Type(hash));
+    }
+    std::cout << "\n\tmap formats:";
+    for (int format = 0; format < HEIGHTMAP_FORMAT_COUNT; format++) {
+        std::cout << " " << heightmapFormatName(Heightmap_Format(format));
+    }
+    std::cout << "\n";
+}
+
+// index of name in the count names nameOf gives, -1 if it isn't one of them
+template <typename Enum>
+int findName(const char* name, int count, const char* (*nameOf)(Enum)) {
+    for (int i = 0; i < count; i++) {
+        if (std::strcmp(name, nameOf(Enum(i))) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool parseFloat(const char* text, float& value) {
+    char* end;
+    value = std::strtof(text, &end);
+    return end != text && *end == '\0';
+}
+
+// whole text has to be a number that fits an int, out of range values are rejected rather than wrapped
+bool parseInt(const char* text, int& value) {
+    char* end;
+    errno = 0;
+    long parsed = std::strtol(text, &end, 10);
+    if (end == text || *end != '\0' || errno == ERANGE || parsed < INT_MIN || parsed > INT_MAX) {
+        return false;
+    }
+    value = int(parsed);
+    return true;
+}
+
+// the full unsigned range, strtoul would take "-1" as ULONG_MAX so negative values are rejected
+bool parseUnsigned(const char* text, unsigned int& value) {
+    char* end;
+    errno = 0;
+    unsigned long parsed = std::strtoul(text, &end, 10);
+    if (end == text || *end != '\0' || errno == ERANGE || parsed > UINT_MAX || std::strchr(text, '-')) {
+        return false;
+    }
+    value = unsigned(parsed);
+    return true;
+}
+
+bool parseOptions(int argc, char* argv[], Batch_Options& options) {
+
+    for (int i = 1; i < argc; i++) {
+
+        std::string flag = argv[i];
+
+        // flags and how many values follow them
+        int values = flag == "--region" ? 4 : flag == "--range" ? 2 : 1;
+        if (i + values >= argc) {
+            std::cout << "ERROR::BATCH::MISSING_VALUE\n\t" << flag << "\n";
+            return false;
+        }
+
+        bool valid = true;
+        int number = 0;
+
+        if (flag == "--seed") {
+            valid = parseUnsigned(argv[i + 1], options.seed);
+        } else if (flag == "--hash") {
+            number = findName(argv[i + 1], HASH_TYPE_COUNT, hashTypeName);
+            valid = number >= 0;
+            options.hashType = Hash_Type(number);
+        } else if (flag == "--type") {
+            number = findName(argv[i + 1], NOISE_TYPE_COUNT, noiseTypeName);
+            valid = number >= 0;
+            options.type = Noise_Type(number);
+        } else if (flag == "--basis") {
+            number = findName(argv[i + 1], NOISE_BASIS_COUNT, noiseBasisName);
+            valid = number >= 0;
+            options.basisType = Noise_Basis(number);
+        } else if (flag == "--time") {
+            valid = parseFloat(argv[i + 1], options.timeOffset);
+        } else if (flag == "--region") {
+            valid = parseInt(argv[i + 1], options.first.x) && parseInt(argv[i + 2], options.first.y) &&
+                    parseInt(argv[i + 3], options.last.x) && parseInt(argv[i + 4], options.last.y) &&
+                    options.first.x <= options.last.x && options.first.y <= options.last.y;
+        } else if (flag == "--tile-res") {
+            valid = parseInt(argv[i + 1], options.tileRes) && options.tileRes > 0;
+        } else if (flag == "--tex-res") {
+            valid = parseInt(argv[i + 1], number) && number > 0;
+            options.texRes = float(number);
+        } else if (flag == "--threads") {
+            valid = parseInt(argv[i + 1], options.threads) && options.threads >= 0;
+        } else if (flag == "--out") {
+            options.outDir = argv[i + 1];
+        } else if (flag == "--map") {
+            options.mapPath = argv[i + 1];
+        } else if (flag == "--format") {
+            number = findName(argv[i + 1], HEIGHTMAP_FORMAT_COUNT, heightmapFormatName);
+            valid = number >= 0;
+            options.mapFormat = Heightmap_Format(number);
+        } else if (flag == "--range") {
+            valid = parseFloat(argv[i + 1], options.minHeight) && parseFloat(argv[i + 2], options.maxHeight) &&
+                    options.minHeight < options.maxHeight;
+        } else {
+            std::cout << "ERROR::BATCH::UNKNOWN_OPTION\n\t" << flag << "\n";
+            return false;
+        }
+
+        if (!valid) {
+            std::cout << "ERROR::BATCH::INVALID_VALUE\n\t" << flag;
+            for (int v = 1; v <= values; v++) {
+                std::cout << " " << argv[i + v];
+            }
+            std::cout << "\n";
+            return false;
+        }
+
+        i += values;
+    }
+
+    return true;
+}
+
+bool writeTile(const std::string& path, const Heightfield& tile) {
+
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(tile.data.data()), std::streamsize(tile.data.size() * sizeof(float)));
+
+    if (!file) {
+        std::cout << "ERROR::BATCH::FILE_NOT_WRITTEN\n\t" << path << "\n";
+        return false;
+    }
+    return true;
+}
+
+// the region as one map, a band of tile rows at a time from the top. Each band
+// is generated across the pool while the writer thread streams out the one before
+int bakeMap(const Batch_Options& options, const Noise& noise, JobPool& pool) {
+
+    const int tilesAcross = options.last.x - options.first.x + 1;
+    const int bandCount = options.last.y - options.first.y + 1;
+    const int mapWidth = tilesAcross * options.tileRes;
+    const int mapHeight = bandCount * options.tileRes;
+    const int rowBlocks = (options.tileRes + HEIGHTFIELD_TILE_SIZE - 1) / HEIGHTFIELD_TILE_SIZE;
+    const double fileMiB = double(heightmapFileSize(options.mapFormat, mapWidth, mapHeight)) / (1024.0 * 1024.0);
+
+    std::cout << "baking a " << mapWidth << "x" << mapHeight << " " << noiseTypeName(options.type) << " "
+              << heightmapFormatName(options.mapFormat) << " map (" << fileMiB << " MiB) on " << pool.threadCount()
+              << " threads, " << noiseBasisName(options.basisType) << " basis, " << hashTypeName(options.hashType)
+              << " hash, seed " << options.seed << ", into " << options.mapPath << "\n";
+
+    HeightmapWriter map(options.mapPath, options.mapFormat, mapWidth, mapHeight, options.minHeight, options.maxHeight);
+    if (!map.valid) {
+        return -1;
+    }
+
+    std::unique_ptr<Heightfield> bands[2] = { std::make_unique<Heightfield>(mapWidth, options.tileRes),
+                                              std::make_unique<Heightfield>(mapWidth, options.tileRes) };
+
+    std::thread writer;
+    double writeSeconds = 0.0;
+
+    auto start = std::chrono::steady_clock::now();
+    double generateSeconds = 0.0;
+    double lastProgress = 0.0;
+
+    for (int band = 0, current = 0; band < bandCount; band++, current ^= 1) {
+
+        // tile rows from the top, the order map rows are written in
+        const int tileY = options.last.y - band;
+        Heightfield& field = *bands[current];
+        glm::vec2 origin = glm::vec2(float(options.first.x), float(tileY)) * float(options.tileRes) / options.texRes;
+
+        // the band is generated as if it were the whole field, so every texel matches its tile
+        auto generateStart = std::chrono::steady_clock::now();
+        pool.parallelFor(tilesAcross * rowBlocks, [&](int job) {
+
+            int x0 = (job / rowBlocks) * options.tileRes;
+            int y0 = (job % rowBlocks) * HEIGHTFIELD_TILE_SIZE;
+
+            generateHeightfieldRegion(field, noise, options.type, origin, options.texRes,
+                                      x0, y0, options.tileRes, std::min(HEIGHTFIELD_TILE_SIZE, options.tileRes - y0));
+        });
+        generateSeconds += secondsSince(generateStart);
+
+        // the previous band has to be out before the writer can take this one
+        if (writer.joinable()) {
+            writer.join();
+        }
+        if (!map.valid) {
+            break;
+        }
+
+        writer = std::thread([&, current]() {
+            auto writeStart = std::chrono::steady_clock::now();
+            map.writeBand(*bands[current]);
+            writeSeconds += secondsSince(writeStart);
+        });
+
+        double elapsed = secondsSince(start);
+        if (elapsed - lastProgress >= BATCH_PROGRESS_INTERVAL) {
+
+            int generated = band + 1;
+
+            std::cout << "\t" << generated << "/" << bandCount << " tile rows (" << 100 * generated / bandCount << "%)\t"
+                      << double(generated) * mapWidth * options.tileRes / generateSeconds * 1e-6 << " Mtexels/s\t"
+                      << (bandCount - generated) * elapsed / generated << " s left\n";
+            lastProgress = elapsed;
+        }
+    }
+
+    if (writer.joinable()) {
+        writer.join();
+    }
+    if (!map.finish()) {
+        return -1;
+    }
+
+    double seconds = secondsSince(start);
+
+    std::cout << "wrote " << options.mapPath << " in " << seconds << " s, generating at "
+              << double(mapWidth) * mapHeight / std::max(generateSeconds, 1e-9) * 1e-6 << " Mtexels/s, writing at "
+              << fileMiB / std::max(writeSeconds, 1e-9) << " MiB/s\n";
+
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+
+    Batch_Options options;
+    if (argc > 1 && (std::strcmp(argv[1], "-h") == 0 || std::strcmp(argv[1], "--help") == 0)) {
+        printUsage();
+        return 0;
+    }
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return -1;
+    }
+
+    Noise noise(options.timeOffset, options.hashType, options.seed);
+    noise.basisType = options.basisType;
+
+    JobPool pool(options.threads);
+
+    if (!options.mapPath.empty()) {
+        return bakeMap(options, noise, pool);
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(options.outDir, error);
+    if (error) {
+        std::cout << "ERROR::BATCH::DIRECTORY_NOT_CREATED\n\t" << options.outDir << ": " << error.message() << "\n";
+        return -1;
+    }
+
+    std::vector<Tile_Coord> coords;
+    for (int y = options.first.y; y <= options.last.y; y++) {
+        for (int x = options.first.x; x <= options.last.x; x++) {
+            coords.push_back({ x, y });
+        }
+    }
+
+    const int total = int(coords.size());
+    const size_t tileBytes = size_t(options.tileRes) * options.tileRes * sizeof(float);
+    const int waveTiles = std::min(total, pool.threadCount() * BATCH_TILES_PER_THREAD);
+    const int rowBlocks = (options.tileRes + HEIGHTFIELD_TILE_SIZE - 1) / HEIGHTFIELD_TILE_SIZE;
+
+    std::cout << "baking " << total << " " << noiseTypeName(options.type) << " tiles of " << options.tileRes << "x" << options.tileRes
+              << " (" << double(total) * tileBytes / (1024.0 * 1024.0) << " MiB) on " << pool.threadCount()
+              << " threads, " << noiseBasisName(options.basisType) << " basis, " << hashTypeName(options.hashType)
+              << " hash, seed " << options.seed << ", into " << options.outDir << "\n";
+
+    // two waves of tiles, one being generated while the writer thread saves the other
+    std::vector<std::unique_ptr<Heightfield>> waves[2];
+    for (auto& wave : waves) {
+        for (int i = 0; i < waveTiles; i++) {
+            wave.push_back(std::make_unique<Heightfield>(options.tileRes, options.tileRes));
+        }
+    }
+
+    std::thread writer;
+    bool writeFailed = false;
+    int written = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    double generateSeconds = 0.0;
+    double lastProgress = 0.0;
+
+    for (int waveStart = 0, current = 0; waveStart < total; waveStart += waveTiles, current ^= 1) {
+
+        const int count = std::min(waveTiles, total - waveStart);
+        std::vector<std::unique_ptr<Heightfield>>& tiles = waves[current];
+
+        // row blocks of every tile in the wave across the pool, the same split TileCache::request makes
+        auto generateStart = std::chrono::steady_clock::now();
+        pool.parallelFor(count * rowBlocks, [&](int job) {
+
+            int tile = job / rowBlocks;
+            int y0 = (job % rowBlocks) * HEIGHTFIELD_TILE_SIZE;
+            Tile_Coord coord = coords[waveStart + tile];
+            glm::vec2 origin = glm::vec2(float(coord.x), float(coord.y)) * float(options.tileRes) / options.texRes;
+
+            generateHeightfieldRegion(*tiles[tile], noise, options.type, origin, options.texRes,
+                                      0, y0, options.tileRes, std::min(HEIGHTFIELD_TILE_SIZE, options.tileRes - y0));
+        });
+        generateSeconds += secondsSince(generateStart);
+
+        // the previous wave has to be on disk before its buffers are generated into again
+        if (writer.joinable()) {
+            writer.join();
+        }
+        if (writeFailed) {
+            break;
+        }
+
+        writer = std::thread([&, waveStart, count, current]() {
+            for (int i = 0; i < count && !writeFailed; i++) {
+                Tile_Coord coord = coords[waveStart + i];
+                std::string path = options.outDir + "/tile_" + std::to_string(coord.x) + "_" + std::to_string(coord.y) + ".r32";
+                writeFailed = !writeTile(path, *waves[current][i]);
+            }
+            if (!writeFailed) {
+                written = waveStart + count;
+            }
+        });
+
+        double elapsed = secondsSince(start);
+        if (elapsed - lastProgress >= BATCH_PROGRESS_INTERVAL) {
+
+            int generated = waveStart + count;
+            double texels = double(generated) * options.tileRes * options.tileRes;
+
+            std::cout << "\t" << generated << "/" << total << " tiles (" << 100 * generated / total << "%)\t"
+                      << texels / generateSeconds * 1e-6 << " Mtexels/s\t" << (total - generated) * elapsed / generated
+                      << " s left\n";
+            lastProgress = elapsed;
+        }
+    }
+
+    if (writer.joinable()) {
+        writer.join();
+    }
+
+    double seconds = secondsSince(start);
+    double texels = double(written) * options.tileRes * options.tileRes;
+
+    std::cout << "wrote " << written << "/" << total << " tiles in " << seconds << " s, generating at "
+              << texels / std::max(generateSeconds, 1e-9) * 1e-6 << " Mtexels/s, overall "
+              << texels / seconds * 1e-6 << " Mtexels/s and " << double(written) * tileBytes / seconds / (1024.0 * 1024.0) << " MiB/s\n";
+
+    return writeFailed ? -1 : 0;
+}
@@ -0,0 +1,805 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "cdlod.hpp"
+#include "clipmap.hpp"
+#include "diamond_square.hpp"
+#include "droplet_erosion.hpp"
+#include "height_bounds.hpp"
+#include "height_query.hpp"
+#include "heightfield.hpp"
+#include "heightmap_export.hpp"
+#include "job_pool.hpp"
+#include "noise.hpp"
+#include "normal_map.hpp"
+#include "pipe_erosion.hpp"
+#include "simd.hpp"
+#include "thermal_erosion.hpp"
+#include "toroidal.hpp"
+
+// terrain-gen-bench [resolution]
+// times the CPU generation paths, resolution defaults to the same TEX_RES as main.cpp
+
+#define DEFAULT_RES 4096
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void benchPerlinKernels(int res) {
+
+    std::cout << "perlin kernel, " << res << "x" << res << " samples at fbm base frequency\n";
+
+    std::vector<float> xs(res), ys(res), out(res);
+    for (int x = 0; x < res; x++) {
+        xs[x] = (float(x) + 0.5f) / float(res) * 4.0f;
+    }
+
+    Noise noise;
+    double scalarSeconds = 0.0;
+
+    for (int t = 0; t < SIMD_TARGET_COUNT; t++) {
+
+        if (!simdTargetSupported(Simd_Target(t))) {
+            std::cout << "\t" << simdTargetName(Simd_Target(t)) << "\tunsupported\n";
+            continue;
+        }
+
+        noise.simdTarget = Simd_Target(t);
+        auto start = std::chrono::steady_clock::now();
+
+        for (int y = 0; y < res; y++) {
+            ys.assign(res, (float(y) + 0.5f) / float(res) * 4.0f);
+            noise.perlinBatch(xs.data(), ys.data(), out.data(), res);
+        }
+
+        double seconds = secondsSince(start);
+        if (t == SIMD_SCALAR) {
+            scalarSeconds = seconds;
+        }
+
+        std::cout << "\t" << simdTargetName(Simd_Target(t)) << "\t" << seconds << " s\t"
+                  << double(res) * res / seconds * 1e-6 << " Msamples/s\t"
+                  << scalarSeconds / seconds << "x scalar\n";
+    }
+}
+
+void benchFbmTile(int res) {
+
+    std::cout << "fbm tile, " << res << "x" << res << ", " << simdTargetName(detectSimdTarget()) << "\n";
+
+    Noise noise;
+    Heightfield field(res, res);
+
+    auto start = std::chrono::steady_clock::now();
+    generateHeightfield(field, noise, NOISE_FBM, glm::vec2(0.0f), float(res));
+    double seconds = secondsSince(start);
+
+    std::cout << "\t" << seconds << " s\t" << double(res) * res / seconds * 1e-6 << " Msamples/s\n";
+}
+
+// perlin vs simplex per simd target, single octaves and then the NOISE_OCTAVES fractals built on each
+void benchNoiseBasis(int res) {
+
+    std::cout << "noise basis, " << res << "x" << res << " tile, " << NOISE_OCTAVES << " octaves\n";
+
+    Noise noise;
+    Heightfield field(res, res);
+    std::vector<float> xs(res), ys(res), out(res);
+    for (int x = 0; x < res; x++) {
+        xs[x] = (float(x) + 0.5f) / float(res) * 4.0f;
+    }
+
+    const char* basisNames[NOISE_BASIS_COUNT] = { "perlin", "simplex" };
+    Noise_Type types[2] = { NOISE_FBM, NOISE_RIDGE };
+    const char* typeNames[2] = { "fbm", "ridge" };
+
+    for (int t = 0; t < SIMD_TARGET_COUNT; t++) {
+
+        if (!simdTargetSupported(Simd_Target(t))) {
+            continue;
+        }
+
+        noise.simdTarget = Simd_Target(t);
+        double perlinSeconds[3] = {};
+
+        for (int b = 0; b < NOISE_BASIS_COUNT; b++) {
+
+            noise.basisType = Noise_Basis(b);
+
+            auto start = std::chrono::steady_clock::now();
+            for (int y = 0; y < res; y++) {
+                ys.assign(res, (float(y) + 0.5f) / float(res) * 4.0f);
+                noise.basisBatch(xs.data(), ys.data(), out.data(), res);
+            }
+            double seconds[3] = { secondsSince(start) };
+
+            for (int type = 0; type < 2; type++) {
+                start = std::chrono::steady_clock::now();
+                generateHeightfield(field, noise, types[type], glm::vec2(0.0f), float(res));
+                seconds[type + 1] = secondsSince(start);
+            }
+
+            for (int i = 0; i < 3; i++) {
+                if (b == NOISE_BASIS_PERLIN) {
+                    perlinSeconds[i] = seconds[i];
+                }
+                std::cout << "\t" << simdTargetName(Simd_Target(t)) << "\t" << basisNames[b] << "\t" << (i == 0 ? "octave" : typeNames[i - 1])
+                          << "\t" << seconds[i] << " s\t" << double(res) * res / seconds[i] * 1e-6 << " Msamples/s\t"
+                          << perlinSeconds[i] / seconds[i] << "x perlin\n";
+            }
+        }
+    }
+}
+
+// worley per simd target, with fbm alongside for scale
+void benchWorley(int res) {
+
+    std::cout << "worley, " << res << "x" << res << " tile\n";
+
+    Noise noise;
+    Heightfield field(res, res);
+    Noise_Type types[4] = { NOISE_FBM, NOISE_VORONOI, NOISE_VORONOI_F2, NOISE_VORONOI_F2_MINUS_F1 };
+    const char* typeNames[4] = { "fbm", "F1", "F2", "F2-F1" };
+
+    for (int t = 0; t < SIMD_TARGET_COUNT; t++) {
+
+        if (!simdTargetSupported(Simd_Target(t))) {
+            continue;
+        }
+
+        noise.simdTarget = Simd_Target(t);
+
+        for (int type = 0; type < 4; type++) {
+
+            auto start = std::chrono::steady_clock::now();
+            generateHeightfield(field, noise, types[type], glm::vec2(0.0f), float(res));
+            double seconds = secondsSince(start);
+
+            std::cout << "\t" << simdTargetName(Simd_Target(t)) << "\t" << typeNames[type] << "\t" << seconds << " s\t"
+                      << double(res) * res / seconds * 1e-6 << " Msamples/s\n";
+        }
+    }
+}
+
+void benchThreadScaling(int res) {
+
+    int maxThreads = int(std::thread::hardware_concurrency());
+    if (maxThreads < 1) {
+        maxThreads = 1;
+    }
+
+    std::cout << "tiled generation, " << res << "x" << res << ", " << HEIGHTFIELD_TILE_SIZE << "x" << HEIGHTFIELD_TILE_SIZE
+              << " tiles, up to " << maxThreads << " threads\n";
+
+    Noise noise;
+    Heightfield field(res, res);
+    Noise_Type types[3] = { NOISE_FBM, NOISE_RIDGE, NOISE_DOMAIN_WARP_FBM };
+    const char* typeNames[3] = { "fbm", "ridge", "domainWarpFBM" };
+
+    // powers of two, then the full machine
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < maxThreads; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    for (int t = 0; t < 3; t++) {
+
+        double singleThread = 0.0;
+
+        for (int threads : threadCounts) {
+
+            JobPool pool(threads);
+
+            auto start = std::chrono::steady_clock::now();
+            generateHeightfieldTiled(field, noise, types[t], glm::vec2(0.0f), float(res), pool);
+            double seconds = secondsSince(start);
+
+            double msamples = double(res) * res / seconds * 1e-6;
+            if (threads == 1) {
+                singleThread = msamples;
+            }
+
+            std::cout << "\t" << typeNames[t] << "\t" << threads << " threads\t" << msamples << " Msamples/s\t"
+                      << msamples / threads << " per thread\t" << msamples / singleThread / threads * 100.0 << "% scaling\n";
+        }
+    }
+}
+
+void benchToroidalScroll(int res) {
+
+    std::cout << "toroidal scroll, " << res << "x" << res << " ridge window\n";
+
+    Noise noise;
+    JobPool pool;
+    ToroidalHeightfield ring(res);
+
+    auto start = std::chrono::steady_clock::now();
+    ring.scroll(glm::ivec2(0), noise, NOISE_RIDGE, float(res), pool);
+    double fullSeconds = secondsSince(start);
+    std::cout << "\tfull window\t" << fullSeconds * 1000.0 << " ms\n";
+
+    int speeds[3] = { 1, 8, 64 };
+    int steps = 16;
+
+    for (int speed : speeds) {
+
+        start = std::chrono::steady_clock::now();
+        for (int i = 1; i <= steps; i++) {
+            ring.scroll(glm::ivec2(i * speed, i * speed / 2), noise, NOISE_RIDGE, float(res), pool);
+        }
+        double seconds = secondsSince(start) / steps;
+
+        std::cout << "\t" << speed << " texels/step\t" << seconds * 1000.0 << " ms/step\t"
+                  << fullSeconds / seconds << "x faster than full\n";
+    }
+}
+
+void benchDropletErosion(int res) {
+
+    int maxThreads = int(std::thread::hardware_concurrency());
+    if (maxThreads < 1) {
+        maxThreads = 1;
+    }
+
+    Erosion_Params params;
+
+    std::cout << "droplet erosion, " << res << "x" << res << " ridge, " << params.dropletCount << " droplets\n";
+
+    Noise noise;
+    JobPool generatePool;
+    Heightfield source(res, res);
+    generateHeightfieldTiled(source, noise, NOISE_RIDGE, glm::vec2(0.0f), float(res), generatePool);
+
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < maxThreads; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    for (int deterministic = 1; deterministic >= 0; deterministic--) {
+
+        params.deterministic = deterministic != 0;
+        std::vector<float> firstResult;
+        bool reproducible = true;
+
+        for (int threads : threadCounts) {
+
+            JobPool pool(threads);
+            Heightfield field = source;
+
+            auto start = std::chrono::steady_clock::now();
+            erodeDroplets(field, params, pool);
+            double seconds = secondsSince(start);
+
+            if (firstResult.empty()) {
+                firstResult = field.data;
+            } else if (field.data != firstResult) {
+                reproducible = false;
+            }
+
+            std::cout << "\t" << (deterministic ? "deterministic" : "atomic") << "\t" << threads << " threads\t"
+                      << seconds << " s\t" << double(params.dropletCount) / seconds * 1e-6 << " Mdroplets/s\n";
+        }
+
+        std::cout << "\t" << (deterministic ? "deterministic" : "atomic") << " output "
+                  << (reproducible ? "identical" : "differs") << " across thread counts\n";
+    }
+}
+
+void benchPipeErosion(int res) {
+
+    const int iterations = 20;
+    Pipe_Erosion_Params params;
+
+    std::cout << "pipe erosion, " << res << "x" << res << " ridge, " << iterations << " iterations\n";
+
+    Noise noise;
+    JobPool pool;
+    Heightfield source(res, res);
+    generateHeightfieldTiled(source, noise, NOISE_RIDGE, glm::vec2(0.0f), float(res), pool);
+
+    std::vector<float> firstResult;
+    bool identical = true;
+
+    for (int t = 0; t < SIMD_TARGET_COUNT; t++) {
+
+        if (!simdTargetSupported(Simd_Target(t))) {
+            continue;
+        }
+
+        PipeErosion erosion(res, res);
+        erosion.simdTarget = Simd_Target(t);
+        Heightfield field = source;
+
+        auto start = std::chrono::steady_clock::now();
+        erosion.run(field, params, iterations, pool);
+        double seconds = secondsSince(start) / iterations;
+
+        if (firstResult.empty()) {
+            firstResult = field.data;
+        } else if (field.data != firstResult) {
+            identical = false;
+        }
+
+        std::cout << "\t" << simdTargetName(Simd_Target(t)) << "\t" << pool.threadCount() << " threads\t" << seconds * 1000.0
+                  << " ms/iteration\t" << double(res) * res / seconds * 1e-6 << " Mcells/s\n";
+    }
+
+    std::cout << "\toutput " << (identical ? "identical" : "differs") << " across simd targets\n";
+}
+
+// diamond-square against tiled fbm at the same 2^n + 1 size, on one thread and the whole machine
+void benchDiamondSquare(int res) {
+
+    int size = 2;
+    while (size * 2 <= res && size * 2 < DIAMOND_SQUARE_MAX_SIZE) {
+        size *= 2;
+    }
+    size += 1;
+
+    int maxThreads = int(std::thread::hardware_concurrency());
+    if (maxThreads < 1) {
+        maxThreads = 1;
+    }
+
+    std::cout << "diamond-square, " << size << "x" << size << "\n";
+
+    Noise noise;
+    Diamond_Square_Params params;
+    Heightfield field(size, size);
+    std::vector<float> firstResult;
+
+    std::vector<int> threadCounts = { 1 };
+    if (maxThreads > 1) {
+        threadCounts.push_back(maxThreads);
+    }
+
+    for (int threads : threadCounts) {
+
+        JobPool pool(threads);
+
+        auto start = std::chrono::steady_clock::now();
+        generateDiamondSquare(field, params, pool);
+        double seconds = secondsSince(start);
+
+        if (firstResult.empty()) {
+            firstResult = field.data;
+        }
+
+        std::cout << "\tdiamond-square\t" << threads << " threads\t" << seconds << " s\t"
+                  << double(size) * size / seconds * 1e-6 << " Msamples/s"
+                  << (field.data == firstResult ? "" : "\toutput differs from 1 thread") << "\n";
+
+        start = std::chrono::steady_clock::now();
+        generateHeightfieldTiled(field, noise, NOISE_FBM, glm::vec2(0.0f), float(size), pool);
+        seconds = secondsSince(start);
+
+        std::cout << "\tfbm\t\t" << threads << " threads\t" << seconds << " s\t"
+                  << double(size) * size / seconds * 1e-6 << " Msamples/s\n";
+    }
+}
+
+// per simd target on one thread, then the widest target on the whole machine
+void benchNormalMap(int res) {
+
+    int maxThreads = int(std::thread::hardware_concurrency());
+    if (maxThreads < 1) {
+        maxThreads = 1;
+    }
+
+    std::cout << "normal map, " << res << "x" << res << " ridge\n";
+
+    Noise noise;
+    Heightfield field(res, res);
+    NormalMap normals(res, res);
+    std::vector<float> firstResult;
+
+    {
+        JobPool pool;
+        generateHeightfieldTiled(field, noise, NOISE_RIDGE, glm::vec2(0.0f), float(res), pool);
+    }
+
+    Normal_Map_Params params;
+    params.texelSize = 48.0f / float(res);
+
+    auto run = [&](JobPool& pool, Simd_Target target) {
+
+        params.simdTarget = target;
+        const int repeats = 5;
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < repeats; i++) {
+            generateNormalMap(field, normals, params, pool);
+        }
+        double seconds = secondsSince(start) / repeats;
+
+        if (firstResult.empty()) {
+            firstResult = normals.data;
+        }
+
+        std::cout << "	" << simdTargetName(target) << "	" << pool.threadCount() << " threads	" << seconds * 1000.0 << " ms\t"
+                  << double(res) * res / seconds * 1e-6 << " Mtexels/s"
+                  << (normals.data == firstResult ? "" : "\toutput differs from scalar") << "\n";
+    };
+
+    JobPool single(1);
+    for (int t = 0; t < SIMD_TARGET_COUNT; t++) {
+        if (simdTargetSupported(Simd_Target(t))) {
+            run(single, Simd_Target(t));
+        }
+    }
+
+    if (maxThreads > 1) {
+        JobPool pool(maxThreads);
+        run(pool, detectSimdTarget());
+    }
+}
+
+// naive relaxation needs about 16x the passes for every 4x in size, past this it's left out
+#define THERMAL_BENCH_NAIVE_MAX_RES 4096
+
+void benchThermalErosion(int res) {
+
+    std::cout << "thermal erosion, ridge at 1024, 4096 and 16384 up to " << res << "x" << res << "\n";
+
+    Noise noise;
+    JobPool pool;
+
+    for (int size = 1024; size <= res; size *= 4) {
+
+        Heightfield source(size, size);
+        generateHeightfieldTiled(source, noise, NOISE_RIDGE, glm::vec2(0.0f), float(size), pool);
+
+        // the same terrain at every size, so texels keep the angles they have at 4096
+        Thermal_Erosion_Params params;
+        params.heightScale = 512.0f * float(size) / 4096.0f;
+
+        const int passes = 10;
+        for (int t = 0; t < SIMD_TARGET_COUNT; t++) {
+
+            if (!simdTargetSupported(Simd_Target(t))) {
+                continue;
+            }
+
+            Thermal_Erosion_Params passParams = params;
+            passParams.simdTarget = Simd_Target(t);
+            passParams.multigrid = false;
+            passParams.tolerance = 0.0f;
+            passParams.maxIterations = passes;
+            Heightfield field = source;
+
+            auto start = std::chrono::steady_clock::now();
+            erodeThermal(field, passParams, pool);
+            double seconds = secondsSince(start) / passes;
+
+            std::cout << "\t" << size << "\t" << simdTargetName(Simd_Target(t)) << "\t" << seconds * 1000.0 << " ms/pass\t"
+                      << double(size) * size / seconds * 1e-6 << " Mcells/s\n";
+        }
+
+        for (int multigrid = 0; multigrid <= 1; multigrid++) {
+
+            if (!multigrid && size > THERMAL_BENCH_NAIVE_MAX_RES) {
+                std::cout << "\t" << size << "\tnaive\tskipped\n";
+                continue;
+            }
+
+            params.multigrid = multigrid != 0;
+            Heightfield field = source;
+
+            auto start = std::chrono::steady_clock::now();
+            Thermal_Erosion_Stats stats = erodeThermal(field, params, pool);
+            double seconds = secondsSince(start);
+
+            std::cout << "\t" << size << "\t" << (multigrid ? "multigrid" : "naive") << "\t" << stats.levels << " levels\t"
+                      << stats.fineIterations << " full res passes\t" << stats.workIterations << " passes of work\t"
+                      << stats.maxExcess << " max excess\t" << seconds << " s\n";
+        }
+    }
+}
+
+void benchClipmapScroll() {
+
+    std::cout << "clipmap scroll, ridge, main.cpp's level size at 8, 12 and 16 levels\n";
+
+    Noise noise;
+    JobPool pool;
+
+    for (int levels = 8; levels <= 16; levels += 4) {
+
+        Clipmap_Params params;
+        params.levels = levels;
+        Clipmap clipmap(NOISE_RIDGE, params);
+
+        float reach = 0.5f * float(params.gridQuads) * float(1 << (levels - 1)) / params.texRes;
+
+        auto start = std::chrono::steady_clock::now();
+        clipmap.update(glm::vec2(0.0f), noise, pool);
+        double fullSeconds = secondsSince(start);
+
+        std::cout << "	" << levels << " levels\treaching " << reach << " st\t" << clipmap.memoryBytes() / 1024 << " KiB\t"
+                  << fullSeconds * 1000.0 << " ms full\n";
+
+        // level 0 texels the eye moves per frame
+        for (float speed : { 1.0f, 8.0f, 64.0f }) {
+
+            const int frames = 256;
+            size_t texels = 0;
+            glm::vec2 eye(0.0f);
+
+            start = std::chrono::steady_clock::now();
+            for (int i = 0; i < frames; i++) {
+                eye += glm::vec2(speed, 0.5f * speed) / params.texRes;
+                for (const Clipmap_Rect& update : clipmap.update(eye, noise, pool)) {
+                    texels += size_t(update.rect.width) * update.rect.height;
+                }
+            }
+            double seconds = secondsSince(start) / frames;
+
+            std::cout << "\t\t" << speed << " texels/frame\t" << texels / frames << " generated/frame\t"
+                      << seconds * 1000.0 << " ms/frame\n";
+        }
+    }
+}
+
+void benchHeightQuery(int res) {
+
+    int maxThreads = int(std::thread::hardware_concurrency());
+    if (maxThreads < 1) {
+        maxThreads = 1;
+    }
+
+    std::cout << "height queries, " << res << "x" << res << " ridge\n";
+
+    Noise noise;
+    Heightfield field(res, res);
+    HeightBounds bounds(res, res);
+
+    {
+        JobPool pool;
+        generateHeightfieldTiled(field, noise, NOISE_RIDGE, glm::vec2(0.0f), float(res), pool);
+        bounds.build(field, pool);
+    }
+
+    // scattered points, the worst case for the cache
+    const int count = 1 << 22;
+    std::vector<glm::vec2> points(count);
+    std::vector<float> heights(count);
+    unsigned int state = 1;
+    for (glm::vec2& point : points) {
+        state = state * 1664525u + 1013904223u;
+        point.x = float(state >> 8) / float(1 << 24) * res;
+        state = state * 1664525u + 1013904223u;
+        point.y = float(state >> 8) / float(1 << 24) * res;
+    }
+
+    HeightQuery query(field, &bounds, true);
+
+    auto start = std::chrono::steady_clock::now();
+    query.heights(points.data(), heights.data(), count);
+    double seconds = secondsSince(start);
+    std::cout << "\tbatched\t1 thread\t" << count / seconds * 1e-6 << " M samples/s\n";
+
+    if (maxThreads > 1) {
+        JobPool pool(maxThreads);
+        start = std::chrono::steady_clock::now();
+        query.heights(points.data(), heights.data(), count, pool);
+        seconds = secondsSince(start);
+        std::cout << "\tbatched\t" << pool.threadCount() << " threads\t" << count / seconds * 1e-6 << " M samples/s\n";
+    }
+
+    // near horizontal rays from just above the highest peak, so most travel a long way before they hit
+    HeightQuery exhaustive(field, nullptr, true);
+    const float peak = bounds.cell(bounds.levelCount() - 1, 0, 0).y;
+
+    for (const HeightQuery* rayQuery : { &exhaustive, &query }) {
+
+        const int rays = 2000;
+        int hits = 0;
+        double travelled = 0.0;
+
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rays; i++) {
+            glm::vec2 from = points[i];
+            float angle = float(i) * 2.39996f;
+            glm::vec3 direction = glm::vec3(std::cos(angle), -0.002f, std::sin(angle));
+
+            Height_Hit hit;
+            if (rayQuery->raycast(glm::vec3(from.x, peak + 0.01f, from.y), direction, float(res), hit)) {
+                hits++;
+                travelled += hit.distance;
+            }
+        }
+        seconds = secondsSince(start);
+
+        std::cout << "\traycast\t" << (rayQuery == &query ? "max hierarchy" : "every texel") << "\t"
+                  << rays / seconds * 1e-3 << " k rays/s\t" << hits << " hits, " << travelled / std::max(hits, 1)
+                  << " texels on average\n";
+    }
+}
+
+void benchCdlodSelect() {
+
+    std::cout << "cdlod selection, main.cpp's finest quad over terrains 1x, 16x and 256x as wide\n";
+
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 100000.0f);
+
+    for (int extraLevels = 0; extraLevels <= 8; extraLevels += 4) {
+
+        Cdlod_Params params;
+        params.size = 48.0f * float(1 << extraLevels);
+        params.levels = 7 + extraLevels;
+
+        CdlodQuadtree lod(params);
+
+        // a plain grid with the finest quad everywhere
+        double finestQuads = double(params.nodeQuads) * (1 << (params.levels - 1));
+        double gridTriangles = finestQuads * finestQuads * 2.0;
+
+        for (float eyeHeight : { 3.0f, 30.0f, 300.0f }) {
+
+            glm::vec3 eye(0.0f, eyeHeight, 0.0f);
+            glm::mat4 view = glm::lookAt(eye, eye + glm::vec3(0.8f, -0.5f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+            const int repeats = 1000;
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < repeats; i++) {
+                lod.select(eye, projection * view);
+            }
+            double seconds = secondsSince(start) / repeats;
+
+            std::cout << "\t" << params.size << " wide\t" << eyeHeight << " up\t" << lod.patches.size() << " patches\t"
+                      << lod.triangleCount() << " triangles (" << gridTriangles << " as a grid)\t" << seconds * 1e6 << " us\n";
+        }
+    }
+}
+
+void benchHeightBounds(int res) {
+
+    int maxThreads = int(std::thread::hardware_concurrency());
+    if (maxThreads < 1) {
+        maxThreads = 1;
+    }
+
+    std::cout << "height bounds, " << res << "x" << res << " ridge\n";
+
+    Noise noise;
+    Heightfield field(res, res);
+    HeightBounds bounds(res, res);
+
+    {
+        JobPool pool;
+        generateHeightfieldTiled(field, noise, NOISE_RIDGE, glm::vec2(0.0f), float(res), pool);
+    }
+
+    // one TileStreamer sized tile rewritten against a full rebuild
+    const int tileRes = std::min(512, res);
+    Heightfield tile(tileRes, tileRes);
+    generateHeightfieldRegion(tile, noise, NOISE_RIDGE, glm::vec2(0.0f), float(res), 0, 0, tileRes, tileRes);
+
+    auto run = [&](JobPool& pool) {
+
+        const int repeats = 5;
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < repeats; i++) {
+            bounds.build(field, pool);
+        }
+        double buildSeconds = secondsSince(start) / repeats;
+
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < repeats; i++) {
+            bounds.update(tile, 0, 0, pool);
+        }
+        double updateSeconds = secondsSince(start) / repeats;
+
+        std::cout << "\t" << pool.threadCount() << " threads\tbuild " << buildSeconds * 1000.0 << " ms\t"
+                  << double(res) * res / buildSeconds * 1e-6 << " Mtexels/s\t" << tileRes << "x" << tileRes
+                  << " tile update " << updateSeconds * 1000.0 << " ms\n";
+    };
+
+    JobPool single(1);
+    run(single);
+
+    if (maxThreads > 1) {
+        JobPool pool(maxThreads);
+        run(pool);
+    }
+
+    // regions the size of main.cpp's CDLOD nodes, from the finest down to the whole field
+    for (int extent = 64; extent <= res; extent *= 8) {
+
+        const int queries = 1000000;
+        float sink = 0.0f;
+        unsigned int state = 1;
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < queries; i++) {
+            state = state * 1664525u + 1013904223u;
+            glm::ivec2 first = glm::ivec2(int((state >> 8) % unsigned(res)), int((state >> 20) * 7u % unsigned(res)));
+            glm::vec2 range = bounds.regionBounds(first, first + extent, true);
+            sink += range.y - range.x;
+        }
+        double seconds = secondsSince(start);
+
+        std::cout << "\t" << extent << " texel regions\t" << queries / seconds * 1e-6 << " M queries/s"
+                  << (sink < 0.0f ? "\tinverted range" : "") << "\n";
+    }
+}
+
+// file throughput of each export format, the field streamed out a band of rows
+// at a time the way terrain-gen-batch writes maps
+void benchHeightmapExport(int res) {
+
+    std::cout << "heightmap export, " << res << "x" << res << " ridge\n";
+
+    Noise noise;
+    Heightfield field(res, res);
+    {
+        JobPool pool;
+        generateHeightfieldTiled(field, noise, NOISE_RIDGE, glm::vec2(0.0f), float(res), pool);
+    }
+
+    for (int format = 0; format < HEIGHTMAP_FORMAT_COUNT; format++) {
+
+        Heightmap_Format heightmapFormat = Heightmap_Format(format);
+        std::filesystem::path path = std::filesystem::temp_directory_path() /
+                                     (std::string("terrain-gen-bench.") + heightmapFormatName(heightmapFormat));
+
+        const int repeats = 3;
+        bool written = true;
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < repeats; i++) {
+            written = exportHeightmap(path.string(), heightmapFormat, field) && written;
+        }
+        double seconds = secondsSince(start) / repeats;
+
+        std::error_code error;
+        std::filesystem::remove(path, error);
+
+        double megabytes = double(heightmapFileSize(heightmapFormat, res, res)) / (1024.0 * 1024.0);
+        std::cout << "\t" << heightmapFormatName(heightmapFormat) << "\t" << megabytes << " MiB in " << seconds * 1000.0
+                  << " ms\t" << megabytes / seconds << " MiB/s\t" << double(res) * res / seconds * 1e-6 << " Mtexels/s"
+                  << (written ? "" : "\tfailed") << "\n";
+    }
+}
+
+int main(int argc, char* argv[]) {
+
+    int res = argc > 1 ? std::atoi(argv[1]) : DEFAULT_RES;
+    if (res <= 0) {
+        std::cout << "usage: terrain-gen-bench [resolution]\n";
+        return -1;
+    }
+
+    benchPerlinKernels(res);
+    benchFbmTile(res);
+    benchNoiseBasis(res);
+    benchWorley(res);
+    benchDiamondSquare(res);
+    benchThreadScaling(res);
+    benchToroidalScroll(res);
+    benchDropletErosion(res);
+    benchPipeErosion(res);
+    benchThermalErosion(res);
+    benchNormalMap(res);
+    benchHeightBounds(res);
+    benchHeightQuery(res);
+    benchHeightmapExport(res);
+    benchCdlodSelect();
+    benchClipmapScroll();
+
+    return 0;
+}
@@ -1,6 +1,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <algorithm>
 #include <iostream>
 
 #include "camera.hpp"
@@ -50,6 +51,10 @@ void Camera::ProcessKeyboard(Camera_Movement DIRECTION, float deltaTime) {
     }
 }
 
+void Camera::KeepAbove(float groundHeight) {
+    pos.y = std::max(pos.y, groundHeight + GROUND_CLEARANCE);
+}
+
 void Camera::ProcessMouse(double xpos, double ypos) {
 
     if (firstMouse) {
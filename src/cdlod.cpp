@@ -0,0 +1,174 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include <glm/glm.hpp>
+
+#include "cdlod.hpp"
+
+CdlodQuadtree::CdlodQuadtree(const Cdlod_Params& paramsIn) {
+
+    params = paramsIn;
+
+    heightBounds = nullptr;
+    boundsUvOffset = glm::vec2(0.0f);
+    boundsUvScale = 1.0f;
+    boundsFloor = 0.0f;
+
+    if (params.levels < 1 || params.levels > CDLOD_MAX_LEVELS || params.nodeQuads < 4 || params.nodeQuads % 4 != 0) {
+        std::cout << "ERROR::CDLOD::INVALID_PARAMS\n\t" << params.levels << " levels, " << params.nodeQuads << " quads per node\n";
+        params.levels = std::min(std::max(params.levels, 1), CDLOD_MAX_LEVELS);
+        params.nodeQuads = std::max(4, (params.nodeQuads + 3) / 4 * 4);
+    }
+
+    params.rangeRatio = std::max(params.rangeRatio, 1.5f);
+    params.morphStartRatio = std::min(std::max(params.morphStartRatio, 0.1f), 0.9f);
+
+    // a node drawn at level L ends where the next coarser level starts, which
+    // is at least ranges[L] away, and the coarser node's vertices there must
+    // not have started morphing yet. Its nearest point is within ranges[L] and
+    // its far edge a diagonal further, so ranges[L] * (ratio - 1) * morphStartRatio
+    // has to cover that diagonal. Diagonals grow as fast as the ranges, level 0 decides
+    const float finestNode = params.size / float(1 << (params.levels - 1));
+    const float minRange = finestNode * std::sqrt(2.0f) / ((params.rangeRatio - 1.0f) * params.morphStartRatio);
+    float range = std::max(params.finestRange, minRange);
+
+    float previous = 0.0f;
+    for (int level = 0; level < params.levels; level++) {
+
+        ranges[level] = range;
+        morphEnd[level] = range;
+        morphStart[level] = previous + (range - previous) * params.morphStartRatio;
+
+        previous = range;
+        range *= params.rangeRatio;
+    }
+}
+
+glm::vec2 CdlodQuadtree::morphConstants(int level) const {
+
+    // the root has nothing coarser to morph into
+    if (level >= params.levels - 1) {
+        return glm::vec2(1.0f, 0.0f);
+    }
+
+    float band = morphEnd[level] - morphStart[level];
+    return glm::vec2(morphEnd[level] / band, 1.0f / band);
+}
+
+void CdlodQuadtree::setHeightBounds(const HeightBounds* bounds, glm::vec2 uvOffset, float uvScale, float floorHeight) {
+    heightBounds = bounds;
+    boundsUvOffset = uvOffset;
+    boundsUvScale = uvScale;
+    boundsFloor = floorHeight;
+}
+
+int CdlodQuadtree::select(glm::vec3 eye, const glm::mat4& viewProjection) {
+
+    // Gribb / Hartmann: each plane is the last row of the matrix plus or minus one of the others
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; i++) {
+        rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    }
+    for (int i = 0; i < 3; i++) {
+        frustumPlanes[2 * i] = rows[3] + rows[i];
+        frustumPlanes[2 * i + 1] = rows[3] - rows[i];
+    }
+
+    patches.clear();
+
+    float half = 0.5f * params.size;
+    selectNode(-half, -half, params.size, params.levels - 1, eye);
+
+    return int(patches.size());
+}
+
+// returns false when the node is beyond its level's range, and the parent has to
+// cover it at its own level. Returns true once the node is handled, drawn or culled
+bool CdlodQuadtree::selectNode(float x, float z, float size, int level, glm::vec3 eye) {
+
+    // the root is always in range, however far away the camera is
+    if (level < params.levels - 1 && !inRange(x, z, size, level, eye)) {
+        return false;
+    }
+
+    if (!inFrustum(x, z, size)) {
+        return true;
+    }
+
+    const float half = 0.5f * size;
+
+    // all of it at this level when no finer one reaches it
+    if (level == 0 || !inRange(x, z, size, level - 1, eye)) {
+        for (int i = 0; i < 4; i++) {
+            addQuarter(x + float(i & 1) * half, z + float(i >> 1) * half, size, level);
+        }
+        return true;
+    }
+
+    // otherwise the children take what they can, the rest is drawn here a quarter at a time
+    for (int i = 0; i < 4; i++) {
+
+        float childX = x + float(i & 1) * half;
+        float childZ = z + float(i >> 1) * half;
+
+        if (!selectNode(childX, childZ, half, level - 1, eye)) {
+            addQuarter(childX, childZ, size, level);
+        }
+    }
+
+    return true;
+}
+
+void CdlodQuadtree::addQuarter(float x, float z, float nodeSize, int level) {
+    patches.push_back({ x, z, nodeSize / float(params.nodeQuads), float(level) });
+}
+
+// whether the square, flat on the LOD plane, comes within ranges[level] of eye
+bool CdlodQuadtree::inRange(float x, float z, float size, int level, glm::vec3 eye) const {
+
+    float dx = std::max(std::max(x - eye.x, eye.x - (x + size)), 0.0f);
+    float dz = std::max(std::max(z - eye.z, eye.z - (z + size)), 0.0f);
+    float dy = eye.y - lodHeight();
+
+    return dx * dx + dy * dy + dz * dz <= ranges[level] * ranges[level];
+}
+
+// world y range under the node, from every texel its vertices can sample
+glm::vec2 CdlodQuadtree::nodeHeights(float x, float z, float size) const {
+
+    if (!heightBounds) {
+        return glm::vec2(params.minHeight, params.maxHeight);
+    }
+
+    glm::vec2 texSize = glm::vec2(float(heightBounds->width), float(heightBounds->height));
+    glm::vec2 uvFirst = (glm::vec2(x, z) / params.size + 0.5f) * boundsUvScale + boundsUvOffset;
+    glm::vec2 uvLast = (glm::vec2(x + size, z + size) / params.size + 0.5f) * boundsUvScale + boundsUvOffset;
+
+    // bilinear filtering reads the texel centres either side
+    glm::ivec2 first = glm::ivec2(glm::floor(uvFirst * texSize - 0.5f));
+    glm::ivec2 last = glm::ivec2(glm::floor(uvLast * texSize - 0.5f)) + 1;
+
+    glm::vec2 range = glm::max(heightBounds->regionBounds(first, last, true), boundsFloor);
+    return params.minHeight + range * (params.maxHeight - params.minHeight);
+}
+
+// box of the node over its height range against every frustum plane, only the
+// corner furthest along the plane normal has to be checked
+bool CdlodQuadtree::inFrustum(float x, float z, float size) const {
+
+    glm::vec2 heights = nodeHeights(x, z, size);
+
+    for (const glm::vec4& plane : frustumPlanes) {
+
+        glm::vec3 corner = glm::vec3(plane.x >= 0.0f ? x + size : x,
+                                     plane.y >= 0.0f ? heights.y : heights.x,
+                                     plane.z >= 0.0f ? z + size : z);
+
+        if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f) {
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,67 @@
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "clipmap.hpp"
+#include "job_pool.hpp"
+#include "noise.hpp"
+#include "toroidal.hpp"
+
+Clipmap::Clipmap(Noise_Type typeIn, const Clipmap_Params& paramsIn) {
+
+    params = paramsIn;
+    type = typeIn;
+
+    if (params.levels < 1 || params.levels > CLIPMAP_MAX_LEVELS || params.gridQuads < 6 || params.gridQuads % 4 != 2) {
+        std::cout << "ERROR::CLIPMAP::INVALID_PARAMS\n\t" << params.levels << " levels, " << params.gridQuads << " quads per side\n";
+        params.levels = std::min(std::max(params.levels, 1), CLIPMAP_MAX_LEVELS);
+        params.gridQuads = std::max(6, params.gridQuads / 4 * 4 + 2);
+    }
+
+    // gridQuads + 1 vertices and a texel either side for the normals
+    texSize = 1;
+    while (texSize < params.gridQuads + 3) {
+        texSize *= 2;
+    }
+
+    levels.reserve(params.levels);
+    for (int level = 0; level < params.levels; level++) {
+        levels.emplace_back(texSize);
+        levels.back().texelOffset = 0.0f;
+        gridOrigins[level] = glm::ivec2(0);
+    }
+}
+
+std::vector<Clipmap_Rect> Clipmap::update(glm::vec2 eye, const Noise& noise, JobPool& pool) {
+
+    // level 0 on the even texel that puts the eye nearest its centre, then each
+    // coarser level on the even texel that puts the one inside it holeMin() or
+    // holeMin() + 1 quads in. Even origins keep every level's edges on the next one's grid
+    const int half = params.gridQuads / 2;
+    glm::vec2 eyeTexel = eye * params.texRes;
+
+    gridOrigins[0] = 2 * glm::ivec2(glm::floor((eyeTexel - float(half)) * 0.5f + 0.5f));
+
+    for (int level = 1; level < params.levels; level++) {
+        glm::ivec2 origin = gridOrigins[level - 1] / 2 - holeMin();
+        gridOrigins[level] = origin - (origin & 1);
+    }
+
+    std::vector<Clipmap_Rect> rects;
+
+    for (int level = 0; level < params.levels; level++) {
+        for (const Toroidal_Rect& rect : levels[level].scroll(gridOrigins[level] - 1, noise, type, levelTexRes(level), pool)) {
+            rects.push_back({ level, rect });
+        }
+    }
+
+    return rects;
+}
+
+void Clipmap::invalidate() {
+    for (ToroidalHeightfield& level : levels) {
+        level.invalidate();
+    }
+}
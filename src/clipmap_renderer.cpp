@@ -0,0 +1,187 @@
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "clipmap.hpp"
+#include "clipmap_renderer.hpp"
+#include "shader.hpp"
+
+// the two triangles of every grid quad outside the hole of half the grid at
+// (holeX, holeY), all of them when hole is false
+static void addGridIndices(std::vector<unsigned int>& indices, int quads, bool hole, int holeX, int holeY) {
+
+    const int holeSize = quads / 2;
+
+    for (int j = 0; j < quads; j++) {
+        for (int i = 0; i < quads; i++) {
+
+            if (hole && i >= holeX && i < holeX + holeSize && j >= holeY && j < holeY + holeSize) {
+                continue;
+            }
+
+            unsigned int vertexIndex = j * (quads + 1) + i;
+
+            indices.push_back(vertexIndex);
+            indices.push_back(vertexIndex + quads + 1);
+            indices.push_back(vertexIndex + quads + 2);
+
+            indices.push_back(vertexIndex + quads + 2);
+            indices.push_back(vertexIndex + 1);
+            indices.push_back(vertexIndex);
+        }
+    }
+}
+
+// zero area triangles over every pair of quads along the edge of the grid. A
+// level's edge vertices are blended onto the next coarser level's triangle
+// edges, but T junctions still drop pixels when rasterized, these cover them
+static void addSeamIndices(std::vector<unsigned int>& indices, int quads) {
+
+    auto vertex = [&](int i, int j) { return (unsigned int)(j * (quads + 1) + i); };
+
+    for (int k = 0; k < quads; k += 2) {
+
+        unsigned int edges[4][3] = {
+            { vertex(k, 0), vertex(k + 1, 0), vertex(k + 2, 0) },
+            { vertex(k, quads), vertex(k + 1, quads), vertex(k + 2, quads) },
+            { vertex(0, k), vertex(0, k + 1), vertex(0, k + 2) },
+            { vertex(quads, k), vertex(quads, k + 1), vertex(quads, k + 2) },
+        };
+
+        for (const auto& triangle : edges) {
+            indices.insert(indices.end(), triangle, triangle + 3);
+        }
+    }
+}
+
+ClipmapRenderer::ClipmapRenderer(Noise_Type type, const Clipmap_Params& params) : clipmap(type, params) {
+
+    const int quads = clipmap.params.gridQuads;
+    const int holeMin = clipmap.holeMin();
+
+    std::vector<glm::vec2> grid;
+    for (int j = 0; j <= quads; j++) {
+        for (int i = 0; i <= quads; i++) {
+            grid.push_back(glm::vec2(float(i), float(j)));
+        }
+    }
+
+    std::vector<unsigned int> indices;
+    for (int range = 0; range < 5; range++) {
+        rangeFirst[range] = int(indices.size());
+        addGridIndices(indices, quads, range > 0, holeMin + (range - 1) % 2, holeMin + (range - 1) / 2);
+        rangeCount[range] = int(indices.size()) - rangeFirst[range];
+    }
+
+    rangeFirst[5] = int(indices.size());
+    addSeamIndices(indices, quads);
+    rangeCount[5] = int(indices.size()) - rangeFirst[5];
+
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+
+    glGenBuffers(1, &gridVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, gridVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec2) * grid.size(), grid.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    glGenBuffers(1, &ebo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * indices.size(), indices.data(), GL_STATIC_DRAW);
+    glBindVertexArray(0);
+
+    // texelFetch only, the shader wraps and blends itself
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R32F, clipmap.texSize, clipmap.texSize, clipmap.params.levels, 0, GL_RED, GL_FLOAT, 0);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+ClipmapRenderer::~ClipmapRenderer() {
+    glDeleteTextures(1, &texture);
+    glDeleteBuffers(1, &gridVBO);
+    glDeleteBuffers(1, &ebo);
+    glDeleteVertexArrays(1, &vao);
+}
+
+int ClipmapRenderer::update(glm::vec2 eye, const Noise& noise, JobPool& pool) {
+
+    std::vector<Clipmap_Rect> rects = clipmap.update(eye, noise, pool);
+    if (rects.empty()) {
+        return 0;
+    }
+
+    int uploaded = 0;
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, clipmap.texSize);
+
+    for (const Clipmap_Rect& update : rects) {
+
+        const Toroidal_Rect& rect = update.rect;
+        const Heightfield& field = clipmap.levels[update.level].field;
+
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, rect.x, rect.y, update.level, rect.width, rect.height, 1,
+                        GL_RED, GL_FLOAT, field.row(rect.y) + rect.x);
+
+        uploaded += rect.width * rect.height;
+    }
+
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    return uploaded;
+}
+
+void ClipmapRenderer::setUniforms(Shader& shader, float worldPerSt, int textureUnit) const {
+
+    shader.setInt("clipmapLevels", textureUnit);
+    shader.setInt("clipmapLevelCount", clipmap.params.levels);
+    shader.setInt("clipmapTexSize", clipmap.texSize);
+    shader.setInt("clipmapGridQuads", clipmap.params.gridQuads);
+    shader.setFloat("clipmapSpacing", worldPerSt / clipmap.params.texRes);
+    shader.setFloat("clipmapBlendWidth", clipmap.blendWidth());
+}
+
+int ClipmapRenderer::draw(Shader& shader, glm::vec2 worldOffset) {
+
+    // once a frame, the loop below sets these per level
+    const int levelLoc = shader.getUniformLocation("clipmapLevel");
+    const int originLoc = shader.getUniformLocation("clipmapOrigin");
+    const int worldOffsetLoc = shader.getUniformLocation("clipmapWorldOffset");
+
+    shader.setVec2(worldOffsetLoc, worldOffset);
+
+    glBindVertexArray(vao);
+
+    int triangles = 0;
+
+    for (int level = 0; level < clipmap.params.levels; level++) {
+
+        int range = 0;
+        if (level > 0) {
+            glm::ivec2 hole = clipmap.holeOffset(level) - clipmap.holeMin();
+            range = 1 + hole.x + 2 * hole.y;
+        }
+
+        shader.setInt(levelLoc, level);
+        shader.setIVec2(originLoc, clipmap.gridOrigins[level]);
+
+        glDrawElements(GL_TRIANGLES, rangeCount[range], GL_UNSIGNED_INT, (void*)(sizeof(unsigned int) * rangeFirst[range]));
+        triangles += rangeCount[range] / 3;
+
+        // nothing coarser around the last level to be seamed to
+        if (level < clipmap.params.levels - 1) {
+            glDrawElements(GL_TRIANGLES, rangeCount[5], GL_UNSIGNED_INT, (void*)(sizeof(unsigned int) * rangeFirst[5]));
+        }
+    }
+
+    glBindVertexArray(0);
+
+    return triangles;
+}
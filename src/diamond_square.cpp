@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <functional>
+#include <iostream>
+
+#include "diamond_square.hpp"
+#include "hash.hpp"
+#include "heightfield.hpp"
+#include "job_pool.hpp"
+
+static unsigned int rotateLeft(unsigned int h, int bits) {
+    return (h << bits) | (h >> (32 - bits));
+}
+
+// same mix as the HASH_XXHASH lattice hash in noise.cpp
+static unsigned int texelHash(unsigned int x, unsigned int y, unsigned int seed) {
+
+    unsigned int h = seed + XXHASH_PRIME5 + 8u;
+    h += x * XXHASH_PRIME3;
+    h = rotateLeft(h, 17) * XXHASH_PRIME4;
+    h += y * XXHASH_PRIME3;
+    h = rotateLeft(h, 17) * XXHASH_PRIME4;
+
+    h ^= h >> 15;
+    h *= XXHASH_PRIME2;
+    h ^= h >> 13;
+    h *= XXHASH_PRIME3;
+    h ^= h >> 16;
+    return h;
+}
+
+// [-1, 1) from the top 24 bits
+static float texelOffset(int x, int y, unsigned int seed) {
+    return float(texelHash(unsigned(x), unsigned(y), seed) >> 8) * (2.0f / 16777216.0f) - 1.0f;
+}
+
+// a neighbour index past the edge wraps round when tileable and is -1 (missing) otherwise
+static int wrapNeighbour(int i, int last, bool tileable) {
+
+    if (tileable) {
+        return (i + last) % last;
+    }
+    return i >= 0 && i <= last ? i : -1;
+}
+
+// splits a countX x countY grid of points into DIAMOND_SQUARE_BLOCK squares spread over
+// the pool, small levels run on the calling thread
+static void forEachBlock(JobPool& pool, int countX, int countY, const std::function<void(int, int, int, int)>& block) {
+
+    const int size = DIAMOND_SQUARE_BLOCK;
+    const int blocksX = (countX + size - 1) / size;
+    const int blocksY = (countY + size - 1) / size;
+
+    if (blocksX * blocksY == 1) {
+        block(0, 0, countX, countY);
+        return;
+    }
+
+    pool.parallelFor(blocksX * blocksY, [&](int job) {
+        int x0 = (job % blocksX) * size;
+        int y0 = (job / blocksX) * size;
+        block(x0, y0, std::min(countX, x0 + size), std::min(countY, y0 + size));
+    });
+}
+
+bool generateDiamondSquare(Heightfield& field, const Diamond_Square_Params& params, JobPool& pool) {
+
+    const int size = field.width;
+    const int last = size - 1;
+
+    if (field.height != size || size < DIAMOND_SQUARE_MIN_SIZE || size > DIAMOND_SQUARE_MAX_SIZE || (last & (last - 1)) != 0) {
+        std::cout << "ERROR::DIAMOND_SQUARE::SIZE_NOT_2^N+1\n\t" << field.width << "x" << field.height << '\n';
+        return false;
+    }
+
+    const unsigned int seed = params.seed;
+    const bool tileable = params.tileable;
+
+    // a tileable field only has one corner, the others are its copies
+    field.at(0, 0) = params.base + params.amplitude * texelOffset(0, 0, seed);
+    if (tileable) {
+        field.at(last, 0) = field.at(0, last) = field.at(last, last) = field.at(0, 0);
+    } else {
+        field.at(last, 0) = params.base + params.amplitude * texelOffset(last, 0, seed);
+        field.at(0, last) = params.base + params.amplitude * texelOffset(0, last, seed);
+        field.at(last, last) = params.base + params.amplitude * texelOffset(last, last, seed);
+    }
+
+    float amplitude = params.amplitude;
+
+    for (int step = last; step > 1; step /= 2) {
+
+        const int half = step / 2;
+        const int squares = last / step;
+        amplitude *= params.roughness;
+
+        // diamond step: centre of every square from its four corners
+        forEachBlock(pool, squares, squares, [&](int i0, int j0, int i1, int j1) {
+            for (int j = j0; j < j1; j++) {
+
+                const int y = j * step + half;
+                const float* below = field.row(y - half);
+                const float* above = field.row(y + half);
+                float* row = field.row(y);
+
+                for (int i = i0; i < i1; i++) {
+                    const int x = i * step + half;
+                    float average = (below[x - half] + below[x + half] + above[x - half] + above[x + half]) * 0.25f;
+                    row[x] = average + amplitude * texelOffset(x, y, seed);
+                }
+            }
+        });
+
+        // square step: midpoint of every edge from the two corners along it and
+        // the two centres either side. The midpoints sit on a grid of half
+        // spacing where (i + j) is odd. A tileable field wraps round and only
+        // sets the first last x last texels, the far row and column are copied after
+        const int points = tileable ? 2 * squares : 2 * squares + 1;
+
+        forEachBlock(pool, points, points, [&](int i0, int j0, int i1, int j1) {
+            for (int j = j0; j < j1; j++) {
+
+                const int y = j * half;
+                const int yBelow = wrapNeighbour(y - half, last, tileable);
+                const int yAbove = wrapNeighbour(y + half, last, tileable);
+                const float* below = yBelow >= 0 ? field.row(yBelow) : nullptr;
+                const float* above = yAbove >= 0 ? field.row(yAbove) : nullptr;
+                float* row = field.row(y);
+
+                auto midpoint = [&](int x, int xLeft, int xRight) {
+
+                    float sum = 0.0f;
+                    int count = 0;
+                    if (xLeft >= 0)  { sum += row[xLeft]; count++; }
+                    if (xRight >= 0) { sum += row[xRight]; count++; }
+                    if (below)       { sum += below[x]; count++; }
+                    if (above)       { sum += above[x]; count++; }
+
+                    row[x] = sum / float(count) + amplitude * texelOffset(x, y, seed);
+                };
+
+                for (int i = i0 + ((i0 + j + 1) & 1); i < i1; i += 2) {
+
+                    const int x = i * half;
+                    if (x == 0 || x == last) {
+                        midpoint(x, wrapNeighbour(x - half, last, tileable), wrapNeighbour(x + half, last, tileable));
+                    } else if (!below || !above) {
+                        midpoint(x, x - half, x + half);
+                    } else {
+                        // all four neighbours, / 4 and * 0.25 give the same bits
+                        row[x] = (row[x - half] + row[x + half] + below[x] + above[x]) * 0.25f + amplitude * texelOffset(x, y, seed);
+                    }
+                }
+            }
+        });
+
+        if (tileable) {
+            for (int y = 0; y < last; y += half) {
+                field.at(last, y) = field.at(0, y);
+            }
+            for (int x = 0; x <= last; x += half) {
+                field.at(x, last) = field.at(x, 0);
+            }
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,323 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "droplet_erosion.hpp"
+#include "hash.hpp"
+#include "heightfield.hpp"
+#include "job_pool.hpp"
+
+namespace {
+
+// plain loads and adds, for the tiled schedule where no two threads share texels
+struct Plain_Heights {
+
+    float* data;
+
+    float load(size_t i) const { return data[i]; }
+    void add(size_t i, float delta) const { data[i] += delta; }
+};
+
+// relaxed atomic loads and compare-exchange adds on the float bits, for droplets
+// roaming the whole field at once. Only the sum of deltas is kept exact, which
+// droplet lands first still depends on timing
+struct Atomic_Heights {
+
+    float* data;
+
+    float load(size_t i) const {
+        unsigned int bits = __atomic_load_n((unsigned int*)(data + i), __ATOMIC_RELAXED);
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    void add(size_t i, float delta) const {
+
+        unsigned int* bits = (unsigned int*)(data + i);
+        unsigned int expected = __atomic_load_n(bits, __ATOMIC_RELAXED);
+
+        while (true) {
+            float value;
+            std::memcpy(&value, &expected, sizeof(value));
+            value += delta;
+
+            unsigned int desired;
+            std::memcpy(&desired, &value, sizeof(desired));
+            if (__atomic_compare_exchange_n(bits, &expected, desired, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                return;
+            }
+        }
+    }
+};
+
+struct Brush_Cell {
+    int dx;
+    int dy;
+    float weight;
+};
+
+// texels a droplet may read or write, [x0, x1) x [y0, y1)
+struct Erosion_Region {
+    int x0;
+    int y0;
+    int x1;
+    int y1;
+
+    // the bilinear reads need the texel to the right and above as well
+    bool contains(float x, float y) const {
+        return x >= float(x0) && y >= float(y0) && x < float(x1 - 1) && y < float(y1 - 1);
+    }
+};
+
+struct Droplet_Random {
+
+    unsigned int state;
+
+    Droplet_Random(unsigned int seed, unsigned int stream) {
+        state = seed * XXHASH_PRIME2 ^ stream * XXHASH_PRIME3;
+        next();
+    }
+
+    unsigned int next() {
+        state = state * PCG_MULTIPLIER + PCG_INCREMENT;
+        return state;
+    }
+
+    // [0, 1) from the top 24 bits, the low lcg bits are poor
+    float unit() {
+        return float(next() >> 8) * (1.0f / 16777216.0f);
+    }
+};
+
+}
+
+// weights fall off linearly with distance and sum to 1
+static std::vector<Brush_Cell> buildBrush(int radius) {
+
+    std::vector<Brush_Cell> brush;
+    float total = 0.0f;
+
+    for (int dy = -radius; dy <= radius; dy++) {
+        for (int dx = -radius; dx <= radius; dx++) {
+
+            float dist = std::sqrt(float(dx * dx + dy * dy));
+            if (dist < float(radius)) {
+                brush.push_back({ dx, dy, float(radius) - dist });
+                total += float(radius) - dist;
+            }
+        }
+    }
+
+    for (Brush_Cell& cell : brush) {
+        cell.weight /= total;
+    }
+
+    return brush;
+}
+
+template <typename Heights>
+static float bilinearHeight(const Heights& heights, int width, float x, float y, float& gradX, float& gradY) {
+
+    int nodeX = int(x);
+    int nodeY = int(y);
+    float u = x - float(nodeX);
+    float v = y - float(nodeY);
+
+    size_t index = size_t(nodeY) * width + nodeX;
+    float h00 = heights.load(index);
+    float h10 = heights.load(index + 1);
+    float h01 = heights.load(index + width);
+    float h11 = heights.load(index + width + 1);
+
+    gradX = (h10 - h00) * (1.0f - v) + (h11 - h01) * v;
+    gradY = (h01 - h00) * (1.0f - u) + (h11 - h10) * u;
+
+    return h00 * (1.0f - u) * (1.0f - v) + h10 * u * (1.0f - v) + h01 * (1.0f - u) * v + h11 * u * v;
+}
+
+// takes up to amount from the brush around (nodeX, nodeY), returns how much was actually removed
+template <typename Heights>
+static float erodeBrush(const Heights& heights, int width, const Erosion_Region& region, const std::vector<Brush_Cell>& brush,
+                        int nodeX, int nodeY, float amount) {
+
+    float removed = 0.0f;
+
+    for (const Brush_Cell& cell : brush) {
+
+        int x = nodeX + cell.dx;
+        int y = nodeY + cell.dy;
+        if (x < region.x0 || y < region.y0 || x >= region.x1 || y >= region.y1) {
+            continue;
+        }
+
+        float delta = amount * cell.weight;
+        heights.add(size_t(y) * width + x, -delta);
+        removed += delta;
+    }
+
+    return removed;
+}
+
+template <typename Heights>
+static void simulateDroplet(const Heights& heights, int width, const Erosion_Region& region, const std::vector<Brush_Cell>& brush,
+                            const Erosion_Params& params, float posX, float posY) {
+
+    float dirX = 0.0f;
+    float dirY = 0.0f;
+    float speed = params.initialSpeed;
+    float water = params.initialWater;
+    float sediment = 0.0f;
+
+    // spawn positions can round onto the last texel
+    if (!region.contains(posX, posY)) {
+        return;
+    }
+
+    for (int life = 0; life < params.maxLifetime; life++) {
+
+        int nodeX = int(posX);
+        int nodeY = int(posY);
+        float u = posX - float(nodeX);
+        float v = posY - float(nodeY);
+
+        float gradX, gradY;
+        float height = bilinearHeight(heights, width, posX, posY, gradX, gradY);
+
+        dirX = dirX * params.inertia - gradX * (1.0f - params.inertia);
+        dirY = dirY * params.inertia - gradY * (1.0f - params.inertia);
+
+        float length = std::sqrt(dirX * dirX + dirY * dirY);
+        if (length == 0.0f) {
+            break;
+        }
+        dirX /= length;
+        dirY /= length;
+
+        posX += dirX;
+        posY += dirY;
+
+        if (!region.contains(posX, posY)) {
+            break;
+        }
+
+        float newHeight = bilinearHeight(heights, width, posX, posY, gradX, gradY);
+        float deltaHeight = (newHeight - height) * params.heightScale;
+
+        float capacity = std::max(-deltaHeight * speed * water * params.sedimentCapacity, params.minSedimentCapacity);
+
+        if (sediment > capacity || deltaHeight > 0.0f) {
+
+            // uphill fills the pit behind it, otherwise drop a fraction of the excess
+            float amount = deltaHeight > 0.0f ? std::min(deltaHeight, sediment) : (sediment - capacity) * params.depositSpeed;
+            sediment -= amount;
+
+            float deposit = amount / params.heightScale;
+            size_t index = size_t(nodeY) * width + nodeX;
+            heights.add(index, deposit * (1.0f - u) * (1.0f - v));
+            heights.add(index + 1, deposit * u * (1.0f - v));
+            heights.add(index + width, deposit * (1.0f - u) * v);
+            heights.add(index + width + 1, deposit * u * v);
+
+        } else {
+
+            // never dig deeper than the step just taken, that's what leaves pits
+            float amount = std::min((capacity - sediment) * params.erodeSpeed, -deltaHeight);
+            sediment += erodeBrush(heights, width, region, brush, nodeX, nodeY, amount / params.heightScale) * params.heightScale;
+        }
+
+        speed = std::sqrt(std::max(0.0f, speed * speed - deltaHeight * params.gravity));
+        water *= 1.0f - params.evaporateSpeed;
+    }
+}
+
+void erodeDroplets(Heightfield& field, const Erosion_Params& params, JobPool& pool) {
+
+    if (field.width < 2 || field.height < 2 || params.dropletCount <= 0) {
+        return;
+    }
+
+    const int width = field.width;
+    const std::vector<Brush_Cell> brush = buildBrush(std::max(1, params.radius));
+
+    if (!params.deterministic) {
+
+        Atomic_Heights heights = { field.data.data() };
+        Erosion_Region region = { 0, 0, field.width, field.height };
+        int batches = (params.dropletCount + EROSION_DROPLETS_PER_BATCH - 1) / EROSION_DROPLETS_PER_BATCH;
+
+        pool.parallelFor(batches, [&](int batch) {
+
+            Droplet_Random random(params.seed, unsigned(batch));
+            int count = std::min(EROSION_DROPLETS_PER_BATCH, params.dropletCount - batch * EROSION_DROPLETS_PER_BATCH);
+
+            for (int i = 0; i < count; i++) {
+                float x = random.unit() * float(field.width - 1);
+                float y = random.unit() * float(field.height - 1);
+                simulateDroplet(heights, width, region, brush, params, x, y);
+            }
+        });
+        return;
+    }
+
+    Plain_Heights heights = { field.data.data() };
+
+    const int tile = EROSION_TILE_SIZE;
+    const int tilesX = (field.width + tile - 1) / tile;
+    const int tilesY = (field.height + tile - 1) / tile;
+    const int tileCount = tilesX * tilesY;
+
+    // every tile gets the same share, the first few take the remainder
+    const int perTile = params.dropletCount / tileCount;
+    const int extra = params.dropletCount % tileCount;
+    const int rounds = (perTile + (extra > 0 ? 1 : 0) + EROSION_DROPLETS_PER_BATCH - 1) / EROSION_DROPLETS_PER_BATCH;
+
+    // the four tile colours of a 2x2 checkerboard, same coloured tiles are a tile apart
+    std::vector<int> colourTiles[4];
+    for (int t = 0; t < tileCount; t++) {
+        colourTiles[(t % tilesX & 1) + 2 * (t / tilesX & 1)].push_back(t);
+    }
+
+    for (int round = 0; round < rounds; round++) {
+        for (int colour = 0; colour < 4; colour++) {
+
+            const std::vector<int>& tiles = colourTiles[colour];
+
+            pool.parallelFor(int(tiles.size()), [&](int job) {
+
+                int t = tiles[job];
+                int tileX = (t % tilesX) * tile;
+                int tileY = (t / tilesX) * tile;
+
+                int quota = perTile + (t < extra ? 1 : 0);
+                int first = round * EROSION_DROPLETS_PER_BATCH;
+                int count = std::min(EROSION_DROPLETS_PER_BATCH, quota - first);
+                if (count <= 0) {
+                    return;
+                }
+
+                // half a tile of margin each side, which meets but never overlaps the
+                // margin of the next same coloured tile
+                Erosion_Region region = {
+                    std::max(0, tileX - tile / 2), std::max(0, tileY - tile / 2),
+                    std::min(field.width, tileX + tile + tile / 2), std::min(field.height, tileY + tile + tile / 2)
+                };
+
+                float spawnWidth = float(std::min(tile, field.width - 1 - tileX));
+                float spawnHeight = float(std::min(tile, field.height - 1 - tileY));
+                if (spawnWidth <= 0.0f || spawnHeight <= 0.0f) {
+                    return;
+                }
+
+                Droplet_Random random(params.seed, unsigned(t) * unsigned(rounds) + unsigned(round));
+
+                for (int i = 0; i < count; i++) {
+                    float x = float(tileX) + random.unit() * spawnWidth;
+                    float y = float(tileY) + random.unit() * spawnHeight;
+                    simulateDroplet(heights, width, region, brush, params, x, y);
+                }
+            });
+        }
+    }
+}
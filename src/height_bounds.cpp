@@ -0,0 +1,224 @@
+#include <algorithm>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "height_bounds.hpp"
+#include "heightfield.hpp"
+#include "job_pool.hpp"
+
+// cells first to last of one row, cell i from inputs 2i and 2i + 1 of both
+// input rows, which are indexed from offset. An input at or past inEnd is left
+// out, so the last cell of an odd row only reads one column
+static void minRow(const float* row0, const float* row1, int offset, int inEnd, int first, int last, float* out) {
+
+    int paired = std::min(last, inEnd / 2 - 1);
+    int i = first;
+
+    for (; i <= paired; i++) {
+        int a = 2 * i - offset;
+        out[i] = std::min(std::min(row0[a], row0[a + 1]), std::min(row1[a], row1[a + 1]));
+    }
+    for (; i <= last; i++) {
+        int a = 2 * i - offset;
+        out[i] = std::min(row0[a], row1[a]);
+    }
+}
+
+static void maxRow(const float* row0, const float* row1, int offset, int inEnd, int first, int last, float* out) {
+
+    int paired = std::min(last, inEnd / 2 - 1);
+    int i = first;
+
+    for (; i <= paired; i++) {
+        int a = 2 * i - offset;
+        out[i] = std::max(std::max(row0[a], row0[a + 1]), std::max(row1[a], row1[a + 1]));
+    }
+    for (; i <= last; i++) {
+        int a = 2 * i - offset;
+        out[i] = std::max(row0[a], row1[a]);
+    }
+}
+
+static int positiveMod(int a, int b) {
+    int m = a % b;
+    return m < 0 ? m + b : m;
+}
+
+HeightBounds::HeightBounds(int widthIn, int heightIn) {
+
+    width = widthIn;
+    height = heightIn;
+    firstLevel = 0;
+
+    int levelWidth = width;
+    int levelHeight = height;
+
+    do {
+        levelWidth = (levelWidth + 1) / 2;
+        levelHeight = (levelHeight + 1) / 2;
+
+        Height_Bounds_Level level;
+        level.width = levelWidth;
+        level.height = levelHeight;
+        level.minHeights.assign(size_t(levelWidth) * levelHeight, 0.0f);
+        level.maxHeights.assign(size_t(levelWidth) * levelHeight, 0.0f);
+        levels.push_back(std::move(level));
+
+    } while (levelWidth > 1 || levelHeight > 1);
+}
+
+void HeightBounds::build(const Heightfield& field, JobPool& pool) {
+    update(field, 0, 0, pool);
+}
+
+void HeightBounds::update(const Heightfield& source, int x, int y, JobPool& pool) {
+
+    Height_Bounds_Level& base = levels[0];
+
+    // texels source covers, clipped to the field
+    const int columnEnd = std::min(width, x + source.width);
+    const int rowEnd = std::min(height, y + source.height);
+    if (columnEnd <= x || rowEnd <= y) {
+        return;
+    }
+
+    int firstColumn = x / 2;
+    int lastColumn = (columnEnd - 1) / 2;
+    int firstRow = y / 2;
+    int lastRow = (rowEnd - 1) / 2;
+
+    const int bands = (lastRow - firstRow + 1 + HEIGHT_BOUNDS_BAND_ROWS - 1) / HEIGHT_BOUNDS_BAND_ROWS;
+
+    pool.parallelFor(bands, [&](int band) {
+
+        const int bandEnd = std::min(lastRow, firstRow + (band + 1) * HEIGHT_BOUNDS_BAND_ROWS - 1);
+
+        for (int cellY = firstRow + band * HEIGHT_BOUNDS_BAND_ROWS; cellY <= bandEnd; cellY++) {
+
+            const float* row0 = source.row(2 * cellY - y);
+            const float* row1 = source.row(std::min(2 * cellY + 1, rowEnd - 1) - y);
+
+            minRow(row0, row1, x, columnEnd, firstColumn, lastColumn, &base.minHeights[size_t(cellY) * base.width]);
+            maxRow(row0, row1, x, columnEnd, firstColumn, lastColumn, &base.maxHeights[size_t(cellY) * base.width]);
+        }
+    });
+
+    // the same cells shrink by half on every level up
+    for (int level = 1; level < levelCount(); level++) {
+
+        firstColumn /= 2;
+        lastColumn /= 2;
+        firstRow /= 2;
+        lastRow /= 2;
+
+        reduceLevel(level, firstRow, lastRow, firstColumn, lastColumn, pool);
+    }
+}
+
+void HeightBounds::buildAbove(int level, JobPool& pool) {
+    for (int above = level + 1; above < levelCount(); above++) {
+        reduceLevel(above, 0, levels[above].height - 1, 0, levels[above].width - 1, pool);
+    }
+}
+
+void HeightBounds::reduceLevel(int level, int firstRow, int lastRow, int firstColumn, int lastColumn, JobPool& pool) {
+
+    const Height_Bounds_Level& below = levels[level - 1];
+    Height_Bounds_Level& out = levels[level];
+
+    const int bands = (lastRow - firstRow + 1 + HEIGHT_BOUNDS_BAND_ROWS - 1) / HEIGHT_BOUNDS_BAND_ROWS;
+
+    pool.parallelFor(bands, [&](int band) {
+
+        const int bandEnd = std::min(lastRow, firstRow + (band + 1) * HEIGHT_BOUNDS_BAND_ROWS - 1);
+
+        for (int cellY = firstRow + band * HEIGHT_BOUNDS_BAND_ROWS; cellY <= bandEnd; cellY++) {
+
+            const size_t row0 = size_t(2 * cellY) * below.width;
+            const size_t row1 = size_t(std::min(2 * cellY + 1, below.height - 1)) * below.width;
+
+            minRow(&below.minHeights[row0], &below.minHeights[row1], 0, below.width, firstColumn, lastColumn,
+                   &out.minHeights[size_t(cellY) * out.width]);
+            maxRow(&below.maxHeights[row0], &below.maxHeights[row1], 0, below.width, firstColumn, lastColumn,
+                   &out.maxHeights[size_t(cellY) * out.width]);
+        }
+    });
+}
+
+glm::vec2 HeightBounds::cell(int level, int x, int y) const {
+    const Height_Bounds_Level& bounds = levels[level];
+    size_t index = size_t(y) * bounds.width + x;
+    return glm::vec2(bounds.minHeights[index], bounds.maxHeights[index]);
+}
+
+glm::vec2 HeightBounds::regionBounds(glm::ivec2 first, glm::ivec2 last, bool wrap) const {
+
+    if (!wrap) {
+        return clampedBounds(first, last);
+    }
+
+    // up to 2 ranges per axis, either side of the seam
+    int starts[2][2], ends[2][2], counts[2];
+    const int sizes[2] = { width, height };
+
+    for (int axis = 0; axis < 2; axis++) {
+
+        int size = sizes[axis];
+        int span = last[axis] - first[axis];
+        int start = positiveMod(first[axis], size);
+
+        counts[axis] = 1;
+        starts[axis][0] = start;
+        ends[axis][0] = start + span;
+
+        if (span + 1 >= size) {
+            starts[axis][0] = 0;
+            ends[axis][0] = size - 1;
+        } else if (start + span >= size) {
+            ends[axis][0] = size - 1;
+            starts[axis][1] = 0;
+            ends[axis][1] = start + span - size;
+            counts[axis] = 2;
+        }
+    }
+
+    glm::vec2 bounds(1e30f, -1e30f);
+
+    for (int j = 0; j < counts[1]; j++) {
+        for (int i = 0; i < counts[0]; i++) {
+
+            glm::vec2 part = clampedBounds(glm::ivec2(starts[0][i], starts[1][j]), glm::ivec2(ends[0][i], ends[1][j]));
+            bounds = glm::vec2(std::min(bounds.x, part.x), std::max(bounds.y, part.y));
+        }
+    }
+
+    return bounds;
+}
+
+glm::vec2 HeightBounds::clampedBounds(glm::ivec2 first, glm::ivec2 last) const {
+
+    first = glm::clamp(first, glm::ivec2(0), glm::ivec2(width - 1, height - 1));
+    last = glm::clamp(last, first, glm::ivec2(width - 1, height - 1));
+
+    // the finest level whose cells are at least half the region, so it spans 3 cells at most
+    int extent = std::max(last.x - first.x, last.y - first.y) + 1;
+    int level = firstLevel;
+    while (level < levelCount() - 1 && (4 << level) < extent) {
+        level++;
+    }
+
+    const Height_Bounds_Level& bounds = levels[level];
+    const int cellSize = 2 << level;
+
+    glm::vec2 range(1e30f, -1e30f);
+
+    for (int y = first.y / cellSize; y <= std::min(last.y / cellSize, bounds.height - 1); y++) {
+        for (int x = first.x / cellSize; x <= std::min(last.x / cellSize, bounds.width - 1); x++) {
+            glm::vec2 c = cell(level, x, y);
+            range = glm::vec2(std::min(range.x, c.x), std::max(range.y, c.y));
+        }
+    }
+
+    return range;
+}
@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "height_bounds.hpp"
+#include "height_bounds_reducer.hpp"
+#include "job_pool.hpp"
+#include "shader.hpp"
+
+HeightBoundsReducer::HeightBoundsReducer(const std::string& buildPath, int widthIn, int heightIn) : shader(buildPath, "minmax") {
+
+    width = widthIn;
+    height = heightIn;
+
+    // same level sizes as HeightBounds
+    int levelWidth = width;
+    int levelHeight = height;
+    do {
+        levelWidth = (levelWidth + 1) / 2;
+        levelHeight = (levelHeight + 1) / 2;
+
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, levelWidth, levelHeight, 0, GL_RG, GL_FLOAT, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        textures.push_back(texture);
+
+    } while (levelWidth > 1 || levelHeight > 1);
+
+    levels = int(textures.size());
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &fbo);
+    glGenVertexArrays(1, &vao);
+
+    shader.use();
+    shader.setInt("source", 0);
+    firstPassLoc = shader.getUniformLocation("firstPass");
+    sourceSizeLoc = shader.getUniformLocation("sourceSize");
+}
+
+HeightBoundsReducer::~HeightBoundsReducer() {
+    glDeleteTextures(levels, textures.data());
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteVertexArrays(1, &vao);
+}
+
+void HeightBoundsReducer::reduce(unsigned int heightTexture) {
+
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glBindVertexArray(vao);
+    glActiveTexture(GL_TEXTURE0);
+    shader.use();
+
+    int sourceWidth = width;
+    int sourceHeight = height;
+
+    for (int level = 0; level < levels; level++) {
+
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[level], 0);
+        glBindTexture(GL_TEXTURE_2D, level == 0 ? heightTexture : textures[level - 1]);
+
+        shader.setBool(firstPassLoc, level == 0);
+        shader.setIVec2(sourceSizeLoc, glm::ivec2(sourceWidth, sourceHeight));
+
+        sourceWidth = (sourceWidth + 1) / 2;
+        sourceHeight = (sourceHeight + 1) / 2;
+
+        glViewport(0, 0, sourceWidth, sourceHeight);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindVertexArray(0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void HeightBoundsReducer::read(int level, HeightBounds& bounds, JobPool& pool) {
+
+    if (bounds.width != width || bounds.height != height || level < 0 || level >= levels) {
+        std::cout << "ERROR::HEIGHT_BOUNDS_REDUCER::READ_MISMATCH\n\tlevel " << level << " of " << width << "x" << height
+                  << " into " << bounds.width << "x" << bounds.height << "\n";
+        return;
+    }
+
+    Height_Bounds_Level& out = bounds.levels[level];
+    readBuffer.resize(size_t(out.width) * out.height * 2);
+
+    glBindTexture(GL_TEXTURE_2D, textures[level]);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RG, GL_FLOAT, readBuffer.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    for (size_t i = 0; i < out.minHeights.size(); i++) {
+        out.minHeights[i] = readBuffer[2 * i];
+        out.maxHeights[i] = readBuffer[2 * i + 1];
+    }
+
+    bounds.firstLevel = level;
+    bounds.buildAbove(level, pool);
+}
@@ -0,0 +1,285 @@
+#include <algorithm>
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+#include "height_bounds.hpp"
+#include "height_query.hpp"
+#include "heightfield.hpp"
+#include "job_pool.hpp"
+
+static int positiveMod(int a, int b) {
+    int m = a % b;
+    return m < 0 ? m + b : m;
+}
+
+static int floorDiv(int a, int b) {
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+HeightQuery::HeightQuery(const Heightfield& fieldIn, const HeightBounds* boundsIn, bool wrapIn) : field(fieldIn) {
+
+    bounds = boundsIn;
+    wrap = wrapIn;
+}
+
+float HeightQuery::texel(int x, int y) const {
+
+    if (wrap) {
+        return field.at(positiveMod(x, field.width), positiveMod(y, field.height));
+    }
+    return field.at(std::min(std::max(x, 0), field.width - 1), std::min(std::max(y, 0), field.height - 1));
+}
+
+float HeightQuery::height(glm::vec2 p) const {
+
+    glm::vec2 corner = glm::floor(p - 0.5f);
+    glm::vec2 f = p - 0.5f - corner;
+
+    int x0 = int(corner.x);
+    int y0 = int(corner.y);
+    int x1, y1;
+
+    if (wrap) {
+        x0 = positiveMod(x0, field.width);
+        y0 = positiveMod(y0, field.height);
+        x1 = x0 + 1 == field.width ? 0 : x0 + 1;
+        y1 = y0 + 1 == field.height ? 0 : y0 + 1;
+    } else {
+        x1 = std::min(std::max(x0 + 1, 0), field.width - 1);
+        y1 = std::min(std::max(y0 + 1, 0), field.height - 1);
+        x0 = std::min(std::max(x0, 0), field.width - 1);
+        y0 = std::min(std::max(y0, 0), field.height - 1);
+    }
+
+    const float* row0 = field.row(y0);
+    const float* row1 = field.row(y1);
+
+    float bottom = row0[x0] + (row0[x1] - row0[x0]) * f.x;
+    float top = row1[x0] + (row1[x1] - row1[x0]) * f.x;
+    return bottom + (top - bottom) * f.y;
+}
+
+void HeightQuery::heights(const glm::vec2* points, float* out, int count) const {
+    for (int i = 0; i < count; i++) {
+        out[i] = height(points[i]);
+    }
+}
+
+void HeightQuery::heights(const glm::vec2* points, float* out, int count, JobPool& pool) const {
+
+    const int blocks = (count + HEIGHT_QUERY_BATCH_BLOCK - 1) / HEIGHT_QUERY_BATCH_BLOCK;
+
+    pool.parallelFor(blocks, [&](int block) {
+        int first = block * HEIGHT_QUERY_BATCH_BLOCK;
+        heights(points + first, out + first, std::min(HEIGHT_QUERY_BATCH_BLOCK, count - first));
+    });
+}
+
+// Walks the ray through the nodes of the bounds pyramid, a level l node being
+// the (2 << l) texel squares a side over one cell. A node the ray stays above
+// is stepped over, otherwise its children are tried, down to single texel
+// squares (level -1) which are intersected exactly. Node indices are stepped
+// rather than worked out from positions along the ray, so rounding can't stall
+// it on a boundary. Everything is in centre space (texel centres on integers),
+// where texel square (i, j) spans [i, i + 1] with texels i, i + 1, j, j + 1 at
+// its corners, so a node also reads the texels one past its last square
+bool HeightQuery::raycast(glm::vec3 origin, glm::vec3 direction, float maxDistance, Height_Hit& hit) const {
+
+    glm::vec3 start = origin - glm::vec3(0.5f, 0.0f, 0.5f);
+    glm::vec2 flatStart = glm::vec2(start.x, start.z);
+    const glm::vec2 flatDirection = glm::vec2(direction.x, direction.z);
+    const glm::vec2 size = glm::vec2(float(field.width), float(field.height));
+
+    float begin = 0.0f;
+    float end = maxDistance;
+
+    if (wrap) {
+        // the same squares a whole number of fields over, and smaller numbers to lose precision in
+        flatStart -= glm::floor(flatStart / size) * size;
+        start = glm::vec3(flatStart.x, start.y, flatStart.y);
+    } else {
+        // the clamped squares either side reach half a texel past the outer centres
+        for (int axis = 0; axis < 2; axis++) {
+
+            float from = flatStart[axis];
+            float lo = -0.5f;
+            float hi = size[axis] - 0.5f;
+
+            if (flatDirection[axis] == 0.0f) {
+                if (from < lo || from > hi) {
+                    return false;
+                }
+                continue;
+            }
+
+            float t0 = (lo - from) / flatDirection[axis];
+            float t1 = (hi - from) / flatDirection[axis];
+            begin = std::max(begin, std::min(t0, t1));
+            end = std::min(end, std::max(t0, t1));
+        }
+
+        if (begin > end) {
+            return false;
+        }
+    }
+
+    const int top = bounds ? bounds->levelCount() - 1 : -1;
+    // levels under firstLevel hold nothing, squares come straight after it
+    const int bottom = bounds ? bounds->firstLevel : -1;
+    auto nodeSize = [&](int level) { return level < 0 ? 1 : 2 << level; };
+    auto childLevel = [&](int level) { return level == bottom ? -1 : level - 1; };
+
+    int level = top;
+    float t = begin;
+
+    // node of the level holding the ray at t, ties going the way the ray moves
+    auto locate = [&](int level) {
+        glm::vec3 p = start + direction * t;
+        glm::vec2 flat = glm::vec2(p.x, p.z) / float(nodeSize(level));
+        glm::ivec2 node;
+        for (int axis = 0; axis < 2; axis++) {
+            node[axis] = flatDirection[axis] < 0.0f ? int(std::ceil(flat[axis])) - 1 : int(std::floor(flat[axis]));
+        }
+        return node;
+    };
+
+    glm::ivec2 node = locate(level);
+
+    while (true) {
+
+        const int span = nodeSize(level);
+
+        // where the ray leaves the node, and across which axes
+        float exit = end;
+        glm::bvec2 exitAxes = glm::bvec2(false);
+        for (int axis = 0; axis < 2; axis++) {
+
+            if (flatDirection[axis] == 0.0f) {
+                continue;
+            }
+
+            int edge = flatDirection[axis] > 0.0f ? node[axis] + 1 : node[axis];
+            float crossing = (float(edge * span) - flatStart[axis]) / flatDirection[axis];
+
+            if (crossing < exit) {
+                exit = crossing;
+                exitAxes = glm::bvec2(false);
+                exitAxes[axis] = true;
+            } else if (crossing == exit) {
+                exitAxes[axis] = true;
+            }
+        }
+        exit = std::max(exit, t);
+
+        bool above = false;
+
+        if (level < 0) {
+            float distance;
+            if (squareHit(node, start, direction, t, exit, distance)) {
+                hit.distance = distance;
+                hit.position = origin + direction * distance;
+                return true;
+            }
+            above = true;
+        } else {
+            glm::ivec2 first = node * span;
+            float highest = bounds->regionBounds(first, first + span, wrap).y;
+            above = std::min(start.y + direction.y * t, start.y + direction.y * exit) > highest;
+        }
+
+        if (!above) {
+            // descend into the child the ray is in at t
+            int child = childLevel(level);
+            int ratio = span / nodeSize(child);
+            glm::ivec2 located = locate(child);
+            node = glm::clamp(located, node * ratio, node * ratio + ratio - 1);
+            level = child;
+            continue;
+        }
+
+        if (exit >= end || !glm::any(exitAxes)) {
+            return false;
+        }
+
+        // step to the next node, then up while that crossed the parent's edge too
+        glm::ivec2 previous = node;
+        for (int axis = 0; axis < 2; axis++) {
+            if (exitAxes[axis]) {
+                node[axis] += flatDirection[axis] > 0.0f ? 1 : -1;
+            }
+        }
+        t = exit;
+
+        while (level < top) {
+            int parent = level < 0 ? bottom : level + 1;
+            int ratio = nodeSize(parent) / nodeSize(level);
+            glm::ivec2 parentNode = glm::ivec2(floorDiv(node.x, ratio), floorDiv(node.y, ratio));
+            glm::ivec2 previousParent = glm::ivec2(floorDiv(previous.x, ratio), floorDiv(previous.y, ratio));
+            if (parentNode == previousParent) {
+                break;
+            }
+            node = parentNode;
+            previous = previousParent;
+            level = parent;
+        }
+    }
+}
+
+// first distance in [begin, end] where the ray is at or under the bilinear
+// surface of one texel square, solving the quadratic height difference
+bool HeightQuery::squareHit(glm::ivec2 square, glm::vec3 start, glm::vec3 direction, float begin, float end, float& distance) const {
+
+    const float h00 = texel(square.x, square.y);
+    const float h10 = texel(square.x + 1, square.y);
+    const float h01 = texel(square.x, square.y + 1);
+    const float h11 = texel(square.x + 1, square.y + 1);
+
+    const float b = h10 - h00;
+    const float c = h01 - h00;
+    const float d = h00 - h10 - h01 + h11;
+
+    // measured from begin, u and v across the square
+    glm::vec3 p = start + direction * begin;
+    const float u = p.x - float(square.x);
+    const float v = p.z - float(square.y);
+
+    // ray height - surface height = c0 + c1 s + c2 s^2
+    const float c0 = p.y - (h00 + b * u + c * v + d * u * v);
+    const float c1 = direction.y - (b * direction.x + c * direction.z + d * (u * direction.z + v * direction.x));
+    const float c2 = -d * direction.x * direction.z;
+    const float length = end - begin;
+
+    if (c0 <= 0.0f) {
+        distance = begin;
+        return true;
+    }
+
+    float root = -1.0f;
+
+    if (std::abs(c2) * length <= 1e-6f * std::abs(c1)) {
+        if (c1 < 0.0f) {
+            root = -c0 / c1;
+        }
+    } else {
+        float discriminant = c1 * c1 - 4.0f * c2 * c0;
+        if (discriminant < 0.0f) {
+            return false;
+        }
+        // both roots without cancellation, c0 > 0 keeps q off 0
+        float q = -0.5f * (c1 + std::copysign(std::sqrt(discriminant), c1));
+        float r0 = q / c2;
+        float r1 = c0 / q;
+        if (r0 > r1) {
+            std::swap(r0, r1);
+        }
+        root = r0 >= 0.0f ? r0 : r1;
+    }
+
+    if (root < 0.0f || root > length) {
+        return false;
+    }
+
+    distance = begin + root;
+    return true;
+}
@@ -0,0 +1,69 @@
+#include <algorithm>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "heightfield.hpp"
+#include "job_pool.hpp"
+#include "noise.hpp"
+
+Heightfield::Heightfield(int widthIn, int heightIn) {
+
+    width = widthIn;
+    height = heightIn;
+    data.assign(size_t(width) * height, 0.0f);
+}
+
+void generateHeightfield(Heightfield& field, const Noise& noise, Noise_Type type, glm::vec2 origin, float texRes) {
+    generateHeightfieldRegion(field, noise, type, origin, texRes, 0, 0, field.width, field.height);
+}
+
+void generateHeightfieldRegion(Heightfield& field, const Noise& noise, Noise_Type type, glm::vec2 origin, float texRes,
+                               int x0, int y0, int width, int height) {
+
+    // st.x is the same for every row so only work it out once
+    std::vector<float> stX(width), stY(width);
+
+    for (int x = 0; x < width; x++) {
+        stX[x] = origin.x + (float(x0 + x) + 0.5f) / texRes;
+    }
+
+    for (int y = y0; y < y0 + height; y++) {
+        std::fill(stY.begin(), stY.end(), origin.y + (float(y) + 0.5f) / texRes);
+        noise.sampleBatch(type, stX.data(), stY.data(), field.row(y) + x0, width);
+    }
+}
+
+void generateRow(float* out, int worldX, int worldY, int count, const Noise& noise, Noise_Type type, float texRes,
+                 float texelOffset) {
+
+    float stX[NOISE_BATCH_SIZE], stY[NOISE_BATCH_SIZE];
+    float y = (float(worldY) + texelOffset) / texRes;
+
+    for (int start = 0; start < count; start += NOISE_BATCH_SIZE) {
+
+        int n = std::min(NOISE_BATCH_SIZE, count - start);
+
+        for (int i = 0; i < n; i++) {
+            stX[i] = (float(worldX + start + i) + texelOffset) / texRes;
+            stY[i] = y;
+        }
+        noise.sampleBatch(type, stX, stY, out + start, n);
+    }
+}
+
+void generateHeightfieldTiled(Heightfield& field, const Noise& noise, Noise_Type type, glm::vec2 origin, float texRes,
+                              JobPool& pool, int tileSize) {
+
+    int tilesX = (field.width + tileSize - 1) / tileSize;
+    int tilesY = (field.height + tileSize - 1) / tileSize;
+
+    pool.parallelFor(tilesX * tilesY, [&](int tile) {
+
+        int x0 = (tile % tilesX) * tileSize;
+        int y0 = (tile / tilesX) * tileSize;
+
+        generateHeightfieldRegion(field, noise, type, origin, texRes, x0, y0,
+                                  std::min(tileSize, field.width - x0), std::min(tileSize, field.height - y0));
+    });
+}
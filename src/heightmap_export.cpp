@@ -0,0 +1,339 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "heightfield.hpp"
+#include "heightmap_export.hpp"
+
+// stored deflate blocks hold at most this many bytes
+#define DEFLATE_STORED_MAX 65535
+// bytes adler32 can sum before its 32 bit sums have to be reduced
+#define ADLER_BLOCK 5552
+
+static bool littleEndian() {
+    const uint16_t one = 1;
+    unsigned char first;
+    std::memcpy(&first, &one, 1);
+    return first == 1;
+}
+
+static void putBig32(unsigned char* out, uint32_t value) {
+    out[0] = (unsigned char)(value >> 24);
+    out[1] = (unsigned char)(value >> 16);
+    out[2] = (unsigned char)(value >> 8);
+    out[3] = (unsigned char)value;
+}
+
+// slicing by 4: four tables, table k holding the crc of a byte followed by k
+// zero bytes, so a word of input takes 4 lookups and no per byte dependency
+static uint32_t crc32(uint32_t crc, const unsigned char* bytes, size_t count) {
+
+    static const auto tables = []() {
+        std::vector<uint32_t> entries(4 * 256);
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int bit = 0; bit < 8; bit++) {
+                c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            }
+            entries[i] = c;
+        }
+        for (uint32_t i = 0; i < 256; i++) {
+            for (int k = 1; k < 4; k++) {
+                uint32_t previous = entries[(k - 1) * 256 + i];
+                entries[k * 256 + i] = entries[previous & 0xff] ^ (previous >> 8);
+            }
+        }
+        return entries;
+    }();
+    const uint32_t* table = tables.data();
+
+    crc = ~crc;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        crc ^= uint32_t(bytes[i]) | uint32_t(bytes[i + 1]) << 8 | uint32_t(bytes[i + 2]) << 16 | uint32_t(bytes[i + 3]) << 24;
+        crc = table[3 * 256 + (crc & 0xff)] ^ table[2 * 256 + ((crc >> 8) & 0xff)] ^
+              table[256 + ((crc >> 16) & 0xff)] ^ table[crc >> 24];
+    }
+    for (; i < count; i++) {
+        crc = table[(crc ^ bytes[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static uint32_t adler32(uint32_t adler, const unsigned char* bytes, size_t count) {
+
+    uint32_t a = adler & 0xffff;
+    uint32_t b = adler >> 16;
+
+    while (count > 0) {
+        size_t block = std::min(count, size_t(ADLER_BLOCK));
+        for (size_t i = 0; i < block; i++) {
+            a += bytes[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+        bytes += block;
+        count -= block;
+    }
+    return (b << 16) | a;
+}
+
+static uint16_t toUnorm16(float height, float minHeight, float scale) {
+    float unit = std::min(std::max((height - minHeight) * scale, 0.0f), 1.0f);
+    return uint16_t(unit * 65535.0f + 0.5f);
+}
+
+static std::string pfmHeader(int width, int height) {
+    // a negative scale marks the floats little endian
+    return "Pf\n" + std::to_string(width) + " " + std::to_string(height) + "\n-1.0\n";
+}
+
+const char* heightmapFormatName(Heightmap_Format format) {
+    switch (format) {
+        case HEIGHTMAP_PNG16: return "png";
+        case HEIGHTMAP_R16:   return "r16";
+        case HEIGHTMAP_R32F:  return "r32f";
+        case HEIGHTMAP_PFM:   return "pfm";
+        default:              return "unknown";
+    }
+}
+
+size_t heightmapFileSize(Heightmap_Format format, int width, int height) {
+
+    const size_t texels = size_t(width) * height;
+
+    switch (format) {
+        case HEIGHTMAP_PNG16: {
+            // signature, IHDR and IEND, then one IDAT per row: its chunk overhead, the
+            // filter byte, a stored block header per 65535 bytes and the texels
+            size_t rowData = 1 + size_t(width) * 2;
+            size_t blocks = (rowData + DEFLATE_STORED_MAX - 1) / DEFLATE_STORED_MAX;
+            return 8 + 25 + 12 + size_t(height) * (12 + rowData + blocks * 5) + 2 + 4;
+        }
+        case HEIGHTMAP_R16:   return texels * 2;
+        case HEIGHTMAP_R32F:  return texels * 4;
+        case HEIGHTMAP_PFM:   return pfmHeader(width, height).size() + texels * 4;
+        default:              return 0;
+    }
+}
+
+HeightmapWriter::HeightmapWriter(const std::string& pathIn, Heightmap_Format formatIn, int widthIn, int heightIn,
+                                 float minHeightIn, float maxHeightIn) : path(pathIn) {
+
+    format = formatIn;
+    width = widthIn;
+    height = heightIn;
+    minHeight = minHeightIn;
+    maxHeight = maxHeightIn;
+    rows = 0;
+    adler = 1;
+    valid = false;
+
+    if (width <= 0 || height <= 0 || format < 0 || format >= HEIGHTMAP_FORMAT_COUNT) {
+        std::cout << "ERROR::HEIGHTMAP::INVALID_SIZE\n\t" << path << " " << width << "x" << height << "\n";
+        return;
+    }
+
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cout << "ERROR::HEIGHTMAP::FILE_NOT_OPENED\n\t" << path << "\n";
+        return;
+    }
+    valid = true;
+
+    const size_t texelBytes = format == HEIGHTMAP_R32F || format == HEIGHTMAP_PFM ? 4 : 2;
+    // png rows lead with their filter byte
+    rowBytes.resize((format == HEIGHTMAP_PNG16 ? 1 : 0) + size_t(width) * texelBytes);
+
+    if (format == HEIGHTMAP_PNG16) {
+
+        static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+        writeBytes(signature, sizeof(signature));
+
+        // 16 bit greyscale, deflate, adaptive filtering (every row uses none), not interlaced
+        unsigned char header[13] = {};
+        putBig32(header, uint32_t(width));
+        putBig32(header + 4, uint32_t(height));
+        header[8] = 16;
+        writePngChunk("IHDR", header, sizeof(header));
+
+    } else if (format == HEIGHTMAP_PFM) {
+        std::string header = pfmHeader(width, height);
+        writeBytes(reinterpret_cast<const unsigned char*>(header.data()), header.size());
+    }
+}
+
+void HeightmapWriter::writeRows(const float* first, int count, std::ptrdiff_t stride) {
+
+    if (rows + count > height) {
+        std::cout << "ERROR::HEIGHTMAP::TOO_MANY_ROWS\n\t" << path << " " << rows + count << "/" << height << "\n";
+        valid = false;
+    }
+
+    const float scale = maxHeight > minHeight ? 1.0f / (maxHeight - minHeight) : 0.0f;
+    const bool swap = !littleEndian();
+
+    for (int r = 0; r < count && valid; r++, rows++) {
+
+        const float* row = first + r * stride;
+
+        switch (format) {
+            case HEIGHTMAP_PNG16:
+                writePngRow(row);
+                break;
+
+            case HEIGHTMAP_R16:
+                for (int x = 0; x < width; x++) {
+                    uint16_t value = toUnorm16(row[x], minHeight, scale);
+                    rowBytes[2 * x] = (unsigned char)value;
+                    rowBytes[2 * x + 1] = (unsigned char)(value >> 8);
+                }
+                writeBytes(rowBytes.data(), rowBytes.size());
+                break;
+
+            case HEIGHTMAP_R32F:
+            case HEIGHTMAP_PFM:
+                std::memcpy(rowBytes.data(), row, rowBytes.size());
+                if (swap) {
+                    for (size_t i = 0; i < rowBytes.size(); i += 4) {
+                        std::swap(rowBytes[i], rowBytes[i + 3]);
+                        std::swap(rowBytes[i + 1], rowBytes[i + 2]);
+                    }
+                }
+                if (format == HEIGHTMAP_PFM) {
+                    // bottom row first, so image row r goes height - 1 - r rows in
+                    size_t offset = pfmHeader(width, height).size() + size_t(height - 1 - rows) * rowBytes.size();
+                    file.seekp(std::streamoff(offset));
+                }
+                writeBytes(rowBytes.data(), rowBytes.size());
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
+void HeightmapWriter::writeBand(const Heightfield& band) {
+
+    if (band.width != width) {
+        std::cout << "ERROR::HEIGHTMAP::BAND_WIDTH\n\t" << path << " " << band.width << " wide, not " << width << "\n";
+        valid = false;
+        return;
+    }
+
+    // Heightfield rows go bottom up, the top row is the last
+    writeRows(band.row(band.height - 1), band.height, -std::ptrdiff_t(width));
+}
+
+bool HeightmapWriter::finish() {
+
+    if (valid && rows != height) {
+        std::cout << "ERROR::HEIGHTMAP::ROWS_MISSING\n\t" << path << " " << rows << "/" << height << "\n";
+        valid = false;
+    }
+
+    if (valid && format == HEIGHTMAP_PNG16) {
+        writePngChunk("IEND", nullptr, 0);
+    }
+
+    if (file.is_open()) {
+        file.close();
+        if (valid && !file) {
+            std::cout << "ERROR::HEIGHTMAP::FILE_NOT_WRITTEN\n\t" << path << "\n";
+            valid = false;
+        }
+    }
+
+    return valid;
+}
+
+void HeightmapWriter::writeBytes(const unsigned char* bytes, size_t count) {
+
+    file.write(reinterpret_cast<const char*>(bytes), std::streamsize(count));
+    if (valid && !file) {
+        std::cout << "ERROR::HEIGHTMAP::FILE_NOT_WRITTEN\n\t" << path << "\n";
+        valid = false;
+    }
+}
+
+void HeightmapWriter::writePngChunk(const char type[4], const unsigned char* data, size_t count) {
+
+    unsigned char header[8];
+    putBig32(header, uint32_t(count));
+    std::memcpy(header + 4, type, 4);
+
+    uint32_t crc = crc32(0, header + 4, 4);
+    crc = crc32(crc, data, count);
+
+    unsigned char footer[4];
+    putBig32(footer, crc);
+
+    writeBytes(header, sizeof(header));
+    writeBytes(data, count);
+    writeBytes(footer, sizeof(footer));
+}
+
+// every row is its own IDAT chunk of stored deflate blocks, the zlib header
+// going in front of the first and the adler32 after the last, so nothing
+// longer than a row is ever held
+void HeightmapWriter::writePngRow(const float* row) {
+
+    const float scale = maxHeight > minHeight ? 1.0f / (maxHeight - minHeight) : 0.0f;
+
+    // filter none, then big endian texels
+    rowBytes[0] = 0;
+    for (int x = 0; x < width; x++) {
+        uint16_t value = toUnorm16(row[x], minHeight, scale);
+        rowBytes[1 + 2 * x] = (unsigned char)(value >> 8);
+        rowBytes[2 + 2 * x] = (unsigned char)value;
+    }
+    adler = adler32(adler, rowBytes.data(), rowBytes.size());
+
+    const bool firstRow = rows == 0;
+    const bool lastRow = rows == height - 1;
+    const size_t blocks = (rowBytes.size() + DEFLATE_STORED_MAX - 1) / DEFLATE_STORED_MAX;
+
+    std::vector<unsigned char>& chunk = pngChunk;
+    chunk.clear();
+    chunk.reserve(2 + blocks * 5 + rowBytes.size() + 4);
+
+    if (firstRow) {
+        // deflate, 32K window, no preset dictionary, lowest level (0x7801 is a multiple of 31)
+        chunk.push_back(0x78);
+        chunk.push_back(0x01);
+    }
+
+    for (size_t block = 0; block < blocks; block++) {
+
+        size_t start = block * DEFLATE_STORED_MAX;
+        size_t length = std::min(rowBytes.size() - start, size_t(DEFLATE_STORED_MAX));
+
+        // BFINAL on the stream's last block, BTYPE 00 stored, then LEN and its complement little endian
+        chunk.push_back(lastRow && block == blocks - 1 ? 1 : 0);
+        chunk.push_back((unsigned char)length);
+        chunk.push_back((unsigned char)(length >> 8));
+        chunk.push_back((unsigned char)~length);
+        chunk.push_back((unsigned char)(~length >> 8));
+        chunk.insert(chunk.end(), rowBytes.begin() + start, rowBytes.begin() + start + length);
+    }
+
+    if (lastRow) {
+        unsigned char checksum[4];
+        putBig32(checksum, adler);
+        chunk.insert(chunk.end(), checksum, checksum + 4);
+    }
+
+    writePngChunk("IDAT", chunk.data(), chunk.size());
+}
+
+bool exportHeightmap(const std::string& path, Heightmap_Format format, const Heightfield& field,
+                     float minHeight, float maxHeight) {
+
+    HeightmapWriter writer(path, format, field.width, field.height, minHeight, maxHeight);
+    writer.writeBand(field);
+    return writer.finish();
+}
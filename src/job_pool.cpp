@@ -0,0 +1,141 @@
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "job_pool.hpp"
+
+JobPool::JobPool(int threadCountIn) {
+
+    int count = threadCountIn > 0 ? threadCountIn : int(std::thread::hardware_concurrency());
+    if (count < 1) {
+        count = 1;
+    }
+
+    currentJob = nullptr;
+    remaining = 0;
+    generation = 0;
+    stopping = false;
+
+    for (int i = 0; i < count; i++) {
+        queues.push_back(std::make_unique<Job_Queue>());
+    }
+
+    // worker 0 is whichever thread calls parallelFor
+    for (int i = 1; i < count; i++) {
+        threads.emplace_back(&JobPool::workerLoop, this, i);
+    }
+}
+
+JobPool::~JobPool() {
+
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        stopping = true;
+    }
+    wakeCondition.notify_all();
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+void JobPool::parallelFor(int count, const std::function<void(int)>& job) {
+
+    if (count <= 0) {
+        return;
+    }
+
+    int workers = threadCount();
+
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+
+        currentJob = &job;
+        remaining = count;
+
+        for (int w = 0; w < workers; w++) {
+
+            int begin = int((long long)count * w / workers);
+            int end = int((long long)count * (w + 1) / workers);
+
+            std::lock_guard<std::mutex> queueLock(queues[w]->mutex);
+            for (int i = begin; i < end; i++) {
+                queues[w]->jobs.push_back(i);
+            }
+        }
+
+        generation++;
+    }
+    wakeCondition.notify_all();
+
+    while (runOne(0)) {}
+
+    // the last jobs may still be running on other workers
+    std::unique_lock<std::mutex> lock(stateMutex);
+    doneCondition.wait(lock, [this] { return remaining == 0; });
+    currentJob = nullptr;
+}
+
+void JobPool::workerLoop(int workerIndex) {
+
+    unsigned int seenGeneration = 0;
+
+    while (true) {
+
+        {
+            std::unique_lock<std::mutex> lock(stateMutex);
+            wakeCondition.wait(lock, [this, seenGeneration] { return stopping || generation != seenGeneration; });
+
+            if (stopping) {
+                return;
+            }
+            seenGeneration = generation;
+        }
+
+        while (runOne(workerIndex)) {}
+    }
+}
+
+bool JobPool::runOne(int workerIndex) {
+
+    int jobIndex;
+    if (!popJob(workerIndex, jobIndex)) {
+        return false;
+    }
+
+    (*currentJob)(jobIndex);
+
+    if (--remaining == 0) {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        doneCondition.notify_all();
+    }
+
+    return true;
+}
+
+bool JobPool::popJob(int workerIndex, int& jobIndex) {
+
+    {
+        Job_Queue& own = *queues[workerIndex];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.jobs.empty()) {
+            jobIndex = own.jobs.back();
+            own.jobs.pop_back();
+            return true;
+        }
+    }
+
+    int workers = threadCount();
+    for (int offset = 1; offset < workers; offset++) {
+
+        Job_Queue& victim = *queues[(workerIndex + offset) % workers];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.jobs.empty()) {
+            jobIndex = victim.jobs.front();
+            victim.jobs.pop_front();
+            return true;
+        }
+    }
+
+    return false;
+}
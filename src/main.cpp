@@ -1,5 +1,14 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <fstream>
 #include <iostream>
 #include <filesystem>
+#include <memory>
+#include <thread>
+#include <vector>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -7,28 +16,109 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "camera.hpp"
+#include "cdlod.hpp"
+#include "clipmap_renderer.hpp"
 #include "glm/fwd.hpp"
+#include "height_bounds.hpp"
+#include "height_bounds_reducer.hpp"
+#include "height_query.hpp"
+#include "heightfield.hpp"
+#include "heightmap_export.hpp"
+#include "noise.hpp"
+#include "noise_params.hpp"
+#include "normal_map.hpp"
+#include "offscreen_context.hpp"
 #include "shader.hpp"
+#include "texture_readback.hpp"
+#include "tile_streamer.hpp"
+#include "toroidal.hpp"
 
 #define SCR_WIDTH 1280
 #define SCR_HEIGHT 720
 
-#define SQUARES_PER_SIDE 128
-#define SCALE 48 / SQUARES_PER_SIDE
+// world units across the terrain plane and up to a height of 1
+#define TERRAIN_SIZE 48.0f
+#define TERRAIN_AMPLITUDE 10.0f
+// heights below this are drawn flat at it, must match WATER_LEVEL in terrain.vert
+#define TERRAIN_WATER_LEVEL 0.4f
 
 #define TEX_RES 4096
 
+// CDLOD quadtree the terrain mesh is drawn with (include/cdlod.hpp). 7 levels
+// of 32 quads per node gives a quad every 2 heightmap texels nearest the camera
+#define CDLOD_LEVELS 7
+#define CDLOD_NODE_QUADS 32
+#define CDLOD_PATCH_QUADS (CDLOD_NODE_QUADS / 2)
+// level of the gpu built min / max pyramid read back to cull CDLOD nodes by
+// the heights under them, its 32 texel cells are half the finest node
+#define HEIGHT_BOUNDS_READ_LEVEL 4
+
+// 1 streams the heightmap from cpu generated tiles (TileStreamer) instead of
+// running the noisegen pass over the whole texture every frame
+#define STREAM_CPU_TILES 0
+#define TILE_RES 512
+#define TILE_CACHE_BUDGET (256 * 1024 * 1024)
+
+// 1 draws the terrain as a geometry clipmap (ClipmapRenderer) streamed from the
+// cpu around the camera instead of CDLOD over the one heightmap. Each of the
+// levels doubles the reach, 12 of 122 quads go about 120 terrain sizes out
+#define CLIPMAP_TERRAIN 0
+#define CLIPMAP_LEVELS 12
+#define CLIPMAP_GRID_QUADS 122
+
+#if CLIPMAP_TERRAIN
+#define FAR_PLANE 10000.0f
+#else
+#define FAR_PLANE 100.0f
+#endif
+
+// 0 keeps posOffset/timeOffset fixed so the heightmap is generated once and reused
+#define ANIMATE_TERRAIN 1
+// most heightmap regenerations per second while animating, 0 regenerates every frame
+#define NOISE_REGEN_RATE 30.0f
+
+// 1 treats noiseTex as a toroidal ring, so when only posOffset moves just the
+// newly exposed strips are regenerated (scissored noisegen draws). timeOffset
+// then stays fixed while animating, since changing it regenerates the whole ring
+#define TOROIDAL_UPDATE 1
+
+// terrain-gen --offscreen FRAMES [DIR] renders FRAMES frames without a window
+// (OffscreenContext) and writes each to DIR/frame_NNNN.ppm, with the frame
+// times in DIR/timing.csv. Time steps at this rate rather than following the
+// clock, so a run renders the same frames however fast the GL driver is
+#define OFFSCREEN_FRAME_RATE 60.0
+#define OFFSCREEN_DEFAULT_DIR "offscreen"
+
+// E writes the gpu heightmap to heightmap_N.png (the last frame of an
+// offscreen run to DIR/heightmap.png), read back through TextureReadback so
+// the frame doesn't stall on it. [0, 1] spans the 16 bit range
+#define HEIGHTMAP_EXPORT_FORMAT HEIGHTMAP_PNG16
+
+// uniform locations of the noisegen variant currently in use
+struct Noise_Gen_Uniforms {
+    int timeOffset;
+    int gradRotation;
+    int posOffset;
+    int texelOffset;
+};
+
+Shader_Defines noiseGenDefines(const Noise_Params& params);
+Shader& selectNoiseGenVariant(ShaderVariants& variants, const Noise_Params& params, const Noise& noise, Noise_Gen_Uniforms& uniforms);
+
 void processInput(GLFWwindow* window);
-void renderScreenFBO(Shader screenShader, unsigned int textureToRender);
+void renderScreenFBO(Shader& screenShader, unsigned int textureToRender);
 
 void getObjects();
 
-void getPlaneIndices(unsigned int planeIndices[SQUARES_PER_SIDE * SQUARES_PER_SIDE * 6]);
-void getPlaneTexCoords(glm::vec2 planeTexCoords[(SQUARES_PER_SIDE + 1) * (SQUARES_PER_SIDE + 1)]);
-void getPlaneVertices(glm::vec3 planeVertices[(SQUARES_PER_SIDE + 1) * (SQUARES_PER_SIDE + 1)]);
+void getPatchIndices(unsigned int patchIndices[CDLOD_PATCH_QUADS * CDLOD_PATCH_QUADS * 6]);
+void getPatchGrid(glm::vec2 patchGrid[(CDLOD_PATCH_QUADS + 1) * (CDLOD_PATCH_QUADS + 1)]);
 
 std::string getBuildPath(std::string argv_0); 
 
+double wallTime();
+bool writeFramePPM(const std::string& path, int width, int height, const std::vector<unsigned char>& pixels);
+bool exportNoiseTex(const std::string& path, const Heightfield& field, glm::ivec2 ringOrigin);
+
 void framebuffer_size_callback(GLFWwindow* window, int width, int size);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos); 
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset); 
@@ -42,11 +132,11 @@ glm::vec3 cameraUp(0.0f, 1.0f, 0.0f);
 glm::vec3 cameraInitPos(0.0f, 3.0f, 0.0f);
 
 Camera camera(cameraInitPos, cameraUp, SCR_WIDTH, SCR_HEIGHT);
-glm::mat4 proj = glm::perspective(glm::radians(60.0f), float(SCR_WIDTH) / float(SCR_HEIGHT), 0.1f, 100.0f);
+glm::mat4 proj = glm::perspective(glm::radians(60.0f), float(SCR_WIDTH) / float(SCR_HEIGHT), 0.1f, FAR_PLANE);
 
 unsigned int triangleVAO, triangleVBO;
 unsigned int quadVAO, quadVBO;
-unsigned int planeVAO, planeVertexVBO, planeTexCoordsVBO, planeEBO;
+unsigned int patchVAO, patchGridVBO, patchInstanceVBO, patchEBO;
 unsigned int noiseFBO, noiseTex;
 unsigned int screenFBO, screenRBO, screenTexture;
 
@@ -58,35 +148,82 @@ void renderQuad() {
 
 int main(int argc, char* argv[]) {
 
-    // Window boilerplate
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    int offscreenFrames = 0;
+    std::string offscreenDir = OFFSCREEN_DEFAULT_DIR;
+
+    if (argc > 1) {
+        offscreenFrames = argc > 2 && std::strcmp(argv[1], "--offscreen") == 0 ? std::atoi(argv[2]) : 0;
+        if (offscreenFrames <= 0 || argc > 4) {
+            std::cout << "usage: terrain-gen [--offscreen FRAMES [DIR]]\n";
+            return -1;
+        }
+        if (argc > 3) {
+            offscreenDir = argv[3];
+        }
+    }
+
+    const bool offscreen = offscreenFrames > 0;
+    GLFWwindow* window = NULL;
+    std::unique_ptr<OffscreenContext> offscreenContext;
+
+    if (offscreen) {
+
+        std::error_code error;
+        std::filesystem::create_directories(offscreenDir, error);
+        if (error) {
+            std::cout << "ERROR::OFFSCREEN::DIRECTORY_NOT_CREATED\n\t" << offscreenDir << ": " << error.message() << "\n";
+            return -1;
+        }
+
+        offscreenContext = std::make_unique<OffscreenContext>();
+        if (!offscreenContext->valid) {
+            return -1;
+        }
+
+        // no window to follow, frames are drawn at the size the projection was made for
+        framebufferWidth = SCR_WIDTH;
+        framebufferHeight = SCR_HEIGHT;
+
+        if (!gladLoadGLLoader((GLADloadproc)OffscreenContext::getProcAddress)) {
+            std::cout << "Failed to initialise GLAD\n";
+            return -1;
+        }
+
+        std::cout << "rendering " << offscreenFrames << " frames off-screen on " << glGetString(GL_RENDERER)
+                  << " into " << offscreenDir << "\n";
+
+    } else {
+
+        // Window boilerplate
+        glfwInit();
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 #ifdef __APPLE__
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
 
-    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "terrain-gen", NULL, NULL);
+        window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "terrain-gen", NULL, NULL);
     
-    if (window == NULL) {
-        std::cout << "Failed to create GLFW window\n";
-        glfwTerminate();
-        return -1;
-    }
+        if (window == NULL) {
+            std::cout << "Failed to create GLFW window\n";
+            glfwTerminate();
+            return -1;
+        }
 
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-    glfwSetCursorPosCallback(window, mouse_callback);
-    glfwSetScrollCallback(window, scroll_callback);
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+        glfwSetCursorPosCallback(window, mouse_callback);
+        glfwSetScrollCallback(window, scroll_callback);
 
-    glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        glfwMakeContextCurrent(window);
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
 
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-        std::cout << "Failed to initialise GLAD\n";
-        return -1;
+        if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+            std::cout << "Failed to initialise GLAD\n";
+            return -1;
+        }
     }
 
     // GL config
@@ -96,63 +233,443 @@ int main(int argc, char* argv[]) {
 
     getObjects();
 
-    Shader noiseGenShader(buildPath, "noisegen");
-    Shader screenShader(buildPath, "screen");
-    Shader terrainShader(buildPath, "terrain");
+    double shaderStart = wallTime();
 
     glm::vec2 posOffset      = glm::vec2(0.0f);
     glm::vec2 posOffsetDelta = glm::vec2(0.1f);
 
+    // cpu side of the noisegen hash uniforms, so the gpu hashes exactly like libterrain
+    Noise noise;
+
+    Noise_Params noiseParams = { NOISE_RIDGE, noise.hashType, noise.seed, posOffset, noise.timeOffset, noise.basisType };
+
+    // noisegen is compiled per noise type / hash, so switching type swaps programs instead of branching per fragment
+    ShaderVariants noiseGenVariants(buildPath, "noisegen");
+    Noise_Gen_Uniforms noiseGenUniforms;
+    Shader* noiseGenShader = &selectNoiseGenVariant(noiseGenVariants, noiseParams, noise, noiseGenUniforms);
+    Shader screenShader(buildPath, "screen");
+    // heights generated on the cpu come with a normal map, gpu generated ones are differenced in terrain.vert
+    Shader terrainShader(buildPath, "terrain", { { "NORMAL_MAP", std::to_string(STREAM_CPU_TILES) },
+                                                 { "CLIPMAP",    std::to_string(CLIPMAP_TERRAIN) } });
+
+    int cachedShaders = noiseGenShader->loadedFromCache + screenShader.loadedFromCache + terrainShader.loadedFromCache;
+    std::cout << "shaders ready in " << 1000.0 * (wallTime() - shaderStart) << " ms ("
+              << cachedShaders << "/3 from the binary cache)\n";
+
+    terrainShader.use();
+    terrainShader.setInt("heightMap", 0);
+    terrainShader.setInt("normalMap", 1);
+    terrainShader.setFloat("amplitude", TERRAIN_AMPLITUDE);
+    terrainShader.setFloat("texelSize", TERRAIN_SIZE / float(TEX_RES));
+    terrainShader.setMat4("projection", proj);
+
+    Cdlod_Params lodParams;
+    lodParams.size = TERRAIN_SIZE;
+    lodParams.minHeight = 0.0f;
+    lodParams.maxHeight = TERRAIN_AMPLITUDE;
+    lodParams.levels = CDLOD_LEVELS;
+    lodParams.nodeQuads = CDLOD_NODE_QUADS;
+
+    CdlodQuadtree lod(lodParams);
+
+    glm::vec2 morphConstants[CDLOD_MAX_LEVELS];
+    for (int level = 0; level < CDLOD_LEVELS; level++) {
+        morphConstants[level] = lod.morphConstants(level);
+    }
+    terrainShader.setVec2Array("morphConstants", morphConstants, CDLOD_LEVELS);
+    terrainShader.setFloat("terrainSize", TERRAIN_SIZE);
+    terrainShader.setFloat("lodHeight", lod.lodHeight());
+
+    // uniforms set every frame, looked up once so the loop never touches a name
+    const int terrainViewPosLoc      = terrainShader.getUniformLocation("viewPos");
+    const int terrainViewLoc         = terrainShader.getUniformLocation("view");
+#if !CLIPMAP_TERRAIN
+    const int terrainMapOffsetLoc    = terrainShader.getUniformLocation("heightMapOffset");
+    const int terrainMapScaleLoc     = terrainShader.getUniformLocation("heightMapScale");
+#endif
+
+    NoiseDirtyTracker noiseDirty(NOISE_REGEN_RATE);
+#if !CLIPMAP_TERRAIN && !STREAM_CPU_TILES && TOROIDAL_UPDATE
+    // world texel at the bottom left of the toroidal noiseTex window
+    glm::ivec2 ringOrigin = glm::ivec2(0);
+#endif
+
+    JobPool jobPool;
+#if STREAM_CPU_TILES || CLIPMAP_TERRAIN
+    Noise_Params streamedParams = noiseParams;
+#endif
+
+#if CLIPMAP_TERRAIN
+    // the finest level samples every other noiseTex texel, like the finest CDLOD level
+    Clipmap_Params clipmapParams;
+    clipmapParams.levels = CLIPMAP_LEVELS;
+    clipmapParams.gridQuads = CLIPMAP_GRID_QUADS;
+    clipmapParams.texRes = float(TEX_RES / 2);
+    ClipmapRenderer clipmapRenderer(noiseParams.type, clipmapParams);
+
+    terrainShader.use();
+    clipmapRenderer.setUniforms(terrainShader, TERRAIN_SIZE, 2);
+
+    std::cout << "clipmap: " << CLIPMAP_LEVELS << " levels reaching "
+              << 0.5f * CLIPMAP_GRID_QUADS * float(1 << (CLIPMAP_LEVELS - 1)) * TERRAIN_SIZE / clipmapParams.texRes
+              << " units from the camera in " << clipmapRenderer.clipmap.memoryBytes() / 1024 << " KiB\n";
+#elif STREAM_CPU_TILES
+    Normal_Map_Params normalParams;
+    normalParams.heightScale = TERRAIN_AMPLITUDE;
+    normalParams.texelSize = TERRAIN_SIZE / float(TEX_RES);
+    TileStreamer tileStreamer(noiseParams.type, TILE_RES, TEX_RES, TILE_CACHE_BUDGET, normalParams);
+    const HeightBounds& heightBounds = tileStreamer.bounds;
+#else
+    HeightBoundsReducer boundsReducer(buildPath, TEX_RES, TEX_RES);
+    HeightBounds heightBounds(TEX_RES, TEX_RES);
+
+    TextureReadback noiseReadback(TEX_RES, TEX_RES);
+    ReadbackFuture exportFuture;
+    glm::ivec2 exportOrigin = glm::ivec2(0);
+    std::thread exportWriter;
+    int exportCount = 0;
+    bool exportKeyHeld = false;
+
+    // the file is written off the render thread, from a result it keeps alive itself
+    auto startExport = [&]() {
+        std::string path = offscreen ? offscreenDir + "/heightmap." : "heightmap_" + std::to_string(exportCount++) + ".";
+        path += heightmapFormatName(HEIGHTMAP_EXPORT_FORMAT);
+
+        // TextureReadback already printed why, writing the zeroed field would look like a flat heightmap
+        if (exportFuture.failed()) {
+            std::cout << "ERROR::EXPORT::READBACK_FAILED\n\t" << path << " not written\n";
+            exportFuture = ReadbackFuture();
+            return;
+        }
+
+        if (exportWriter.joinable()) {
+            exportWriter.join();
+        }
+        exportWriter = std::thread([result = exportFuture.share(), path, origin = exportOrigin]() {
+            if (exportNoiseTex(path, result->field, origin)) {
+                std::cout << "wrote " << path << "\n";
+            }
+        });
+        exportFuture = ReadbackFuture();
+    };
+#endif
+
+    // the 2x2 texels the heightmap is filtered from under the camera, generated
+    // on the cpu every frame so it stays above the ground whatever draws the terrain
+    Heightfield groundField(2, 2);
+    HeightQuery groundQuery(groundField, nullptr, false);
+
+    // frame times split by whether the heightmap was regenerated, printed once a second
+    double regenFrameTime = 0.0, cachedFrameTime = 0.0;
+    int regenFrames = 0, cachedFrames = 0;
+    long long triangles = 0;
+    float lastReport = wallTime();
+
+    // offscreen runs keep every frame's time for timing.csv, frames are read back into framePixels
+    std::ofstream timingFile;
+    std::vector<unsigned char> framePixels;
+    double offscreenStart = wallTime();
+    double offscreenFrameTime = 0.0;
+    double offscreenSlowest = 0.0;
+    int frame = 0;
+
+    if (offscreen) {
+        timingFile.open(offscreenDir + "/timing.csv");
+        timingFile << "frame,ms,regenerated,triangles\n";
+    }
+
     screenShader.use();
     screenShader.setInt("tex", 0);
 
     glm::mat4 view = camera.GetViewMatrix();
 
-    while (!glfwWindowShouldClose(window)) {
+    while (offscreen ? frame < offscreenFrames : !glfwWindowShouldClose(window)) {
 
-        float currentFrame = glfwGetTime();
+        double frameStart = wallTime();
+        float currentFrame = offscreen ? float(frame / OFFSCREEN_FRAME_RATE) : float(frameStart);
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
 
-        processInput(window);
-        view = camera.GetViewMatrix();
+        if (window) {
+            processInput(window);
+        }
+
+        // 1-8 pick the noise type, the first use of each type compiles its variant
+        for (int type = 0; window && type < NOISE_TYPE_COUNT; type++) {
+            if (glfwGetKey(window, GLFW_KEY_1 + type) == GLFW_PRESS && noiseParams.type != type) {
+                noiseParams.type = Noise_Type(type);
+                noiseGenShader = &selectNoiseGenVariant(noiseGenVariants, noiseParams, noise, noiseGenUniforms);
+            }
+        }
+
+        // P / O switch the fractals between a perlin and a simplex basis
+        Noise_Basis basisKey = !window ? noiseParams.basisType
+                             : glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS ? NOISE_BASIS_PERLIN
+                             : glfwGetKey(window, GLFW_KEY_O) == GLFW_PRESS ? NOISE_BASIS_SIMPLEX : noiseParams.basisType;
+        if (basisKey != noiseParams.basisType) {
+            noiseParams.basisType = basisKey;
+            noiseGenShader = &selectNoiseGenVariant(noiseGenVariants, noiseParams, noise, noiseGenUniforms);
+        }
         
-        glBindFramebuffer(GL_FRAMEBUFFER, noiseFBO);
-        glViewport(0, 0, TEX_RES, TEX_RES);
-        noiseGenShader.use();
-        noiseGenShader.setVec2("posOffset", posOffset += posOffsetDelta * deltaTime);
-        noiseGenShader.setFloat("timeOffset", 0.6f * glfwGetTime());
-        noiseGenShader.setFloat("TEX_RES", float(TEX_RES));
-        renderQuad();
+#if ANIMATE_TERRAIN
+        posOffset += posOffsetDelta * deltaTime;
+#if !STREAM_CPU_TILES && !CLIPMAP_TERRAIN && !TOROIDAL_UPDATE
+        // tiles, clipmap levels and the toroidal ring are kept across frames, animating timeOffset would invalidate all of them
+        noiseParams.timeOffset = 0.6f * currentFrame;
+#endif
+#endif
+        noiseParams.posOffset = posOffset;
+
+        bool regenerated = false;
+#if !CLIPMAP_TERRAIN
+        glm::vec2 heightMapOffset = glm::vec2(0.0f);
+        float heightMapScale = 1.0f;
+#endif
+
+#if CLIPMAP_TERRAIN
+        if (!noiseParams.sameField(streamedParams)) {
+            noise.setTimeOffset(noiseParams.timeOffset);
+            noise.basisType = noiseParams.basisType;
+            clipmapRenderer.clipmap.type = noiseParams.type;
+            clipmapRenderer.clipmap.invalidate();
+            streamedParams = noiseParams;
+        }
+        // the camera in st, through the same mapping as the CDLOD terrain
+        glm::vec2 clipmapEye = posOffset + glm::vec2(camera.pos.x, camera.pos.z) / TERRAIN_SIZE + 0.5f;
+        regenerated = clipmapRenderer.update(clipmapEye, noise, jobPool) > 0;
+#elif STREAM_CPU_TILES
+        if (!noiseParams.sameField(streamedParams)) {
+            noise.setTimeOffset(noiseParams.timeOffset);
+            noise.basisType = noiseParams.basisType;
+            tileStreamer.cache.type = noiseParams.type;
+            tileStreamer.invalidate();
+            streamedParams = noiseParams;
+        }
+        regenerated = tileStreamer.update(posOffset, noise, jobPool) > 0;
+        heightMapOffset = tileStreamer.heightMapOffset;
+        heightMapScale = tileStreamer.heightMapScale;
+        unsigned int heightMap = tileStreamer.texture;
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, tileStreamer.normalTexture);
+#else
+#if TOROIDAL_UPDATE
+        // when only posOffset moved the exposed strips are cheap, so they're drawn
+        // every frame rather than at NOISE_REGEN_RATE and the ring keeps up with the view
+        bool ringScrolled = noiseDirty.hasGenerated() && noiseParams.sameField(noiseDirty.lastGenerated())
+                         && glm::ivec2(glm::floor(noiseParams.posOffset * float(TEX_RES))) != ringOrigin;
+#else
+        bool ringScrolled = false;
+#endif
+        if (ringScrolled || noiseDirty.needsRegenerate(noiseParams, currentFrame)) {
+
+            glBindFramebuffer(GL_FRAMEBUFFER, noiseFBO);
+            glViewport(0, 0, TEX_RES, TEX_RES);
+            noiseGenShader->use();
+            noise.setTimeOffset(noiseParams.timeOffset);
+            noise.basisType = noiseParams.basisType;
+            noiseGenShader->setFloat(noiseGenUniforms.timeOffset, noise.timeOffset);
+            noiseGenShader->setVec2(noiseGenUniforms.gradRotation, noise.gradRotation);
+
+#if TOROIDAL_UPDATE
+            glm::ivec2 newOrigin = glm::ivec2(glm::floor(noiseParams.posOffset * float(TEX_RES)));
+            bool fullUpdate = !noiseDirty.hasGenerated() || !noiseParams.sameField(noiseDirty.lastGenerated());
+
+            // the window position is baked into texelOffset, posOffset itself stays 0
+            noiseGenShader->setVec2(noiseGenUniforms.posOffset, glm::vec2(0.0f));
+            glEnable(GL_SCISSOR_TEST);
+            for (const Toroidal_Rect& rect : toroidalExposedRects(ringOrigin, newOrigin, TEX_RES, fullUpdate)) {
+                glScissor(rect.x, rect.y, rect.width, rect.height);
+                noiseGenShader->setVec2(noiseGenUniforms.texelOffset, glm::vec2(float(rect.worldX - rect.x), float(rect.worldY - rect.y)));
+                renderQuad();
+            }
+            glDisable(GL_SCISSOR_TEST);
+            ringOrigin = newOrigin;
+#else
+            noiseGenShader->setVec2(noiseGenUniforms.posOffset, noiseParams.posOffset);
+            noiseGenShader->setVec2(noiseGenUniforms.texelOffset, glm::vec2(0.0f));
+            renderQuad();
+#endif
+
+            boundsReducer.reduce(noiseTex);
+            boundsReducer.read(HEIGHT_BOUNDS_READ_LEVEL, heightBounds, jobPool);
+
+            noiseDirty.markGenerated(noiseParams, currentFrame);
+            regenerated = true;
+        }
+        unsigned int heightMap = noiseTex;
+
+#if TOROIDAL_UPDATE
+        // from ringOrigin rather than posOffset, so while a full update waits on the
+        // rate limit the window drawn is still the one generated. Only the sub-texel
+        // part follows posOffset
+        glm::vec2 texel = posOffset * float(TEX_RES);
+        glm::vec2 ringTexel = glm::vec2(ringOrigin) + (texel - glm::floor(texel));
+        heightMapOffset = (ringTexel - glm::floor(ringTexel / float(TEX_RES)) * float(TEX_RES)) / float(TEX_RES);
+#endif
+#endif
+
+        // world texel under the camera, through the same st mapping as the heightmap. After
+        // the regeneration above, so noise has the time offset and basis being drawn
+        glm::vec2 cameraTexel = (posOffset + glm::vec2(camera.pos.x, camera.pos.z) / TERRAIN_SIZE + 0.5f) * float(TEX_RES);
+        glm::vec2 groundOrigin = glm::floor(cameraTexel - 0.5f);
+        generateHeightfield(groundField, noise, noiseParams.type, groundOrigin / float(TEX_RES), float(TEX_RES));
+        float ground = std::max(groundQuery.height(cameraTexel - groundOrigin), TERRAIN_WATER_LEVEL);
+        camera.KeepAbove(ground * TERRAIN_AMPLITUDE);
+
+        view = camera.GetViewMatrix();
+
+#if !CLIPMAP_TERRAIN && !STREAM_CPU_TILES
+        // one export in flight at a time, requested after this frame's regeneration so it's what gets drawn
+        bool exportPressed = window && glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS;
+        bool exportKey = window ? exportPressed && !exportKeyHeld : frame == offscreenFrames - 1;
+        exportKeyHeld = exportPressed;
+        if (exportKey && !exportFuture.valid()) {
+            exportFuture = noiseReadback.request(noiseTex);
+#if TOROIDAL_UPDATE
+            exportOrigin = ringOrigin;
+#endif
+        }
+        noiseReadback.poll(jobPool);
+        if (exportFuture.ready()) {
+            startExport();
+        }
+#endif
 
         glViewport(0, 0, framebufferWidth, framebufferHeight);
         glBindFramebuffer(GL_FRAMEBUFFER, screenFBO);
         glClearColor(0.2f, 0.05f, 0.05f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+        terrainShader.use();
+        terrainShader.setVec3(terrainViewPosLoc, camera.pos);
+        terrainShader.setMat4(terrainViewLoc, view);
+
+#if CLIPMAP_TERRAIN
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, clipmapRenderer.texture);
+
+        triangles += clipmapRenderer.draw(terrainShader, -(posOffset + 0.5f) * TERRAIN_SIZE);
+#else
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, noiseTex);
+        glBindTexture(GL_TEXTURE_2D, heightMap);
 
-        terrainShader.use();
-        terrainShader.setInt("heightMap", 0);
-        terrainShader.setVec3("viewPos", camera.pos);
-        terrainShader.setMat4("projection", proj);
-        terrainShader.setMat4("view", view);
+        terrainShader.setVec2(terrainMapOffsetLoc, heightMapOffset);
+        terrainShader.setFloat(terrainMapScaleLoc, heightMapScale);
 
-        glBindVertexArray(planeVAO);
-        glDrawElements(GL_TRIANGLES, SQUARES_PER_SIDE * SQUARES_PER_SIDE * 6, GL_UNSIGNED_INT, 0);
+        // one instance of the shared patch per selected quarter node
+        lod.setHeightBounds(&heightBounds, heightMapOffset, heightMapScale, TERRAIN_WATER_LEVEL);
+        int patchCount = lod.select(camera.pos, proj * view);
+        triangles += lod.triangleCount();
+
+        glBindBuffer(GL_ARRAY_BUFFER, patchInstanceVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(Cdlod_Patch) * patchCount, lod.patches.data(), GL_STREAM_DRAW);
+
+        glBindVertexArray(patchVAO);
+        glDrawElementsInstanced(GL_TRIANGLES, CDLOD_PATCH_QUADS * CDLOD_PATCH_QUADS * 6, GL_UNSIGNED_INT, 0, patchCount);
+#endif
+
+        if (offscreen) {
+            // surfaceless contexts have no default framebuffer, screenFBO is the frame.
+            // Timed up to glFinish, reading it back and writing it out aren't rendering
+            glFinish();
+            double frameTime = wallTime() - frameStart;
+
+            offscreenFrameTime += frameTime;
+            offscreenSlowest = std::max(offscreenSlowest, frameTime);
+            timingFile << frame << "," << 1000.0 * frameTime << "," << regenerated << "," << triangles << "\n";
+            triangles = 0;
+
+            framePixels.resize(size_t(framebufferWidth) * framebufferHeight * 3);
+            glBindFramebuffer(GL_FRAMEBUFFER, screenFBO);
+            glPixelStorei(GL_PACK_ALIGNMENT, 1);
+            glReadPixels(0, 0, framebufferWidth, framebufferHeight, GL_RGB, GL_UNSIGNED_BYTE, framePixels.data());
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+            char name[32];
+            std::snprintf(name, sizeof(name), "/frame_%04d.ppm", frame);
+            if (!writeFramePPM(offscreenDir + name, framebufferWidth, framebufferHeight, framePixels)) {
+                return -1;
+            }
+
+            frame++;
+            continue;
+        }
 
         //renderScreenFBO(screenShader, noiseTex);
         renderScreenFBO(screenShader, screenTexture);
 
         glfwSwapBuffers(window);
         glfwPollEvents();
+
+        float frameTime = wallTime() - frameStart;
+        if (regenerated) {
+            regenFrameTime += frameTime;
+            regenFrames++;
+        } else {
+            cachedFrameTime += frameTime;
+            cachedFrames++;
+        }
+
+        if (currentFrame - lastReport >= 1.0f) {
+            std::cout << "frame time: " << (regenFrames ? 1000.0 * regenFrameTime / regenFrames : 0.0) << " ms regenerating ("
+                      << regenFrames << " frames), " << (cachedFrames ? 1000.0 * cachedFrameTime / cachedFrames : 0.0)
+                      << " ms cached (" << cachedFrames << " frames), "
+                      << triangles / std::max(regenFrames + cachedFrames, 1) << " terrain triangles\n";
+            regenFrameTime = cachedFrameTime = 0.0;
+            triangles = 0;
+            regenFrames = cachedFrames = 0;
+            lastReport = currentFrame;
+        }
+    }
+
+#if !CLIPMAP_TERRAIN && !STREAM_CPU_TILES
+    noiseReadback.finish(jobPool);
+    if (exportFuture.ready()) {
+        startExport();
+    }
+    if (exportWriter.joinable()) {
+        exportWriter.join();
+    }
+#endif
+
+    if (offscreen) {
+        std::cout << "rendered " << frame << " frames: " << 1000.0 * offscreenFrameTime / frame << " ms average, "
+                  << 1000.0 * offscreenSlowest << " ms slowest, " << wallTime() - offscreenStart
+                  << " s including readback and writing\n";
+        return timingFile ? 0 : -1;
     }
 
     glfwTerminate();
     return 0;
 }
 
+Shader_Defines noiseGenDefines(const Noise_Params& params) {
+    return {
+        { "NOISE_TYPE",    std::to_string(int(params.type)) },
+        { "NOISE_OCTAVES", std::to_string(NOISE_OCTAVES) },
+        { "HASH_TYPE",     std::to_string(int(params.hashType)) },
+        { "NOISE_BASIS",   std::to_string(int(params.basisType)) },
+    };
+}
+
+// compiles the variant on first use, then uploads the uniforms that only change with the variant
+Shader& selectNoiseGenVariant(ShaderVariants& variants, const Noise_Params& params, const Noise& noise, Noise_Gen_Uniforms& uniforms) {
+
+    Shader& shader = variants.get(noiseGenDefines(params));
+
+    shader.use();
+    shader.setInt("seed", int(noise.seed));
+    shader.setIntArray("perm", noise.perm, PERM_SIZE);
+    shader.setFloat("TEX_RES", float(TEX_RES));
+
+    uniforms.timeOffset   = shader.getUniformLocation("timeOffset");
+    uniforms.gradRotation = shader.getUniformLocation("gradRotation");
+    uniforms.posOffset    = shader.getUniformLocation("posOffset");
+    uniforms.texelOffset  = shader.getUniformLocation("texelOffset");
+
+    return shader;
+}
+
 void processInput(GLFWwindow* window) {
 
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
@@ -173,7 +690,7 @@ void processInput(GLFWwindow* window) {
         camera.ProcessKeyboard(DOWN, deltaTime);
 }
 
-void renderScreenFBO(Shader screenShader, unsigned int textureToRender) {
+void renderScreenFBO(Shader& screenShader, unsigned int textureToRender) {
 
     int texWidth, texHeight;
     int miplevel = 0;
@@ -235,39 +752,42 @@ void getObjects() {
     glEnableVertexAttribArray(1);
     glBindVertexArray(0);
 
-    // plane //
-    glm::vec3* planeVertices = new glm::vec3[(SQUARES_PER_SIDE + 1) * (SQUARES_PER_SIDE + 1)];
-    glm::vec2* planeTexCoords = new glm::vec2[(SQUARES_PER_SIDE + 1) * (SQUARES_PER_SIDE + 1)];
-    unsigned int* planeIndices = new unsigned int[SQUARES_PER_SIDE * SQUARES_PER_SIDE * 6];
+    // terrain patch //
+    // the grid every CDLOD patch is drawn with, in whole quads so terrain.vert
+    // can tell the odd vertices from the even ones. Per patch placement comes
+    // from the instance buffer, filled every frame
+    glm::vec2* patchGrid = new glm::vec2[(CDLOD_PATCH_QUADS + 1) * (CDLOD_PATCH_QUADS + 1)];
+    unsigned int* patchIndices = new unsigned int[CDLOD_PATCH_QUADS * CDLOD_PATCH_QUADS * 6];
 
-    size_t GRID_POINT_COUNT = (SQUARES_PER_SIDE + 1) * (SQUARES_PER_SIDE + 1);
-    size_t SQUARE_COUNT = SQUARES_PER_SIDE * SQUARES_PER_SIDE;
+    size_t GRID_POINT_COUNT = (CDLOD_PATCH_QUADS + 1) * (CDLOD_PATCH_QUADS + 1);
+    size_t SQUARE_COUNT = CDLOD_PATCH_QUADS * CDLOD_PATCH_QUADS;
 
-    getPlaneVertices(planeVertices);
-    getPlaneTexCoords(planeTexCoords);
-    getPlaneIndices(planeIndices);
+    getPatchGrid(patchGrid);
+    getPatchIndices(patchIndices);
 
-    glGenVertexArrays(1, &planeVAO);
-    glBindVertexArray(planeVAO);
+    glGenVertexArrays(1, &patchVAO);
+    glBindVertexArray(patchVAO);
 
-    glGenBuffers(1, &planeVertexVBO);
-    glBindBuffer(GL_ARRAY_BUFFER, planeVertexVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * GRID_POINT_COUNT, planeVertices, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glGenBuffers(1, &patchGridVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, patchGridVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec2) * GRID_POINT_COUNT, patchGrid, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
 
-    glGenBuffers(1, &planeTexCoordsVBO);
-    glBindBuffer(GL_ARRAY_BUFFER, planeTexCoordsVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec2) * GRID_POINT_COUNT, planeTexCoords, GL_STATIC_DRAW);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glGenBuffers(1, &patchInstanceVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, patchInstanceVBO);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Cdlod_Patch), (void*)0);
     glEnableVertexAttribArray(1);
+    glVertexAttribDivisor(1, 1);
 
-    glGenBuffers(1, &planeEBO);
-    glBindVertexArray(planeVAO);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, planeEBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * SQUARE_COUNT * 6, planeIndices, GL_STATIC_DRAW);
+    glGenBuffers(1, &patchEBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, patchEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * SQUARE_COUNT * 6, patchIndices, GL_STATIC_DRAW);
     glBindVertexArray(0);
 
+    delete[] patchGrid;
+    delete[] patchIndices;
+
     glGenFramebuffers(1, &screenFBO);
     glBindFramebuffer(GL_FRAMEBUFFER, screenFBO);
 
@@ -295,8 +815,13 @@ void getObjects() {
     glGenTextures(1, &noiseTex);
     glBindTexture(GL_TEXTURE_2D, noiseTex);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, TEX_RES, TEX_RES, 0, GL_RED, GL_UNSIGNED_BYTE, 0);
+#if TOROIDAL_UPDATE
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+#else
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);	
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+#endif
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, noiseTex, 0);
@@ -307,47 +832,31 @@ void getObjects() {
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
-void getPlaneIndices(unsigned int planeIndices[SQUARES_PER_SIDE * SQUARES_PER_SIDE * 6]) {
-
-    for (unsigned int i = 0; i < SQUARES_PER_SIDE; i++) {
-        for (unsigned int j = 0; j < SQUARES_PER_SIDE; j++) {
+void getPatchIndices(unsigned int patchIndices[CDLOD_PATCH_QUADS * CDLOD_PATCH_QUADS * 6]) {
 
-            unsigned int vertexIndex = i * (SQUARES_PER_SIDE + 1) + j;
+    for (unsigned int i = 0; i < CDLOD_PATCH_QUADS; i++) {
+        for (unsigned int j = 0; j < CDLOD_PATCH_QUADS; j++) {
 
-            unsigned int index = (i * SQUARES_PER_SIDE + j) * 6;
+            unsigned int vertexIndex = i * (CDLOD_PATCH_QUADS + 1) + j;
 
-            planeIndices[index + 0] = vertexIndex;
-            planeIndices[index + 1] = vertexIndex + SQUARES_PER_SIDE + 1;
-            planeIndices[index + 2] = vertexIndex + SQUARES_PER_SIDE + 2;
+            unsigned int index = (i * CDLOD_PATCH_QUADS + j) * 6;
 
-            planeIndices[index + 3] = planeIndices[index + 2];
-            planeIndices[index + 4] = vertexIndex + 1;
-            planeIndices[index + 5] = planeIndices[index + 0];
-        }
-    }
-}
-
-void getPlaneTexCoords(glm::vec2 planeTexCoords[(SQUARES_PER_SIDE + 1) * (SQUARES_PER_SIDE + 1)]) {
+            patchIndices[index + 0] = vertexIndex;
+            patchIndices[index + 1] = vertexIndex + CDLOD_PATCH_QUADS + 1;
+            patchIndices[index + 2] = vertexIndex + CDLOD_PATCH_QUADS + 2;
 
-    float ratio = 1 / float(SQUARES_PER_SIDE);
-
-    for (int i = 0; i < SQUARES_PER_SIDE + 1; i++) {
-        for (int j = 0; j < SQUARES_PER_SIDE + 1; j++) {
-            planeTexCoords[i * (SQUARES_PER_SIDE + 1) + j] = glm::vec2(float(i) * ratio, float(j) * ratio);
+            patchIndices[index + 3] = patchIndices[index + 2];
+            patchIndices[index + 4] = vertexIndex + 1;
+            patchIndices[index + 5] = patchIndices[index + 0];
         }
     }
 }
 
-void getPlaneVertices(glm::vec3 planeVertices[(SQUARES_PER_SIDE + 1) * (SQUARES_PER_SIDE + 1)]) {
-
-    for (int i = 0; i < SQUARES_PER_SIDE + 1; i++) {
-        for (int j = 0; j < SQUARES_PER_SIDE + 1; j++) {
+void getPatchGrid(glm::vec2 patchGrid[(CDLOD_PATCH_QUADS + 1) * (CDLOD_PATCH_QUADS + 1)]) {
 
-            float xPos = (float(i) - float(SQUARES_PER_SIDE) / 2.0f) * SCALE;
-            float zPos = (float(j) - float(SQUARES_PER_SIDE) / 2.0f) * SCALE;
-            float yPos = 0.0f;
-
-            planeVertices[i * (SQUARES_PER_SIDE + 1) + j] = glm::vec3(xPos, yPos, zPos);
+    for (int i = 0; i < CDLOD_PATCH_QUADS + 1; i++) {
+        for (int j = 0; j < CDLOD_PATCH_QUADS + 1; j++) {
+            patchGrid[i * (CDLOD_PATCH_QUADS + 1) + j] = glm::vec2(float(i), float(j));
         }
     }
 }
@@ -400,3 +909,48 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
     camera.ProcessScroll(yoffset);
 }
+
+// seconds on a steady clock, what glfwGetTime gave before there could be no GLFW
+double wallTime() {
+    static const auto start = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// binary PPM, GL's rows are bottom first so they're written in reverse
+bool writeFramePPM(const std::string& path, int width, int height, const std::vector<unsigned char>& pixels) {
+
+    std::ofstream file(path, std::ios::binary);
+    file << "P6\n" << width << " " << height << "\n255\n";
+
+    const size_t rowBytes = size_t(width) * 3;
+    for (int y = height - 1; y >= 0; y--) {
+        file.write(reinterpret_cast<const char*>(&pixels[size_t(y) * rowBytes]), std::streamsize(rowBytes));
+    }
+
+    if (!file) {
+        std::cout << "ERROR::OFFSCREEN::FILE_NOT_WRITTEN\n\t" << path << "\n";
+        return false;
+    }
+    return true;
+}
+
+// noiseTex as a map of the heightmap window, top row first. Toroidal storage
+// holds window texel i at (ringOrigin + i) mod TEX_RES, so each row is put
+// back in order from the two pieces either side of the seam
+bool exportNoiseTex(const std::string& path, const Heightfield& field, glm::ivec2 ringOrigin) {
+
+    HeightmapWriter writer(path, HEIGHTMAP_EXPORT_FORMAT, field.width, field.height);
+    std::vector<float> row(field.width);
+
+    const int seamX = ((ringOrigin.x % field.width) + field.width) % field.width;
+    const int firstY = ((ringOrigin.y % field.height) + field.height) % field.height;
+
+    for (int y = field.height - 1; y >= 0 && writer.valid; y--) {
+        const float* source = field.row((firstY + y) % field.height);
+        std::copy(source + seamX, source + field.width, row.begin());
+        std::copy(source, source + seamX, row.begin() + (field.width - seamX));
+        writer.writeRows(row.data(), 1, field.width);
+    }
+
+    return writer.finish();
+}
@@ -0,0 +1,593 @@
+#include <algorithm>
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+#include "noise.hpp"
+#include "simd.hpp"
+#include "simd/noise_kernels.hpp"
+
+#define NOISE_TWO_OVER_PI 0.636619772367581343f
+#define NOISE_PIO2_1 1.5703125f
+#define NOISE_PIO2_2 4.837512969970703125e-4f
+#define NOISE_PIO2_3 7.54978995489188216e-8f
+
+#define NOISE_HALF_PI 1.57079632679489662f
+
+Noise::Noise(float timeOffsetIn, Hash_Type hashTypeIn, unsigned int seedIn) {
+
+    simdTarget = detectSimdTarget();
+    basisType = NOISE_BASIS_PERLIN;
+    timeOffset = timeOffsetIn;
+    gradRotation = glm::vec2(hashSin(timeOffset + NOISE_HALF_PI), hashSin(timeOffset));
+    setHash(hashTypeIn, seedIn);
+}
+
+void Noise::setTimeOffset(float timeOffsetIn) {
+
+    timeOffset = timeOffsetIn;
+    // hashSin rather than libm so every machine rotates by the same amount,
+    // main.cpp uploads this exact value to noisegen.frag
+    gradRotation = glm::vec2(hashSin(timeOffset + NOISE_HALF_PI), hashSin(timeOffset));
+}
+
+void Noise::setHash(Hash_Type hashTypeIn, unsigned int seedIn) {
+
+    hashType = hashTypeIn;
+    seed = seedIn;
+
+    // Fisher-Yates driven by a plain lcg, std distributions aren't the same across standard libraries
+    for (int i = 0; i < PERM_SIZE; i++) {
+        perm[i] = i;
+    }
+
+    unsigned int state = seed;
+    for (int i = PERM_SIZE - 1; i > 0; i--) {
+        state = state * PCG_MULTIPLIER + PCG_INCREMENT;
+        int j = int((state >> 16) % unsigned(i + 1));
+        int tmp = perm[i];
+        perm[i] = perm[j];
+        perm[j] = tmp;
+    }
+}
+
+float Noise::sample(Noise_Type type, glm::vec2 st) const {
+
+    switch (type) {
+        case NOISE_PERLIN:          return perlin(st);
+        case NOISE_FBM:             return fbm(st);
+        case NOISE_RIDGE:           return ridge(st);
+        case NOISE_TURBULENCE:      return turbulence(st);
+        case NOISE_DOMAIN_WARP_FBM: return domainWarpFBM(st);
+        case NOISE_VORONOI:         return worley(st).x;
+        case NOISE_VORONOI_F2:      return worley(st).y;
+        case NOISE_VORONOI_F2_MINUS_F1: {
+            glm::vec2 f = worley(st);
+            return f.y - f.x;
+        }
+    }
+
+    return 0.0f;
+}
+
+float Noise::domainWarpFBM(glm::vec2 st) const {
+
+    glm::vec2 domWarp = glm::vec2(1.1f, -3.2f);
+
+    float fbm1 = fbm(st);
+    float fbm2 = fbm(st + domWarp);
+
+    float fbm3 = fbm(st * 4.0f * fbm1 + glm::vec2(1.7f, 9.2f));
+    float fbm4 = fbm(st * 4.0f * fbm2 + glm::vec2(8.3f, 2.8f));
+
+    return fbm(glm::vec2(fbm3, fbm4));
+}
+
+float Noise::fbm(glm::vec2 st) const {
+
+    float value = 0.0f;
+
+    float frequency = 4.0f;
+    float lacunarity = 2.0f;
+    float persistence = 0.8f;
+
+    glm::vec2 pos = st * frequency;
+
+    for (int i = 0; i < NOISE_OCTAVES; i++) {
+
+        value += basis(pos) * persistence;
+        pos *= lacunarity;
+        persistence *= persistence;
+    }
+
+    return value;
+}
+
+float Noise::perlin(glm::vec2 st) const {
+
+    glm::vec2 uv = glm::fract(st);
+    glm::vec2 gridVec = glm::floor(st);
+
+    glm::vec2 bottomLeft  = gridVec;
+    glm::vec2 bottomRight = gridVec + glm::vec2(1.0f, 0.0f);
+    glm::vec2 topLeft     = gridVec + glm::vec2(0.0f, 1.0f);
+    glm::vec2 topRight    = gridVec + glm::vec2(1.0f, 1.0f);
+
+    glm::vec2 randBottomLeft  = rand2(bottomLeft);
+    glm::vec2 randBottomRight = rand2(bottomRight);
+    glm::vec2 randTopLeft     = rand2(topLeft);
+    glm::vec2 randTopRight    = rand2(topRight);
+
+    float dotBottomLeft  = glm::dot(uv, randBottomLeft);
+    float dotBottomRight = glm::dot(uv - glm::vec2(1.0f, 0.0f), randBottomRight);
+    float dotTopLeft     = glm::dot(uv - glm::vec2(0.0f, 1.0f), randTopLeft);
+    float dotTopRight    = glm::dot(uv - glm::vec2(1.0f, 1.0f), randTopRight);
+
+    float u = fade(uv.x);
+    float v = fade(uv.y);
+
+    return glm::mix(glm::mix(dotBottomLeft, dotBottomRight, u), glm::mix(dotTopLeft, dotTopRight, u), v);
+}
+
+// one corner of simplex(), d is st relative to the corner
+static inline float simplexCorner(glm::vec2 d, glm::vec2 grad) {
+
+    float falloff = std::max(0.5f - (d.x * d.x + d.y * d.y), 0.0f);
+    falloff *= falloff;
+    return falloff * falloff * (grad.x * d.x + grad.y * d.y);
+}
+
+float Noise::simplex(glm::vec2 st) const {
+
+    // skew onto the square lattice to find the cell, the diagonal splits it
+    // into the two triangles st could be in
+    float skew = (st.x + st.y) * SIMPLEX_SKEW;
+    glm::vec2 cell = glm::floor(st + skew);
+    float unskew = (cell.x + cell.y) * SIMPLEX_UNSKEW;
+
+    glm::vec2 d0 = st - (cell - unskew);
+
+    // middle corner is one step along x in the lower triangle, along y in the upper
+    float stepX = d0.x >= d0.y ? 1.0f : 0.0f;
+    glm::vec2 middle = glm::vec2(stepX, 1.0f - stepX);
+
+    glm::vec2 d1 = (d0 - middle) + SIMPLEX_UNSKEW;
+    glm::vec2 d2 = (d0 - 1.0f) + SIMPLEX_UNSKEW_2;
+
+    float n0 = simplexCorner(d0, rand2(cell));
+    float n1 = simplexCorner(d1, rand2(cell + middle));
+    float n2 = simplexCorner(d2, rand2(cell + 1.0f));
+
+    return SIMPLEX_SCALE * ((n0 + n1) + n2);
+}
+
+float Noise::basis(glm::vec2 st) const {
+    return basisType == NOISE_BASIS_SIMPLEX ? simplex(st) : perlin(st);
+}
+
+float Noise::ridge(glm::vec2 st) const {
+
+    float offset = 1.0f;
+    float value = turbulence(st);
+    value = offset - value;
+    value = value * value * value;
+    return value;
+}
+
+float Noise::turbulence(glm::vec2 st) const {
+
+    float amp = 0.5f;
+    float frequency = 2.0f;
+    float lacunarity = 2.0f;
+
+    float value = 0;
+
+    st *= frequency;
+
+    for (int i = 0; i < NOISE_OCTAVES; i++) {
+
+        value += amp * std::abs(basis(st));
+        st *= lacunarity;
+        amp *= 0.5f;
+    }
+
+    return value;
+}
+
+glm::vec2 Noise::worley(glm::vec2 st) const {
+
+    float px = st.x * float(VORONOI_SCALE);
+    float py = st.y * float(VORONOI_SCALE);
+
+    // work relative to the cell so precision doesn't drop off far from the origin
+    float cellX = std::floor(px);
+    float cellY = std::floor(py);
+    float fx = px - cellX;
+    float fy = py - cellY;
+
+    // squared distances, nothing in the 3x3 neighbourhood is further than 8
+    float f1 = 8.0f;
+    float f2 = 8.0f;
+
+    for (int j = -1; j <= 1; j++) {
+        for (int i = -1; i <= 1; i++) {
+
+            glm::vec2 offset = rand2(glm::vec2(cellX + float(i), cellY + float(j)));
+
+            float dx = (float(i) + 0.5f + offset.x * WORLEY_JITTER) - fx;
+            float dy = (float(j) + 0.5f + offset.y * WORLEY_JITTER) - fy;
+            float dist = dx * dx + dy * dy;
+
+            // branchless form of the usual insert, the simd kernels do the same
+            f2 = std::min(f2, std::max(f1, dist));
+            f1 = std::min(f1, dist);
+        }
+    }
+
+    return glm::vec2(std::sqrt(f1), std::sqrt(f2));
+}
+
+void Noise::sampleBatch(Noise_Type type, const float* xs, const float* ys, float* out, int count) const {
+
+    switch (type) {
+        case NOISE_PERLIN:          perlinBatch(xs, ys, out, count); return;
+        case NOISE_FBM:             fbmBatch(xs, ys, out, count); return;
+        case NOISE_RIDGE:           ridgeBatch(xs, ys, out, count); return;
+        case NOISE_TURBULENCE:      turbulenceBatch(xs, ys, out, count); return;
+        case NOISE_DOMAIN_WARP_FBM: domainWarpFBMBatch(xs, ys, out, count); return;
+        case NOISE_VORONOI:
+        case NOISE_VORONOI_F2:
+        case NOISE_VORONOI_F2_MINUS_F1:
+            break;
+    }
+
+    float f1[NOISE_BATCH_SIZE], f2[NOISE_BATCH_SIZE];
+
+    for (int start = 0; start < count; start += NOISE_BATCH_SIZE) {
+
+        int n = count - start < NOISE_BATCH_SIZE ? count - start : NOISE_BATCH_SIZE;
+        worleyBatch(xs + start, ys + start, f1, f2, n);
+
+        for (int i = 0; i < n; i++) {
+            out[start + i] = type == NOISE_VORONOI ? f1[i] : type == NOISE_VORONOI_F2 ? f2[i] : f2[i] - f1[i];
+        }
+    }
+}
+
+void Noise::domainWarpFBMBatch(const float* xs, const float* ys, float* out, int count) const {
+
+    float warpX[NOISE_BATCH_SIZE], warpY[NOISE_BATCH_SIZE];
+    float fbm1[NOISE_BATCH_SIZE], fbm2[NOISE_BATCH_SIZE];
+
+    for (int start = 0; start < count; start += NOISE_BATCH_SIZE) {
+
+        int n = count - start < NOISE_BATCH_SIZE ? count - start : NOISE_BATCH_SIZE;
+        const float* x = xs + start;
+        const float* y = ys + start;
+
+        fbmBatch(x, y, fbm1, n);
+
+        for (int i = 0; i < n; i++) {
+            warpX[i] = x[i] + 1.1f;
+            warpY[i] = y[i] - 3.2f;
+        }
+        fbmBatch(warpX, warpY, fbm2, n);
+
+        for (int i = 0; i < n; i++) {
+            warpX[i] = x[i] * 4.0f * fbm1[i] + 1.7f;
+            warpY[i] = y[i] * 4.0f * fbm1[i] + 9.2f;
+        }
+        fbmBatch(warpX, warpY, fbm1, n);
+
+        for (int i = 0; i < n; i++) {
+            warpX[i] = x[i] * 4.0f * fbm2[i] + 8.3f;
+            warpY[i] = y[i] * 4.0f * fbm2[i] + 2.8f;
+        }
+        fbmBatch(warpX, warpY, fbm2, n);
+
+        fbmBatch(fbm1, fbm2, out + start, n);
+    }
+}
+
+void Noise::fbmBatch(const float* xs, const float* ys, float* out, int count) const {
+
+    float posX[NOISE_BATCH_SIZE], posY[NOISE_BATCH_SIZE], octave[NOISE_BATCH_SIZE];
+
+    for (int start = 0; start < count; start += NOISE_BATCH_SIZE) {
+
+        int n = count - start < NOISE_BATCH_SIZE ? count - start : NOISE_BATCH_SIZE;
+        float* value = out + start;
+
+        float frequency = 4.0f;
+        float lacunarity = 2.0f;
+        float persistence = 0.8f;
+
+        for (int i = 0; i < n; i++) {
+            posX[i] = xs[start + i] * frequency;
+            posY[i] = ys[start + i] * frequency;
+            value[i] = 0.0f;
+        }
+
+        for (int o = 0; o < NOISE_OCTAVES; o++) {
+
+            basisBatch(posX, posY, octave, n);
+
+            for (int i = 0; i < n; i++) {
+                value[i] += octave[i] * persistence;
+                posX[i] *= lacunarity;
+                posY[i] *= lacunarity;
+            }
+            persistence *= persistence;
+        }
+    }
+}
+
+void Noise::perlinBatch(const float* xs, const float* ys, float* out, int count) const {
+
+#ifdef TERRAIN_SIMD_X86
+    Noise_Kernel_Params params = { hashType, seed, timeOffset, gradRotation.x, gradRotation.y, perm };
+#endif
+
+    switch (simdTarget) {
+#ifdef TERRAIN_SIMD_X86
+        case SIMD_SSE42:  perlinBatchSSE42(xs, ys, out, count, params); return;
+        case SIMD_AVX2:   perlinBatchAVX2(xs, ys, out, count, params); return;
+        case SIMD_AVX512: perlinBatchAVX512(xs, ys, out, count, params); return;
+#endif
+        default:
+            for (int i = 0; i < count; i++) {
+                out[i] = perlin(glm::vec2(xs[i], ys[i]));
+            }
+            return;
+    }
+}
+
+void Noise::simplexBatch(const float* xs, const float* ys, float* out, int count) const {
+
+#ifdef TERRAIN_SIMD_X86
+    Noise_Kernel_Params params = { hashType, seed, timeOffset, gradRotation.x, gradRotation.y, perm };
+#endif
+
+    switch (simdTarget) {
+#ifdef TERRAIN_SIMD_X86
+        case SIMD_SSE42:  simplexBatchSSE42(xs, ys, out, count, params); return;
+        case SIMD_AVX2:   simplexBatchAVX2(xs, ys, out, count, params); return;
+        case SIMD_AVX512: simplexBatchAVX512(xs, ys, out, count, params); return;
+#endif
+        default:
+            for (int i = 0; i < count; i++) {
+                out[i] = simplex(glm::vec2(xs[i], ys[i]));
+            }
+            return;
+    }
+}
+
+void Noise::basisBatch(const float* xs, const float* ys, float* out, int count) const {
+
+    if (basisType == NOISE_BASIS_SIMPLEX) {
+        simplexBatch(xs, ys, out, count);
+    } else {
+        perlinBatch(xs, ys, out, count);
+    }
+}
+
+void Noise::ridgeBatch(const float* xs, const float* ys, float* out, int count) const {
+
+    float offset = 1.0f;
+    turbulenceBatch(xs, ys, out, count);
+
+    for (int i = 0; i < count; i++) {
+        float value = offset - out[i];
+        out[i] = value * value * value;
+    }
+}
+
+void Noise::turbulenceBatch(const float* xs, const float* ys, float* out, int count) const {
+
+    float posX[NOISE_BATCH_SIZE], posY[NOISE_BATCH_SIZE], octave[NOISE_BATCH_SIZE];
+
+    for (int start = 0; start < count; start += NOISE_BATCH_SIZE) {
+
+        int n = count - start < NOISE_BATCH_SIZE ? count - start : NOISE_BATCH_SIZE;
+        float* value = out + start;
+
+        float amp = 0.5f;
+        float frequency = 2.0f;
+        float lacunarity = 2.0f;
+
+        for (int i = 0; i < n; i++) {
+            posX[i] = xs[start + i] * frequency;
+            posY[i] = ys[start + i] * frequency;
+            value[i] = 0.0f;
+        }
+
+        for (int o = 0; o < NOISE_OCTAVES; o++) {
+
+            basisBatch(posX, posY, octave, n);
+
+            for (int i = 0; i < n; i++) {
+                value[i] += amp * std::abs(octave[i]);
+                posX[i] *= lacunarity;
+                posY[i] *= lacunarity;
+            }
+            amp *= 0.5f;
+        }
+    }
+}
+
+void Noise::worleyBatch(const float* xs, const float* ys, float* f1, float* f2, int count) const {
+
+#ifdef TERRAIN_SIMD_X86
+    if (simdTarget != SIMD_SCALAR) {
+
+        Noise_Kernel_Params params = { hashType, seed, timeOffset, gradRotation.x, gradRotation.y, perm };
+        float cellX[NOISE_BATCH_SIZE], cellY[NOISE_BATCH_SIZE];
+
+        // the kernels take cell space coordinates, scaled here the same way worley() does
+        for (int start = 0; start < count; start += NOISE_BATCH_SIZE) {
+
+            int n = count - start < NOISE_BATCH_SIZE ? count - start : NOISE_BATCH_SIZE;
+
+            for (int i = 0; i < n; i++) {
+                cellX[i] = xs[start + i] * float(VORONOI_SCALE);
+                cellY[i] = ys[start + i] * float(VORONOI_SCALE);
+            }
+
+            switch (simdTarget) {
+                case SIMD_SSE42:  worleyBatchSSE42(cellX, cellY, f1 + start, f2 + start, n, params); break;
+                case SIMD_AVX2:   worleyBatchAVX2(cellX, cellY, f1 + start, f2 + start, n, params); break;
+                case SIMD_AVX512: worleyBatchAVX512(cellX, cellY, f1 + start, f2 + start, n, params); break;
+                case SIMD_SCALAR: break;
+            }
+        }
+        return;
+    }
+#endif
+
+    for (int i = 0; i < count; i++) {
+        glm::vec2 f = worley(glm::vec2(xs[i], ys[i]));
+        f1[i] = f.x;
+        f2[i] = f.y;
+    }
+}
+
+float Noise::fade(float t) {
+    return ((6 * t - 15) * t + 10) * t * t * t;
+}
+
+// cephes style sinf: reduce to [-pi/4, pi/4] around the nearest quarter turn,
+// then pick the sin or cos polynomial by quadrant. The simd kernels in
+// src/simd/noise_kernels.inl do exactly the same operations
+float Noise::hashSin(float x) {
+
+    float qf = std::nearbyint(x * NOISE_TWO_OVER_PI);
+    int q = int(qf);
+
+    float r = ((x - qf * NOISE_PIO2_1) - qf * NOISE_PIO2_2) - qf * NOISE_PIO2_3;
+    float z = r * r;
+
+    float value;
+    if (q & 1) {
+        value = ((2.443315711809948e-5f * z - 1.388731625493765e-3f) * z + 4.166664568298827e-2f) * z * z - 0.5f * z + 1.0f;
+    } else {
+        value = ((-1.9515295891e-4f * z + 8.3321608736e-3f) * z - 1.6666654611e-1f) * z * r + r;
+    }
+
+    return (q & 2) ? -value : value;
+}
+
+float Noise::rand(glm::vec2 st) {
+    float x = hashSin(glm::dot(st + 0.01f, glm::vec2(12.9898f, 78.233f))) * 43758.5453f;
+    return x - std::floor(x);
+}
+
+glm::vec2 Noise::rand2(glm::vec2 p) const {
+
+    if (hashType != HASH_SIN) {
+        return hashGradient(int(p.x), int(p.y));
+    }
+
+    float a = hashSin(glm::dot(p + 12.0422f, glm::vec2(127.1f, 311.7f))) * 43758.5453f;
+    float b = hashSin(glm::dot(p + 5.73223f, glm::vec2(269.5f, 183.3f))) * 43758.5453f;
+    a -= std::floor(a);
+    b -= std::floor(b);
+    glm::vec2 grad = glm::vec2(hashSin(a), hashSin(b));
+    grad *= 43758.5453f;
+    return glm::vec2(hashSin(grad.x + timeOffset), hashSin(grad.y + timeOffset));
+}
+
+static void pcg2d(unsigned int& x, unsigned int& y) {
+
+    x = x * PCG_MULTIPLIER + PCG_INCREMENT;
+    y = y * PCG_MULTIPLIER + PCG_INCREMENT;
+
+    x += y * PCG_MULTIPLIER;
+    y += x * PCG_MULTIPLIER;
+    x ^= x >> 16;
+    y ^= y >> 16;
+    x += y * PCG_MULTIPLIER;
+    y += x * PCG_MULTIPLIER;
+    x ^= x >> 16;
+    y ^= y >> 16;
+}
+
+static unsigned int rotateLeft(unsigned int h, int bits) {
+    return (h << bits) | (h >> (32 - bits));
+}
+
+static unsigned int xxhash2d(unsigned int x, unsigned int y, unsigned int seed) {
+
+    unsigned int h = seed + XXHASH_PRIME5 + 8u;
+    h += x * XXHASH_PRIME3;
+    h = rotateLeft(h, 17) * XXHASH_PRIME4;
+    h += y * XXHASH_PRIME3;
+    h = rotateLeft(h, 17) * XXHASH_PRIME4;
+
+    h ^= h >> 15;
+    h *= XXHASH_PRIME2;
+    h ^= h >> 13;
+    h *= XXHASH_PRIME3;
+    h ^= h >> 16;
+    return h;
+}
+
+// integer hashes keep only exact integer -> float conversions and power of two
+// scales, so the gradient is the same on every cpu and gpu
+glm::vec2 Noise::hashGradient(int x, int y) const {
+
+    glm::vec2 grad;
+
+    if (hashType == HASH_PCG) {
+        unsigned int hx = unsigned(x);
+        unsigned int hy = unsigned(y) ^ seed;
+        pcg2d(hx, hy);
+        grad = glm::vec2(float(hx >> 16) * HASH_UNIT_SCALE - 1.0f, float(hy >> 16) * HASH_UNIT_SCALE - 1.0f);
+    } else if (hashType == HASH_XXHASH) {
+        unsigned int h = xxhash2d(unsigned(x), unsigned(y), seed);
+        grad = glm::vec2(float(h & 0xffff) * HASH_UNIT_SCALE - 1.0f, float(h >> 16) * HASH_UNIT_SCALE - 1.0f);
+    } else {
+        int h = perm[(perm[x & (PERM_SIZE - 1)] + y) & (PERM_SIZE - 1)] & 7;
+        grad = glm::vec2(PERM_GRAD_X[h], PERM_GRAD_Y[h]);
+    }
+
+    return glm::vec2(grad.x * gradRotation.x - grad.y * gradRotation.y,
+                     grad.x * gradRotation.y + grad.y * gradRotation.x);
+}
+
+const char* noiseTypeName(Noise_Type type) {
+
+    switch (type) {
+        case NOISE_PERLIN:              return "perlin";
+        case NOISE_FBM:                 return "fbm";
+        case NOISE_RIDGE:               return "ridge";
+        case NOISE_TURBULENCE:          return "turbulence";
+        case NOISE_DOMAIN_WARP_FBM:     return "domain-warp";
+        case NOISE_VORONOI:             return "voronoi";
+        case NOISE_VORONOI_F2:          return "voronoi-f2";
+        case NOISE_VORONOI_F2_MINUS_F1: return "voronoi-f2-f1";
+    }
+
+    return "unknown";
+}
+
+const char* noiseBasisName(Noise_Basis basis) {
+
+    switch (basis) {
+        case NOISE_BASIS_PERLIN:  return "perlin";
+        case NOISE_BASIS_SIMPLEX: return "simplex";
+    }
+
+    return "unknown";
+}
+
+const char* hashTypeName(Hash_Type type) {
+
+    switch (type) {
+        case HASH_SIN:         return "sin";
+        case HASH_PCG:         return "pcg";
+        case HASH_XXHASH:      return "xxhash";
+        case HASH_PERMUTATION: return "permutation";
+    }
+
+    return "unknown";
+}
@@ -0,0 +1,38 @@
+#include "noise_params.hpp"
+
+bool Noise_Params::operator==(const Noise_Params& other) const {
+    return sameField(other) && posOffset == other.posOffset;
+}
+
+bool Noise_Params::sameField(const Noise_Params& other) const {
+    return type == other.type && hashType == other.hashType && seed == other.seed && timeOffset == other.timeOffset
+        && basisType == other.basisType;
+}
+
+NoiseDirtyTracker::NoiseDirtyTracker(float maxRateIn) {
+
+    maxRate = maxRateIn;
+    generated = Noise_Params();
+    generatedTime = 0.0;
+    valid = false;
+}
+
+bool NoiseDirtyTracker::needsRegenerate(const Noise_Params& current, double time) const {
+
+    if (!valid) {
+        return true;
+    }
+
+    if (current == generated) {
+        return false;
+    }
+
+    return maxRate <= 0.0f || time - generatedTime >= 1.0 / maxRate;
+}
+
+void NoiseDirtyTracker::markGenerated(const Noise_Params& current, double time) {
+
+    generated = current;
+    generatedTime = time;
+    valid = true;
+}
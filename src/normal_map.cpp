@@ -0,0 +1,91 @@
+#include <algorithm>
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+#include "heightfield.hpp"
+#include "job_pool.hpp"
+#include "normal_map.hpp"
+#include "simd.hpp"
+#include "simd/normal_map_kernels.hpp"
+
+NormalMap::NormalMap(int widthIn, int heightIn) {
+
+    width = widthIn;
+    height = heightIn;
+    data.assign(size_t(width) * height * 2, 0.0f);
+}
+
+glm::vec3 NormalMap::at(int x, int y) const {
+
+    const float* texel = row(y) + 2 * x;
+    return glm::vec3(texel[0], std::sqrt(std::max(0.0f, 1.0f - texel[0] * texel[0] - texel[1] * texel[1])), texel[1]);
+}
+
+// normalize(left - right, 2 * texelSize / heightScale, below - above) written
+// so y is 1 before normalizing. The simd kernels do the same operations
+static inline void texelNormal(float left, float right, float below, float above, float scale, float* out) {
+
+    float slopeX = (left - right) * scale;
+    float slopeZ = (below - above) * scale;
+
+    float invLength = 1.0f / std::sqrt((slopeX * slopeX + slopeZ * slopeZ) + 1.0f);
+    out[0] = slopeX * invLength;
+    out[1] = slopeZ * invLength;
+}
+
+// interior texels of a row the SIMD kernels can take, returns the first x left to the scalar path
+static int normalRowWide(Simd_Target target, const float* below, const float* row, const float* above, float* out, int width,
+                         float scale) {
+
+    switch (target) {
+#ifdef TERRAIN_SIMD_X86
+        case SIMD_SSE42:  return normalMapRowSSE42(below, row, above, out, width, scale);
+        case SIMD_AVX2:   return normalMapRowAVX2(below, row, above, out, width, scale);
+        case SIMD_AVX512: return normalMapRowAVX512(below, row, above, out, width, scale);
+#endif
+        default:          return 1;
+    }
+}
+
+void generateNormalMap(const Heightfield& field, NormalMap& normals, const Normal_Map_Params& params, JobPool& pool) {
+
+    const int width = field.width;
+    const int height = field.height;
+    const float scale = params.heightScale / (2.0f * params.texelSize);
+
+    // neighbour row / column index past an edge
+    auto neighbour = [&](int i, int size) {
+        if (params.wrap) {
+            return (i + size) % size;
+        }
+        return std::min(std::max(i, 0), size - 1);
+    };
+
+    const int bands = (height + NORMAL_MAP_BAND_ROWS - 1) / NORMAL_MAP_BAND_ROWS;
+
+    pool.parallelFor(bands, [&](int band) {
+
+        const int rowEnd = std::min(height, (band + 1) * NORMAL_MAP_BAND_ROWS);
+
+        for (int y = band * NORMAL_MAP_BAND_ROWS; y < rowEnd; y++) {
+
+            const float* row = field.row(y);
+            const float* below = field.row(neighbour(y - 1, height));
+            const float* above = field.row(neighbour(y + 1, height));
+            float* out = normals.row(y);
+
+            texelNormal(row[neighbour(-1, width)], row[neighbour(1, width)], below[0], above[0], scale, out);
+            if (width == 1) {
+                continue;
+            }
+
+            for (int x = normalRowWide(params.simdTarget, below, row, above, out, width, scale); x < width - 1; x++) {
+                texelNormal(row[x - 1], row[x + 1], below[x], above[x], scale, out + 2 * x);
+            }
+
+            const int last = width - 1;
+            texelNormal(row[last - 1], row[neighbour(width, width)], below[last], above[last], scale, out + 2 * last);
+        }
+    });
+}
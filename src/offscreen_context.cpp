@@ -0,0 +1,155 @@
+#include <cstring>
+#include <iostream>
+
+#ifdef TERRAIN_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include "offscreen_context.hpp"
+
+#ifdef TERRAIN_EGL
+
+OffscreenContext::OffscreenContext() {
+
+    valid = false;
+    display = EGL_NO_DISPLAY;
+    context = EGL_NO_CONTEXT;
+    surface = EGL_NO_SURFACE;
+    error = EGL_SUCCESS;
+
+    // surfaceless needs no config with a surface type, just the extension
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if (clientExtensions && std::strstr(clientExtensions, "EGL_MESA_platform_surfaceless")) {
+
+        auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (getPlatformDisplay) {
+            valid = createContext(getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL), false);
+        }
+    }
+
+    if (!valid) {
+        valid = createContext(eglGetDisplay(EGL_DEFAULT_DISPLAY), true);
+    }
+
+    if (!valid) {
+        std::cout << "ERROR::OFFSCREEN::CONTEXT_NOT_CREATED\n\tneither an EGL surfaceless nor a pbuffer GL 3.3 core context, EGL error 0x"
+                  << std::hex << error << std::dec << "\n";
+    }
+}
+
+OffscreenContext::~OffscreenContext() {
+    destroyContext();
+}
+
+void* OffscreenContext::getProcAddress(const char* name) {
+    return (void*)eglGetProcAddress(name);
+}
+
+bool OffscreenContext::createContext(void* displayIn, bool pbuffer) {
+
+    if (displayIn == EGL_NO_DISPLAY || !eglInitialize(displayIn, NULL, NULL)) {
+        error = eglGetError();
+        return false;
+    }
+    display = displayIn;
+
+    // anything past eglInitialize has to be undone, or a failed surfaceless
+    // attempt leaks its display when the pbuffer one replaces it
+    auto fail = [this]() {
+        error = eglGetError();
+        destroyContext();
+        return false;
+    };
+
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        return fail();
+    }
+
+    const EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, pbuffer ? EGL_PBUFFER_BIT : 0,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+
+    EGLConfig config = NULL;
+    EGLint configCount = 0;
+    eglChooseConfig(display, configAttributes, &config, 1, &configCount);
+
+    // surfaceless contexts can go without a config when nothing matches
+    if (configCount == 0 && pbuffer) {
+        return fail();
+    }
+
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+
+    context = eglCreateContext(display, configCount ? config : EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, contextAttributes);
+    if (context == EGL_NO_CONTEXT) {
+        return fail();
+    }
+
+    if (pbuffer) {
+        const EGLint surfaceAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+        if (surface == EGL_NO_SURFACE) {
+            return fail();
+        }
+    }
+
+    if (!eglMakeCurrent(display, surface, surface, context)) {
+        return fail();
+    }
+    return true;
+}
+
+void OffscreenContext::destroyContext() {
+
+    if (display == EGL_NO_DISPLAY) {
+        return;
+    }
+
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (context != EGL_NO_CONTEXT) {
+        eglDestroyContext(display, context);
+    }
+    if (surface != EGL_NO_SURFACE) {
+        eglDestroySurface(display, surface);
+    }
+    eglTerminate(display);
+
+    display = EGL_NO_DISPLAY;
+    context = EGL_NO_CONTEXT;
+    surface = EGL_NO_SURFACE;
+}
+
+#else
+
+OffscreenContext::OffscreenContext() {
+
+    valid = false;
+    display = context = surface = nullptr;
+    error = 0;
+
+    std::cout << "ERROR::OFFSCREEN::NO_EGL\n\tbuilt without EGL, off-screen rendering is unavailable\n";
+}
+
+OffscreenContext::~OffscreenContext() {
+}
+
+void OffscreenContext::destroyContext() {
+}
+
+void* OffscreenContext::getProcAddress(const char* name) {
+    return nullptr;
+}
+
+bool OffscreenContext::createContext(void* displayIn, bool pbuffer) {
+    return false;
+}
+
+#endif
@@ -0,0 +1,174 @@
+#include <algorithm>
+#include <utility>
+
+#include "pipe_erosion.hpp"
+#include "simd/pipe_erosion_kernels.hpp"
+
+// rows are padded to a multiple of the widest kernel so every sweep runs whole vectors
+#define PIPE_STRIDE_ALIGN 16
+
+static void pipeErosionRows(Simd_Target target, Pipe_Sweep sweep, const Pipe_Kernel_State& state, int rowBegin, int rowEnd) {
+
+    switch (target) {
+#ifdef TERRAIN_SIMD_X86
+        case SIMD_SSE42:  pipeErosionRowsSSE42(sweep, state, rowBegin, rowEnd); return;
+        case SIMD_AVX2:   pipeErosionRowsAVX2(sweep, state, rowBegin, rowEnd); return;
+        case SIMD_AVX512: pipeErosionRowsAVX512(sweep, state, rowBegin, rowEnd); return;
+#endif
+        default:          pipeErosionRowsScalar(sweep, state, rowBegin, rowEnd); return;
+    }
+}
+
+PipeErosion::PipeErosion(int widthIn, int heightIn) {
+
+    simdTarget = detectSimdTarget();
+    width = std::max(2, widthIn);
+    height = std::max(2, heightIn);
+    stride = (width + 2 + PIPE_STRIDE_ALIGN - 1) / PIPE_STRIDE_ALIGN * PIPE_STRIDE_ALIGN;
+
+    size_t size = size_t(height + 2) * stride;
+    terrain.assign(size, 0.0f);
+    water.assign(size, 0.0f);
+    sediment.assign(size, 0.0f);
+    sedimentNext.assign(size, 0.0f);
+    fluxLeft.assign(size, 0.0f);
+    fluxRight.assign(size, 0.0f);
+    fluxBottom.assign(size, 0.0f);
+    fluxTop.assign(size, 0.0f);
+    velocityX.assign(size, 0.0f);
+    velocityY.assign(size, 0.0f);
+    capacity.assign(size, 0.0f);
+
+    mask.assign(stride, 0.0f);
+    column.resize(stride);
+    for (int x = 0; x < stride; x++) {
+        column[x] = float(x);
+    }
+    for (int x = 1; x <= width; x++) {
+        mask[x] = 1.0f;
+    }
+
+    reset();
+}
+
+void PipeErosion::reset() {
+
+    std::fill(water.begin(), water.end(), PIPE_GHOST_WATER);
+    std::fill(sediment.begin(), sediment.end(), 0.0f);
+    std::fill(sedimentNext.begin(), sedimentNext.end(), 0.0f);
+    std::fill(fluxLeft.begin(), fluxLeft.end(), 0.0f);
+    std::fill(fluxRight.begin(), fluxRight.end(), 0.0f);
+    std::fill(fluxBottom.begin(), fluxBottom.end(), 0.0f);
+    std::fill(fluxTop.begin(), fluxTop.end(), 0.0f);
+    std::fill(velocityX.begin(), velocityX.end(), 0.0f);
+    std::fill(velocityY.begin(), velocityY.end(), 0.0f);
+    std::fill(capacity.begin(), capacity.end(), 0.0f);
+
+    for (int y = 0; y < height; y++) {
+        std::fill_n(&water[index(0, y)], width, 0.0f);
+    }
+}
+
+// ghost terrain copies the nearest field cell, so the edge sees no slope outwards
+void PipeErosion::copyEdgesToGhosts() {
+
+    for (int y = 0; y < height; y++) {
+        float* row = &terrain[index(0, y)];
+        row[-1] = row[0];
+        std::fill(row + width, row - 1 + stride, row[width - 1]);
+    }
+
+    std::copy_n(&terrain[0] + stride, stride, &terrain[0]);
+    std::copy_n(&terrain[0] + size_t(height) * stride, stride, &terrain[0] + size_t(height + 1) * stride);
+}
+
+void PipeErosion::run(Heightfield& field, const Pipe_Erosion_Params& params, int iterations, JobPool& pool) {
+
+    if (field.width != width || field.height != height || iterations <= 0) {
+        return;
+    }
+
+    for (int y = 0; y < height; y++) {
+        const float* in = field.row(y);
+        float* out = &terrain[index(0, y)];
+        for (int x = 0; x < width; x++) {
+            out[x] = in[x] * params.heightScale;
+        }
+    }
+    copyEdgesToGhosts();
+
+    Pipe_Kernel_State state;
+    state.width = width;
+    state.height = height;
+    state.stride = stride;
+    state.terrain = terrain.data();
+    state.water = water.data();
+    state.fluxLeft = fluxLeft.data();
+    state.fluxRight = fluxRight.data();
+    state.fluxBottom = fluxBottom.data();
+    state.fluxTop = fluxTop.data();
+    state.velocityX = velocityX.data();
+    state.velocityY = velocityY.data();
+    state.capacity = capacity.data();
+    state.mask = mask.data();
+    state.column = column.data();
+
+    state.timeStep = params.timeStep;
+    state.rainStep = params.rainRate * params.timeStep;
+    state.fluxScale = params.timeStep * params.pipeArea * params.gravity / params.pipeLength;
+    state.cellArea = params.pipeLength * params.pipeLength;
+    state.pipeLength = params.pipeLength;
+    state.sedimentCapacity = params.sedimentCapacity;
+    state.minTilt = params.minTilt;
+    state.dissolveRate = std::min(1.0f, params.dissolveRate * params.timeStep);
+    state.depositRate = std::min(1.0f, params.depositRate * params.timeStep);
+    state.evaporation = std::min(1.0f, params.evaporationRate * params.timeStep);
+
+    // each sweep reads its neighbours' results from the one before, so a band
+    // only ever writes its own rows and the bands can run in any order
+    const int bands = (height + PIPE_EROSION_BAND_ROWS - 1) / PIPE_EROSION_BAND_ROWS;
+    const Simd_Target target = simdTarget;
+    Pipe_Sweep sweep = PIPE_SWEEP_FLUX;
+
+    auto runBand = [&](int band) {
+        int rowBegin = 1 + band * PIPE_EROSION_BAND_ROWS;
+        int rowEnd = std::min(height + 1, rowBegin + PIPE_EROSION_BAND_ROWS);
+        pipeErosionRows(target, sweep, state, rowBegin, rowEnd);
+    };
+
+    for (int i = 0; i < iterations; i++) {
+
+        state.sediment = sediment.data();
+        state.sedimentNext = sedimentNext.data();
+
+        sweep = PIPE_SWEEP_FLUX;
+        pool.parallelFor(bands, runBand);
+        sweep = PIPE_SWEEP_WATER;
+        pool.parallelFor(bands, runBand);
+        sweep = PIPE_SWEEP_EROSION;
+        pool.parallelFor(bands, runBand);
+        sweep = PIPE_SWEEP_ADVECTION;
+        pool.parallelFor(bands, runBand);
+
+        std::swap(sediment, sedimentNext);
+        copyEdgesToGhosts();
+    }
+
+    for (int y = 0; y < height; y++) {
+        const float* in = &terrain[index(0, y)];
+        float* out = field.row(y);
+        for (int x = 0; x < width; x++) {
+            out[x] = in[x] / params.heightScale;
+        }
+    }
+}
+
+void erodePipes(Heightfield& field, const Pipe_Erosion_Params& params, int iterations, JobPool& pool) {
+
+    if (field.width < 2 || field.height < 2) {
+        return;
+    }
+
+    PipeErosion erosion(field.width, field.height);
+    erosion.run(field, params, iterations, pool);
+}
@@ -2,6 +2,9 @@
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <vector>
+#include <cstring>
+#include <filesystem>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -9,191 +12,456 @@
 
 #include "shader.hpp"
 
-Shader::Shader(std::string buildPath, const std::string shaderName) {
+// FNV-1a, only needs to tell source/driver combinations apart, not resist attacks
+static uint64_t hashString(uint64_t hash, const char* str, size_t length) {
 
-    const std::string shaderDirPath = buildPath + "shaders/" + shaderName + "/";
-    const std::string vertexPath = shaderDirPath + shaderName + ".vert";
-    const std::string fragmentPath = shaderDirPath +  shaderName + ".frag";
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)str[i];
+        hash *= 0x100000001b3ull;
+    }
 
-    std::string vertexCodeStr, fragmentCodeStr;
-    std::ifstream vertexFile, fragmentFile;
+    // separator so "ab" + "c" and "a" + "bc" don't collide
+    hash ^= 0xff;
+    hash *= 0x100000001b3ull;
+    return hash;
+}
+
+static uint64_t hashString(uint64_t hash, const std::string& str) {
+    return hashString(hash, str.data(), str.size());
+}
+
+static uint64_t hashGLString(uint64_t hash, GLenum name) {
+    const char* str = (const char*)glGetString(name);
+    return str ? hashString(hash, str, strlen(str)) : hashString(hash, "", 0);
+}
 
-    vertexFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    fragmentFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+static bool readShaderFile(const std::string& path, std::string& code) {
+
+    std::ifstream file;
+    file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
 
     try {
+        file.open(path.c_str());
+        std::stringstream stream;
+        stream << file.rdbuf();
+        file.close();
+        code = stream.str();
 
-        vertexFile.open(vertexPath.c_str());
-        fragmentFile.open(fragmentPath.c_str());
+    } catch (const std::ifstream::failure& e) {
+        return false;
+    }
 
-        std::stringstream vertexStream, fragmentStream;
+    return true;
+}
 
-        vertexStream << vertexFile.rdbuf();
-        fragmentStream << fragmentFile.rdbuf();
+static std::string definesKey(const Shader_Defines& defines) {
 
-        vertexFile.close();
-        fragmentFile.close();
+    std::string key;
+    for (const auto& define : defines) {
+        key += define.first + '=' + define.second + ';';
+    }
+    return key;
+}
 
-        vertexCodeStr = vertexStream.str();
-        fragmentCodeStr = fragmentStream.str();
+// defines have to come after #version, #line keeps compile errors pointing at the file's own lines
+static std::string injectDefines(const std::string& code, const Shader_Defines& defines) {
 
-    } catch (const std::ifstream::failure& e) {
-        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ\n\t" << shaderDirPath + '\n';
+    if (defines.empty()) {
+        return code;
     }
 
-    const char* vertexCode = vertexCodeStr.c_str();
-    const char* fragmentCode = fragmentCodeStr.c_str();
+    size_t versionEnd = 0;
+    if (code.compare(0, 8, "#version") == 0) {
+        versionEnd = code.find('\n');
+        versionEnd = versionEnd == std::string::npos ? code.size() : versionEnd + 1;
+    }
 
-    unsigned int vertexShader, fragmentShader;
+    std::string injected = code.substr(0, versionEnd);
+    for (const auto& define : defines) {
+        injected += "#define " + define.first + ' ' + define.second + '\n';
+    }
+    injected += "#line " + std::to_string(versionEnd ? 2 : 1) + '\n';
+    injected += code.substr(versionEnd);
+    return injected;
+}
 
-    vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+static unsigned int compileShader(GLenum stage, const std::string& code, const std::string& path, const char* stageName) {
 
-    glShaderSource(vertexShader, 1, &vertexCode, NULL);
-    glShaderSource(fragmentShader, 1, &fragmentCode, NULL);
+    const char* source = code.c_str();
+    unsigned int shader = glCreateShader(stage);
 
-    glCompileShader(vertexShader);
-    glCompileShader(fragmentShader);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
 
     int success;
     char infoLog[512];
 
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
     if (!success) {
-        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << vertexPath << '\n' << infoLog << '\n';
+        glGetShaderInfoLog(shader, 512, NULL, infoLog);
+        std::cout << "ERROR::SHADER::" << stageName << "::COMPILATION_FAILED\n" << path << '\n' << infoLog << '\n';
     }
 
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << fragmentPath << '\n' << infoLog << '\n';
-    }
+    return shader;
+}
 
-    ID = glCreateProgram();
+Shader::Shader(std::string buildPath, const std::string shaderName, const Shader_Defines &defines) {
 
+    const std::string shaderDirPath = buildPath + "shaders/" + shaderName + "/";
+    const std::string vertexPath = shaderDirPath + shaderName + ".vert";
+    const std::string fragmentPath = shaderDirPath +  shaderName + ".frag";
     const std::string geometryPath = shaderDirPath + shaderName + ".geom";
 
-    std::string geometryCodeStr;
-    std::ifstream geometryFile;
+    std::string vertexCode, fragmentCode, geometryCode;
 
-    geometryFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+    if (!readShaderFile(vertexPath, vertexCode) || !readShaderFile(fragmentPath, fragmentCode)) {
+        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ\n\t" << shaderDirPath + '\n';
+    }
 
-    try {
-        geometryFile.open(geometryPath.c_str());
+    // the geometry stage is optional
+    const bool hasGeometry = readShaderFile(geometryPath, geometryCode);
 
-    } catch (const std::ifstream::failure& e) {
+    vertexCode = injectDefines(vertexCode, defines);
+    fragmentCode = injectDefines(fragmentCode, defines);
+    if (hasGeometry) {
+        geometryCode = injectDefines(geometryCode, defines);
+    }
+
+    // each permutation gets its own cache file so switching variants doesn't evict the others
+    std::string cacheName = shaderName;
+    if (!defines.empty()) {
+        std::stringstream variantName;
+        variantName << shaderName << '_' << std::hex << hashString(0xcbf29ce484222325ull, definesKey(defines));
+        cacheName = variantName.str();
+    }
+
+    const std::string cachePath = buildPath + SHADER_CACHE_DIR + cacheName + ".bin";
+
+    // a binary is only valid for the exact sources and driver it was built with
+    uint64_t cacheKey = 0xcbf29ce484222325ull;
+    cacheKey = hashString(cacheKey, vertexCode);
+    cacheKey = hashString(cacheKey, fragmentCode);
+    cacheKey = hashString(cacheKey, geometryCode);
+    cacheKey = hashGLString(cacheKey, GL_VENDOR);
+    cacheKey = hashGLString(cacheKey, GL_RENDERER);
+    cacheKey = hashGLString(cacheKey, GL_VERSION);
+
+    ID = glCreateProgram();
+
+    loadedFromCache = loadProgramBinary(cachePath, cacheKey);
+
+    if (!loadedFromCache) {
+
+        unsigned int vertexShader = compileShader(GL_VERTEX_SHADER, vertexCode, vertexPath, "VERTEX");
+        unsigned int fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentCode, fragmentPath, "FRAGMENT");
+        unsigned int geometryShader = 0;
 
         glAttachShader(ID, vertexShader);
         glAttachShader(ID, fragmentShader);
+
+        if (hasGeometry) {
+            geometryShader = compileShader(GL_GEOMETRY_SHADER, geometryCode, geometryPath, "GEOMETRY");
+            glAttachShader(ID, geometryShader);
+        }
+
+        if (programBinarySupported()) {
+            glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+
         glLinkProgram(ID);
 
+        int success;
+        char infoLog[512];
+
         glGetProgramiv(ID, GL_LINK_STATUS, &success);
         if (!success) {
             glGetProgramInfoLog(ID, 512, NULL, infoLog);
             std::cout << "ERROR::SHADER::PROGRAM::LINK_FAILED\n" << shaderDirPath << '\n' << infoLog << '\n';
+        } else {
+            saveProgramBinary(cachePath, cacheKey);
         }
 
         glDeleteShader(vertexShader);
         glDeleteShader(fragmentShader);
+        if (hasGeometry) {
+            glDeleteShader(geometryShader);
+        }
+    }
 
-        return;
+    cacheUniformLocations();
+}
+
+bool Shader::programBinarySupported() {
+
+    if (!SHADER_BINARY_CACHE || !GLAD_GL_ARB_get_program_binary) {
+        return false;
     }
 
-    try {
-        std::stringstream geometryStream, fragmentStream;
-        geometryStream << geometryFile.rdbuf();
-        geometryFile.close();
-        geometryCodeStr = geometryStream.str();
+    // drivers can expose the extension with zero formats, meaning binaries are never retrievable
+    int formatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    return formatCount > 0;
+}
 
-    } catch (const std::ifstream::failure& e) {
-        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ\n\t" << shaderDirPath + '\n';
+// cache file layout: magic, cache key, binary format, binary length, binary
+bool Shader::loadProgramBinary(const std::string& cachePath, uint64_t cacheKey) {
+
+    if (!programBinarySupported()) {
+        return false;
+    }
+
+    std::ifstream file(cachePath, std::ios::binary);
+    if (!file) {
+        return false;
     }
 
-    const char* geometryCode = geometryCodeStr.c_str();
-    unsigned int geometryShader;
+    uint32_t magic = 0;
+    uint64_t fileKey = 0;
+    uint32_t format = 0;
+    uint32_t length = 0;
 
-    geometryShader = glCreateShader(GL_GEOMETRY_SHADER);
+    file.read((char*)&magic, sizeof(magic));
+    file.read((char*)&fileKey, sizeof(fileKey));
+    file.read((char*)&format, sizeof(format));
+    file.read((char*)&length, sizeof(length));
 
-    glShaderSource(geometryShader, 1, &geometryCode, NULL);
-    glCompileShader(geometryShader);
+    if (!file || magic != SHADER_CACHE_MAGIC || fileKey != cacheKey || length == 0) {
+        return false;
+    }
 
-    glGetShaderiv(geometryShader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(geometryShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::GEOMETRY::COMPILATION_FAILED\n" << geometryPath << '\n' << infoLog << '\n';
+    std::vector<char> binary(length);
+    file.read(binary.data(), length);
+    if (!file) {
+        return false;
     }
 
-    glAttachShader(ID, vertexShader);
-    glAttachShader(ID, fragmentShader);
-    glAttachShader(ID, geometryShader);
-    glLinkProgram(ID);
+    glProgramBinary(ID, (GLenum)format, binary.data(), (GLsizei)length);
 
+    // the driver may still refuse a binary it wrote (e.g. after an update that kept the version string)
+    int success;
     glGetProgramiv(ID, GL_LINK_STATUS, &success);
     if (!success) {
-        glGetProgramInfoLog(ID, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::PROGRAM::LINK_FAILED\n" << shaderDirPath << '\n' << infoLog << '\n';
+        glDeleteProgram(ID);
+        ID = glCreateProgram();
+        return false;
     }
 
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
-    glDeleteShader(geometryShader);
+    return true;
+}
+
+void Shader::saveProgramBinary(const std::string& cachePath, uint64_t cacheKey) const {
+
+    if (!programBinarySupported()) {
+        return;
+    }
+
+    int length = 0;
+    glGetProgramiv(ID, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(ID, length, &length, &format, binary.data());
+
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(cachePath).parent_path(), error);
+
+    // written next to the real file and renamed so a crash never leaves half a binary behind
+    const std::string tempPath = cachePath + ".tmp";
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cout << "ERROR::SHADER::CACHE_NOT_WRITTEN\n\t" << cachePath << '\n';
+        return;
+    }
+
+    uint32_t magic = SHADER_CACHE_MAGIC;
+    uint32_t format32 = format;
+    uint32_t length32 = length;
+
+    file.write((const char*)&magic, sizeof(magic));
+    file.write((const char*)&cacheKey, sizeof(cacheKey));
+    file.write((const char*)&format32, sizeof(format32));
+    file.write((const char*)&length32, sizeof(length32));
+    file.write(binary.data(), length);
+    file.close();
+
+    if (!file) {
+        std::cout << "ERROR::SHADER::CACHE_NOT_WRITTEN\n\t" << cachePath << '\n';
+        std::filesystem::remove(tempPath, error);
+        return;
+    }
+
+    std::filesystem::rename(tempPath, cachePath, error);
+}
+
+void Shader::cacheUniformLocations() {
+
+    uniformLocations.clear();
+
+    int uniformCount = 0;
+    int maxNameLength = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &uniformCount);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+    std::string name(maxNameLength > 0 ? maxNameLength : 1, '\0');
+
+    for (int i = 0; i < uniformCount; i++) {
+
+        int nameLength = 0;
+        int size = 0;
+        GLenum type;
+        glGetActiveUniform(ID, (GLuint)i, (GLsizei)name.size(), &nameLength, &size, &type, &name[0]);
+
+        std::string uniformName = name.substr(0, nameLength);
+        int location = glGetUniformLocation(ID, uniformName.c_str());
+        uniformLocations[uniformName] = location;
+
+        // arrays are reported as "name[0]", make plain "name" work too
+        size_t bracket = uniformName.find("[0]");
+        if (bracket != std::string::npos && bracket + 3 == uniformName.size()) {
+            uniformLocations[uniformName.substr(0, bracket)] = location;
+        }
+    }
 }
 
 void Shader::use() {
     glUseProgram(ID);
 }
 
+int Shader::getUniformLocation(const std::string &name) const {
+    auto it = uniformLocations.find(name);
+    return it == uniformLocations.end() ? -1 : it->second;
+}
+
 void Shader::setBool(const std::string &name, bool value) const {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+    glUniform1i(getUniformLocation(name), (int)value);
 }
 void Shader::setInt(const std::string &name, int value) const
 {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+    glUniform1i(getUniformLocation(name), value); 
+}
+void Shader::setIntArray(const std::string &name, const int* values, int count) const
+{
+    glUniform1iv(getUniformLocation(name), count, values);
 }
 void Shader::setFloat(const std::string &name, float value) const
 {
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+    glUniform1f(getUniformLocation(name), value); 
 }
 
 void Shader::setVec2(const std::string &name, const glm::vec2 &value) const
 { 
-    glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+    glUniform2fv(getUniformLocation(name), 1, &value[0]); 
 }
 void Shader::setVec2(const std::string &name, float x, float y) const
 { 
-    glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y); 
+    glUniform2f(getUniformLocation(name), x, y); 
+}
+void Shader::setVec2Array(const std::string &name, const glm::vec2* values, int count) const
+{
+    glUniform2fv(getUniformLocation(name), count, &values[0][0]);
+}
+void Shader::setIVec2(const std::string &name, const glm::ivec2 &value) const
+{
+    glUniform2iv(getUniformLocation(name), 1, &value[0]);
 }
 
 void Shader::setVec3(const std::string &name, const glm::vec3 &value) const
 { 
-    glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+    glUniform3fv(getUniformLocation(name), 1, &value[0]); 
 }
 void Shader::setVec3(const std::string &name, float x, float y, float z) const
 { 
-    glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+    glUniform3f(getUniformLocation(name), x, y, z); 
 }
 
 void Shader::setVec4(const std::string &name, const glm::vec4 &value) const
 { 
-    glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+    glUniform4fv(getUniformLocation(name), 1, &value[0]); 
 }
 void Shader::setVec4(const std::string &name, float x, float y, float z, float w) const
 { 
-    glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w); 
+    glUniform4f(getUniformLocation(name), x, y, z, w); 
 }
 
 void Shader::setMat2(const std::string &name, const glm::mat2 &mat) const
 {
-    glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix2fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
 }
 
 void Shader::setMat3(const std::string &name, const glm::mat3 &mat) const
 {
-    glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix3fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
 }
 
 void Shader::setMat4(const std::string &name, const glm::mat4 &mat) const
 {
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
+}
+
+void Shader::setBool(int location, bool value) const {
+    glUniform1i(location, (int)value);
+}
+void Shader::setInt(int location, int value) const
+{
+    glUniform1i(location, value);
+}
+void Shader::setIntArray(int location, const int* values, int count) const
+{
+    glUniform1iv(location, count, values);
+}
+void Shader::setFloat(int location, float value) const
+{
+    glUniform1f(location, value);
+}
+void Shader::setVec2(int location, const glm::vec2 &value) const
+{
+    glUniform2fv(location, 1, &value[0]);
+}
+void Shader::setVec2Array(int location, const glm::vec2* values, int count) const
+{
+    glUniform2fv(location, count, &values[0][0]);
+}
+void Shader::setIVec2(int location, const glm::ivec2 &value) const
+{
+    glUniform2iv(location, 1, &value[0]);
+}
+void Shader::setVec3(int location, const glm::vec3 &value) const
+{
+    glUniform3fv(location, 1, &value[0]);
+}
+void Shader::setVec4(int location, const glm::vec4 &value) const
+{
+    glUniform4fv(location, 1, &value[0]);
+}
+void Shader::setMat2(int location, const glm::mat2 &mat) const
+{
+    glUniformMatrix2fv(location, 1, GL_FALSE, &mat[0][0]);
+}
+void Shader::setMat3(int location, const glm::mat3 &mat) const
+{
+    glUniformMatrix3fv(location, 1, GL_FALSE, &mat[0][0]);
+}
+void Shader::setMat4(int location, const glm::mat4 &mat) const
+{
+    glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]);
+}
+
+ShaderVariants::ShaderVariants(std::string buildPathIn, const std::string shaderNameIn) {
+    buildPath = buildPathIn;
+    shaderName = shaderNameIn;
+}
+
+Shader& ShaderVariants::get(const Shader_Defines &defines) {
+
+    const std::string key = definesKey(defines);
+
+    auto it = variants.find(key);
+    if (it == variants.end()) {
+        it = variants.try_emplace(key, buildPath, shaderName, defines).first;
+    }
+
+    return it->second;
 }
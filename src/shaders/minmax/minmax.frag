@@ -0,0 +1,28 @@
+#version 330 core
+
+// one level of the min / max pyramid (include/height_bounds.hpp), each
+// fragment the range of 2x2 texels of source. Past the last row or column the
+// last one is read again, so odd sizes round up the same way HeightBounds does
+
+out vec2 Bounds;
+
+uniform sampler2D source;       // heights in r on the first pass, (min, max) after
+uniform bool  firstPass;
+uniform ivec2 sourceSize;
+
+vec2 sourceBounds(ivec2 texel) {
+    vec2 value = texelFetch(source, min(texel, sourceSize - 1), 0).rg;
+    return firstPass ? value.rr : value;
+}
+
+void main() {
+
+    ivec2 texel = 2 * ivec2(gl_FragCoord.xy);
+
+    vec2 a = sourceBounds(texel);
+    vec2 b = sourceBounds(texel + ivec2(1, 0));
+    vec2 c = sourceBounds(texel + ivec2(0, 1));
+    vec2 d = sourceBounds(texel + ivec2(1, 1));
+
+    Bounds = vec2(min(min(a.x, b.x), min(c.x, d.x)), max(max(a.y, b.y), max(c.y, d.y)));
+}
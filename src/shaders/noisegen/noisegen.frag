@@ -6,28 +6,108 @@ uniform float TEX_RES;
 
 uniform vec2  posOffset;
 uniform float timeOffset;
+uniform vec2  texelOffset;        // world texel - fragment texel, for toroidal strip updates
+
+// must match Hash_Type in include/hash.hpp
+#define HASH_SIN         0
+#define HASH_PCG         1
+#define HASH_XXHASH      2
+#define HASH_PERMUTATION 3
+
+// must match Noise_Type in include/noise.hpp
+#define NOISE_PERLIN          0
+#define NOISE_FBM             1
+#define NOISE_RIDGE           2
+#define NOISE_TURBULENCE      3
+#define NOISE_DOMAIN_WARP_FBM 4
+#define NOISE_VORONOI         5
+#define NOISE_VORONOI_F2      6
+#define NOISE_VORONOI_F2_MINUS_F1 7
+
+// must match Noise_Basis in include/noise.hpp
+#define NOISE_BASIS_PERLIN  0
+#define NOISE_BASIS_SIMPLEX 1
+
+// must match VORONOI_SCALE / WORLEY_JITTER / SIMPLEX_* in include/noise.hpp
+#define VORONOI_SCALE 16.0f
+#define WORLEY_JITTER 0.35355339f
+#define SIMPLEX_SKEW 0.36602540378f
+#define SIMPLEX_UNSKEW 0.21132486541f
+#define SIMPLEX_UNSKEW_2 0.42264973081f
+#define SIMPLEX_SCALE 40.0f
+
+// variant defines, normally injected by Shader (see ShaderVariants in main.cpp).
+// The defaults keep the file usable on its own. With HASH_TYPE defined the hash
+// is a compile time constant instead of the hashType uniform
+#ifndef NOISE_TYPE
+#define NOISE_TYPE NOISE_RIDGE
+#endif
+#ifndef NOISE_OCTAVES
+#define NOISE_OCTAVES 5
+#endif
+#ifndef NOISE_BASIS
+#define NOISE_BASIS NOISE_BASIS_PERLIN
+#endif
+
+#define PERM_SIZE 256
+#define HASH_UNIT_SCALE (1.0f / 32768.0f)
+#define GRAD_DIAGONAL 0.70710678f
+
+#ifdef HASH_TYPE
+const int hashType = HASH_TYPE;
+#else
+uniform int  hashType;
+#endif
+uniform int  seed;
+uniform vec2 gradRotation;        // (cos, sin) of timeOffset, worked out on the cpu
+uniform int  perm[PERM_SIZE];
+
+const vec2 PERM_GRADS[8] = vec2[8](
+    vec2(1.0f, 0.0f), vec2(-1.0f, 0.0f), vec2(0.0f, 1.0f), vec2(0.0f, -1.0f),
+    vec2(GRAD_DIAGONAL, GRAD_DIAGONAL), vec2(-GRAD_DIAGONAL, GRAD_DIAGONAL),
+    vec2(GRAD_DIAGONAL, -GRAD_DIAGONAL), vec2(-GRAD_DIAGONAL, -GRAD_DIAGONAL)
+);
 
 
 float domainWarpFBM(vec2 st);
 float fbm(vec2 st);
 float perlin(vec2 st);
+float simplex(vec2 st);
+float basis(vec2 st);
 float ridge(vec2 st);
 float turbulence(vec2 st);
-float voronoiNoise(vec2 st); 
+vec2 worley(vec2 st);
 
 float fade(float a);
 float rand(vec2 st);
 vec2 rand2(vec2 p, float timeOffset);
+vec2 hashGradient(ivec2 p);
+uvec2 pcg2d(uvec2 v);
+uint xxhash2d(uvec2 p, uint seed);
 
 void main() {
 
-    vec2 st = (gl_FragCoord.xy) / TEX_RES;
-    //st += posOffset;
+    vec2 st = (gl_FragCoord.xy + texelOffset) / TEX_RES;
+    st += posOffset;
 
+#if NOISE_TYPE == NOISE_PERLIN
+    FragColor = perlin(st);
+#elif NOISE_TYPE == NOISE_FBM
+    FragColor = fbm(st);
+#elif NOISE_TYPE == NOISE_RIDGE
     FragColor = ridge(st);
-    //FragColor = fbm(st);
-    //FragColor = FragColor * 0.5f + 0.5f;
-    //FragColor = voronoiNoise(st);
+#elif NOISE_TYPE == NOISE_TURBULENCE
+    FragColor = turbulence(st);
+#elif NOISE_TYPE == NOISE_DOMAIN_WARP_FBM
+    FragColor = domainWarpFBM(st);
+#elif NOISE_TYPE == NOISE_VORONOI
+    FragColor = worley(st).x;
+#elif NOISE_TYPE == NOISE_VORONOI_F2
+    FragColor = worley(st).y;
+#elif NOISE_TYPE == NOISE_VORONOI_F2_MINUS_F1
+    vec2 f = worley(st);
+    FragColor = f.y - f.x;
+#endif
 }
 
 float domainWarpFBM(vec2 st) {
@@ -47,16 +127,15 @@ float fbm(vec2 st) {
 
     float value = 0.0f;
 
-    int octaves = 5;
     float frequency = 4.0f;
     float lacunarity = 2.0f;
     float persistence = 0.8f;
 
     vec2 pos = st * frequency;
 
-    for (int i = 0; i < octaves; i++) {
+    for (int i = 0; i < NOISE_OCTAVES; i++) {
 
-        value += perlin(pos) * persistence;
+        value += basis(pos) * persistence;
         pos *= lacunarity;
         persistence *= persistence;
     }
@@ -90,6 +169,45 @@ float perlin(vec2 st) {
     return mix(mix(dotBottomLeft, dotBottomRight, u), mix(dotTopLeft, dotTopRight, u), v);
 }
 
+float simplexCorner(vec2 d, vec2 grad) {
+
+    float falloff = max(0.5f - (d.x * d.x + d.y * d.y), 0.0f);
+    falloff *= falloff;
+    return falloff * falloff * (grad.x * d.x + grad.y * d.y);
+}
+
+// 3 corner noise on a lattice of triangles, st is skewed onto the square
+// lattice to find the cell and the diagonal picks which half it is in
+float simplex(vec2 st) {
+
+    float skew = (st.x + st.y) * SIMPLEX_SKEW;
+    vec2 cell = floor(st + skew);
+    float unskew = (cell.x + cell.y) * SIMPLEX_UNSKEW;
+
+    vec2 d0 = st - (cell - unskew);
+
+    float stepX = step(d0.y, d0.x);
+    vec2 middle = vec2(stepX, 1.0f - stepX);
+
+    vec2 d1 = (d0 - middle) + SIMPLEX_UNSKEW;
+    vec2 d2 = (d0 - 1.0f) + SIMPLEX_UNSKEW_2;
+
+    float n0 = simplexCorner(d0, rand2(cell, timeOffset));
+    float n1 = simplexCorner(d1, rand2(cell + middle, timeOffset));
+    float n2 = simplexCorner(d2, rand2(cell + 1.0f, timeOffset));
+
+    return SIMPLEX_SCALE * ((n0 + n1) + n2);
+}
+
+// octave noise of the fractals, picked per variant
+float basis(vec2 st) {
+#if NOISE_BASIS == NOISE_BASIS_SIMPLEX
+    return simplex(st);
+#else
+    return perlin(st);
+#endif
+}
+
 float ridge(vec2 st) {
 
     float offset = 1.0f;
@@ -104,15 +222,14 @@ float turbulence(vec2 st) {
     float amp = 0.5f;
     float frequency = 2.0f;
     float lacunarity = 2.0f;
-    int octaves = 5;
 
     float value = 0;
 
     st *= frequency;
 
-    for (int i = 0; i < octaves; i++) {
+    for (int i = 0; i < NOISE_OCTAVES; i++) {
         
-        value += amp * abs(perlin(st));
+        value += amp * abs(basis(st));
         st *= lacunarity;
         amp *= 0.5f;
     }
@@ -120,51 +237,36 @@ float turbulence(vec2 st) {
     return value;
 }
 
-float voronoiNoise(vec2 st) {
+// (F1, F2): distances to the nearest and second nearest feature points. Each
+// point is hashed from its cell on demand, so only the 3x3 neighbourhood is
+// touched and the domain is unbounded
+vec2 worley(vec2 st) {
 
-    const int SCALE_X = 16;
-    const int SCALE_Y = 16;
-    const float scaleX = float(SCALE_X);
-    const float scaleY = float(SCALE_Y);
+    vec2 p = st * VORONOI_SCALE;
 
-    // get points per frag (ew)
-    vec2 randomPoints[SCALE_X * SCALE_Y];
-    for (int i = 0; i < SCALE_X; i++) {
-        for (int j = 0; j < SCALE_Y; j++) {
-            // should be deterministic
-            randomPoints[i * SCALE_X + j] = rand2(vec2(float(i), float(j)), timeOffset);
-        }
-    }
+    // relative to the cell so precision doesn't drop off far from the origin
+    vec2 cell = floor(p);
+    vec2 f = p - cell;
+
+    // squared distances, nothing in the 3x3 neighbourhood is further than 8
+    float f1 = 8.0f;
+    float f2 = 8.0f;
+
+    for (int j = -1; j <= 1; j++) {
+        for (int i = -1; i <= 1; i++) {
 
-    // note we are using coordinate space of (0 to cellCountX, 0 to cellCountY)
-    int cellX = int(floor(st.x * scaleX));
-    int cellY = int(floor(st.y * scaleY));
-
-    // find closest point out of surrounding cells
-    int closestPointIndex = -1;
-    float closestPointDist = -1;
-
-    for (int i = -1; i <= 1; i++) {
-        for (int j = -1; j <= 1; j++) {
-
-            int currentIndex = (cellX + i) * SCALE_X + cellY + j;
-
-            if (currentIndex < 0 || currentIndex >= SCALE_X * SCALE_Y) {
-                continue;
-            }
-            // normalize so that point is always in the cell
-            vec2 offsetVec = randomPoints[currentIndex] * 0.5f + 0.5f;
-            vec2 randomPointPos = vec2(float(cellX + i), float(cellY + j)) + offsetVec;
-            vec2 currentPoint = vec2(st.x * scaleX, st.y * scaleY);
-            float currentDist = length(currentPoint - randomPointPos);
-            // update if distance shorter
-            if (currentDist < closestPointDist || closestPointIndex == -1) {
-                closestPointIndex = currentIndex;
-                closestPointDist = currentDist;
-            }
+            vec2 neighbour = vec2(float(i), float(j));
+            vec2 offset = rand2(cell + neighbour, timeOffset);
+
+            vec2 d = (neighbour + 0.5f + offset * WORLEY_JITTER) - f;
+            float dist = dot(d, d);
+
+            f2 = min(f2, max(f1, dist));
+            f1 = min(f1, dist);
         }
     }
-    return closestPointDist;
+
+    return sqrt(vec2(f1, f2));
 }
 
 float fade(float t) {
@@ -176,9 +278,70 @@ float rand(vec2 st){
 }
 
 vec2 rand2(vec2 p, float timeOffset){
+
+    if (hashType != HASH_SIN) {
+        return hashGradient(ivec2(p));
+    }
+
     float a = fract(sin(dot(p + 12.0422, vec2(127.1, 311.7))) * 43758.5453);
     float b = fract(sin(dot(p + 5.73223, vec2(269.5, 183.3))) * 43758.5453);
     vec2 grad = sin(vec2(a, b));
     grad *= 43758.5453;
     return sin(grad + timeOffset);
 }
+
+// integer hashes below mirror include/hash.hpp / src/noise.cpp, they only use
+// exact int -> float conversions so the gpu gets the same gradients as the cpu
+vec2 hashGradient(ivec2 p) {
+
+    vec2 grad;
+
+    if (hashType == HASH_PCG) {
+        uvec2 h = pcg2d(uvec2(uint(p.x), uint(p.y) ^ uint(seed)));
+        grad = vec2(h >> 16u) * HASH_UNIT_SCALE - 1.0f;
+    } else if (hashType == HASH_XXHASH) {
+        uint h = xxhash2d(uvec2(p), uint(seed));
+        grad = vec2(float(h & 0xffffu), float(h >> 16u)) * HASH_UNIT_SCALE - 1.0f;
+    } else {
+        int h = perm[(perm[p.x & (PERM_SIZE - 1)] + p.y) & (PERM_SIZE - 1)] & 7;
+        grad = PERM_GRADS[h];
+    }
+
+    return vec2(grad.x * gradRotation.x - grad.y * gradRotation.y,
+                grad.x * gradRotation.y + grad.y * gradRotation.x);
+}
+
+uvec2 pcg2d(uvec2 v) {
+
+    v = v * 1664525u + 1013904223u;
+
+    v.x += v.y * 1664525u;
+    v.y += v.x * 1664525u;
+    v = v ^ (v >> 16u);
+    v.x += v.y * 1664525u;
+    v.y += v.x * 1664525u;
+    v = v ^ (v >> 16u);
+
+    return v;
+}
+
+uint xxhash2d(uvec2 p, uint seed) {
+
+    const uint PRIME2 = 2246822519u;
+    const uint PRIME3 = 3266489917u;
+    const uint PRIME4 = 668265263u;
+    const uint PRIME5 = 374761393u;
+
+    uint h = seed + PRIME5 + 8u;
+    h += p.x * PRIME3;
+    h = ((h << 17u) | (h >> 15u)) * PRIME4;
+    h += p.y * PRIME3;
+    h = ((h << 17u) | (h >> 15u)) * PRIME4;
+
+    h ^= h >> 15u;
+    h *= PRIME2;
+    h ^= h >> 13u;
+    h *= PRIME3;
+    h ^= h >> 16u;
+    return h;
+}
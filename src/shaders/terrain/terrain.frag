@@ -43,7 +43,8 @@ vec3 blinnPhong(vec3 albedo, vec3 lightPos, float shininess) {
 
     vec3 lightDir = normalize(lightPos - FragPos);
     vec3 viewDir  = normalize(ViewPos  - FragPos);
-    float NdotL   = max(dot(Normal, lightDir), 0.0f);
+    vec3 normal   = normalize(Normal);
+    float NdotL   = max(dot(normal, lightDir), 0.0f);
     vec3 diffuse  = albedo * NdotL;
 
     vec3 H = normalize(lightDir + viewDir);
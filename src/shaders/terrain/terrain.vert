@@ -1,31 +1,176 @@
 #version 330 core
 
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec2 aTexCoords;
+layout (location = 0) in vec2 aGrid;       // integer grid position within the shared patch / clipmap level
+layout (location = 1) in vec4 aPatch;      // Cdlod_Patch instance: min corner x and z, quad size, level
 
-out VS_OUT {
-    float height;
-    vec3 fragPos;
-    vec3 viewPos;
-} vs_out;
+out float Height;
+out vec3 FragPos;
+out vec3 Normal;
+out vec3 ViewPos;
+
+// variant define, 1 reads normals from normalMap (worked out on the cpu by
+// generateNormalMap, include/normal_map.hpp), 0 differences the heightmap here
+// when it only exists on the gpu
+#ifndef NORMAL_MAP
+#define NORMAL_MAP 0
+#endif
+
+// variant define, 1 draws the levels of a geometry clipmap (ClipmapRenderer,
+// include/clipmap_renderer.hpp) instead of CDLOD patches over heightMap
+#ifndef CLIPMAP
+#define CLIPMAP 0
+#endif
+
+#define WATER_LEVEL 0.4f          // TERRAIN_WATER_LEVEL in main.cpp
+
+// must match include/cdlod.hpp
+#define CDLOD_MAX_LEVELS 16
 
 uniform sampler2D heightMap;
+uniform sampler2D normalMap;      // (x, z) of the unit normal, y is rebuilt
+uniform vec2 heightMapOffset;     // non zero when the heightmap is a toroidal window (TileStreamer)
+uniform float heightMapScale;
+uniform float amplitude;          // world units per unit of height
+uniform float texelSize;          // world units between heightmap texels
+uniform float terrainSize;        // world units across the heightmap, centred on the origin
+uniform float lodHeight;          // CdlodQuadtree::lodHeight()
+uniform vec2 morphConstants[CDLOD_MAX_LEVELS];
 uniform vec3 viewPos;
 uniform mat4 projection;
 uniform mat4 view;
 
+#if CLIPMAP
+uniform sampler2DArray clipmapLevels;     // one toroidal ring per level
+uniform int clipmapLevel;
+uniform int clipmapLevelCount;
+uniform ivec2 clipmapOrigin;              // level texel under grid vertex (0, 0)
+uniform int clipmapTexSize;               // a power of two
+uniform int clipmapGridQuads;
+uniform float clipmapSpacing;             // world units between level 0 texels
+uniform float clipmapBlendWidth;          // in texels of the level
+uniform vec2 clipmapWorldOffset;          // world xz of texel (0, 0) of every level
+
+void clipmapSurface(out vec2 worldXZ, out float height, out vec3 normal);
+#endif
+
+vec3 surfaceNormal(vec2 uv);
+
 void main() {
 
-    float height = texture(heightMap, aTexCoords).r;
-    if (height < 0.4f) {
-        height = 0.4f;
+#if CLIPMAP
+    vec2 worldXZ;
+    float height;
+    vec3 normal;
+    clipmapSurface(worldXZ, height, normal);
+#else
+    vec2 corner = aPatch.xy;
+    float quadSize = aPatch.z;
+
+    // morph by distance to the LOD plane, the same one CdlodQuadtree::select measures to,
+    // so the vertices where two levels meet are fully morphed on the finer side
+    vec2 worldXZ = corner + aGrid * quadSize;
+    float dist = distance(vec3(worldXZ.x, lodHeight, worldXZ.y), viewPos);
+    vec2 morphConst = morphConstants[int(aPatch.w)];
+    float morph = 1.0f - clamp(morphConst.x - dist * morphConst.y, 0.0f, 1.0f);
+
+    // odd vertices slide onto their even neighbour, i.e. onto the grid of the next coarser level
+    vec2 odd = mod(aGrid, 2.0f);
+    worldXZ = corner + (aGrid - odd * morph) * quadSize;
+
+    vec2 uv = (worldXZ / terrainSize + 0.5f) * heightMapScale + heightMapOffset;
+    float height = texture(heightMap, uv).r;
+    vec3 normal = surfaceNormal(uv);
+#endif
+
+    // water is flat
+    if (height < WATER_LEVEL) {
+        height = WATER_LEVEL;
+        normal = vec3(0.0f, 1.0f, 0.0f);
+    }
+
+    Normal = normal;
+
+    Height = height;
+    FragPos = vec3(worldXZ.x, amplitude * height, worldXZ.y);
+    ViewPos = viewPos;
+
+    gl_Position = projection * view * vec4(FragPos, 1.0f);
+}
+
+vec3 surfaceNormal(vec2 uv) {
+
+#if NORMAL_MAP
+    vec2 xz = texture(normalMap, uv).rg;
+    return vec3(xz.x, sqrt(max(1.0f - dot(xz, xz), 0.0f)), xz.y);
+#else
+    // same central differences as generateNormalMap
+    vec2 texel = 1.0f / vec2(textureSize(heightMap, 0));
+
+    float left  = texture(heightMap, uv - vec2(texel.x, 0.0f)).r;
+    float right = texture(heightMap, uv + vec2(texel.x, 0.0f)).r;
+    float below = texture(heightMap, uv - vec2(0.0f, texel.y)).r;
+    float above = texture(heightMap, uv + vec2(0.0f, texel.y)).r;
+
+    vec2 slope = vec2(left - right, below - above) * (amplitude / (2.0f * texelSize));
+    return normalize(vec3(slope.x, 1.0f, slope.y));
+#endif
+}
+
+#if CLIPMAP
+float clipmapTexel(ivec2 texel, int level) {
+    // the mask wraps negative texels into the ring as well
+    return texelFetch(clipmapLevels, ivec3(texel & (clipmapTexSize - 1), level), 0).r;
+}
+
+// same central differences as generateNormalMap
+vec3 clipmapNormal(ivec2 texel, int level, float spacing) {
+
+    float left  = clipmapTexel(texel - ivec2(1, 0), level);
+    float right = clipmapTexel(texel + ivec2(1, 0), level);
+    float below = clipmapTexel(texel - ivec2(0, 1), level);
+    float above = clipmapTexel(texel + ivec2(0, 1), level);
+
+    vec2 slope = vec2(left - right, below - above) * (amplitude / (2.0f * spacing));
+    return normalize(vec3(slope.x, 1.0f, slope.y));
+}
+
+void clipmapSurface(out vec2 worldXZ, out float height, out vec3 normal) {
+
+    ivec2 texel = clipmapOrigin + ivec2(aGrid);
+    float spacing = clipmapSpacing * float(1 << clipmapLevel);
+
+    worldXZ = vec2(texel) * spacing + clipmapWorldOffset;
+    height = clipmapTexel(texel, clipmapLevel);
+    normal = clipmapNormal(texel, clipmapLevel, spacing);
+
+    if (clipmapLevel == clipmapLevelCount - 1) {
+        return;
+    }
+
+    // blend into the next coarser level over the outer band of this one. The
+    // eye is under 2 texels from the centre of every level, so the blend is
+    // complete by the edge and the vertices there lie on the coarser level's
+    // triangles
+    vec2 eye = (viewPos.xz - clipmapWorldOffset) / spacing;
+    vec2 fromEye = abs(vec2(texel) - eye);
+    float inner = 0.5f * float(clipmapGridQuads) - clipmapBlendWidth - 2.0f;
+    float blend = clamp((max(fromEye.x, fromEye.y) - inner) / clipmapBlendWidth, 0.0f, 1.0f);
+
+    if (blend == 0.0f) {
+        return;
     }
 
-    float amplitude = 10.0f;
+    // the coarser surface here, half way between its texels along odd rows and
+    // columns. Even texels come out as the coarse texel exactly
+    int coarse = clipmapLevel + 1;
+    ivec2 base = texel >> 1;
+    ivec2 odd = texel & 1;
 
-    vs_out.height = height;
-    vs_out.fragPos = vec3(aPos.x, amplitude * height, aPos.z);
-    vs_out.viewPos = viewPos;
+    float below = 0.5f * (clipmapTexel(base, coarse) + clipmapTexel(base + ivec2(odd.x, 0), coarse));
+    float above = 0.5f * (clipmapTexel(base + ivec2(0, odd.y), coarse) + clipmapTexel(base + odd, coarse));
+    float coarseHeight = 0.5f * (below + above);
 
-    gl_Position = projection * view * vec4(vs_out.fragPos, 1.0f);
+    height = mix(height, coarseHeight, blend);
+    normal = mix(normal, clipmapNormal(base, coarse, 2.0f * spacing), blend);
 }
+#endif
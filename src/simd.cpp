@@ -0,0 +1,45 @@
+#include "simd.hpp"
+
+bool simdTargetSupported(Simd_Target target) {
+
+    switch (target) {
+        case SIMD_SCALAR: return true;
+#ifdef TERRAIN_SIMD_X86
+        case SIMD_SSE42:  return __builtin_cpu_supports("sse4.2");
+        case SIMD_AVX2:   return __builtin_cpu_supports("avx2");
+        case SIMD_AVX512: return __builtin_cpu_supports("avx512f");
+#else
+        default:          return false;
+#endif
+    }
+
+    return false;
+}
+
+static Simd_Target bestSimdTarget() {
+
+    for (int i = SIMD_TARGET_COUNT - 1; i > 0; i--) {
+        if (simdTargetSupported(Simd_Target(i))) {
+            return Simd_Target(i);
+        }
+    }
+
+    return SIMD_SCALAR;
+}
+
+Simd_Target detectSimdTarget() {
+    static const Simd_Target best = bestSimdTarget();
+    return best;
+}
+
+const char* simdTargetName(Simd_Target target) {
+
+    switch (target) {
+        case SIMD_SCALAR: return "scalar";
+        case SIMD_SSE42:  return "sse4.2";
+        case SIMD_AVX2:   return "avx2";
+        case SIMD_AVX512: return "avx512";
+    }
+
+    return "unknown";
+}
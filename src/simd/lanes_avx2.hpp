@@ -0,0 +1,62 @@
+#pragma once
+
+#include <immintrin.h>
+
+// AVX2 lane operations the kernel .inl files are written against. Only include
+// from a translation unit built with the matching -m flag (see CMakeLists.txt)
+
+// anonymous so the per-isa definitions never get merged by the linker
+namespace {
+
+struct Lanes {
+
+    typedef __m256 Float;
+    typedef __m256i Int;
+
+    static const int WIDTH = 8;
+
+    static Float load(const float* p) { return _mm256_loadu_ps(p); }
+    static void store(float* p, Float a) { _mm256_storeu_ps(p, a); }
+    static Float floor(Float a) { return _mm256_floor_ps(a); }
+    static Int roundToInt(Float a) { return _mm256_cvtps_epi32(a); }
+    static Float toFloat(Int a) { return _mm256_cvtepi32_ps(a); }
+
+    static Float set(float a) { return _mm256_set1_ps(a); }
+    static Float min(Float a, Float b) { return _mm256_min_ps(a, b); }
+    static Float max(Float a, Float b) { return _mm256_max_ps(a, b); }
+    static Float sqrt(Float a) { return _mm256_sqrt_ps(a); }
+    // 1 where x >= edge, 0 elsewhere, like glsl step()
+    static Float step(Float edge, Float x) { return _mm256_and_ps(_mm256_cmp_ps(x, edge, _CMP_GE_OQ), _mm256_set1_ps(1.0f)); }
+    // out = a0 b0 a1 b1 ..., 2 * WIDTH floats. unpack works within 128 bit halves, the permutes put them back in order
+    static void storeInterleaved(float* p, Float a, Float b) {
+        Float low = _mm256_unpacklo_ps(a, b);
+        Float high = _mm256_unpackhi_ps(a, b);
+        _mm256_storeu_ps(p, _mm256_permute2f128_ps(low, high, 0x20));
+        _mm256_storeu_ps(p + 8, _mm256_permute2f128_ps(low, high, 0x31));
+    }
+
+    static Int setInt(int a) { return _mm256_set1_epi32(a); }
+    static Int truncToInt(Float a) { return _mm256_cvttps_epi32(a); }
+    static Int addInt(Int a, Int b) { return _mm256_add_epi32(a, b); }
+    static Int mulInt(Int a, Int b) { return _mm256_mullo_epi32(a, b); }
+    static Int andInt(Int a, Int b) { return _mm256_and_si256(a, b); }
+    static Int orInt(Int a, Int b) { return _mm256_or_si256(a, b); }
+    static Int xorInt(Int a, Int b) { return _mm256_xor_si256(a, b); }
+    static Int shiftLeft(Int a, int bits) { return _mm256_slli_epi32(a, bits); }
+    static Int shiftRight(Int a, int bits) { return _mm256_srli_epi32(a, bits); }
+    static Int gatherInt(const int* table, Int index) { return _mm256_i32gather_epi32(table, index, 4); }
+    static Float gatherFloat(const float* table, Int index) { return _mm256_i32gather_ps(table, index, 4); }
+
+    // odd if bit 0 of q is set, even otherwise
+    static Float selectBit0(Int q, Float even, Float odd) {
+        Int bit = _mm256_and_si256(q, _mm256_set1_epi32(1));
+        return _mm256_blendv_ps(even, odd, _mm256_castsi256_ps(_mm256_cmpeq_epi32(bit, _mm256_set1_epi32(1))));
+    }
+
+    static Float negateIfBit1(Int q, Float a) {
+        Int sign = _mm256_slli_epi32(_mm256_and_si256(q, _mm256_set1_epi32(2)), 30);
+        return _mm256_castsi256_ps(_mm256_xor_si256(_mm256_castps_si256(a), sign));
+    }
+};
+
+}
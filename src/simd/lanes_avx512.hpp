@@ -0,0 +1,63 @@
+#pragma once
+
+#include <immintrin.h>
+
+// AVX-512F lane operations the kernel .inl files are written against. Only include
+// from a translation unit built with the matching -m flag (see CMakeLists.txt)
+
+// anonymous so the per-isa definitions never get merged by the linker
+namespace {
+
+struct Lanes {
+
+    typedef __m512 Float;
+    typedef __m512i Int;
+
+    static const int WIDTH = 16;
+
+    static Float load(const float* p) { return _mm512_loadu_ps(p); }
+    static void store(float* p, Float a) { _mm512_storeu_ps(p, a); }
+    // the masked forms with a real source avoid gcc 12 warning about the
+    // undefined source register inside the unmasked intrinsics
+    static Float floor(Float a) { return _mm512_mask_roundscale_ps(a, 0xffff, a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+    static Int roundToInt(Float a) { return _mm512_mask_cvtps_epi32(_mm512_setzero_si512(), 0xffff, a); }
+    static Float toFloat(Int a) { return _mm512_mask_cvtepi32_ps(_mm512_setzero_ps(), 0xffff, a); }
+
+    static Float set(float a) { return _mm512_set1_ps(a); }
+    static Float min(Float a, Float b) { return _mm512_mask_min_ps(a, 0xffff, a, b); }
+    static Float max(Float a, Float b) { return _mm512_mask_max_ps(a, 0xffff, a, b); }
+    static Float sqrt(Float a) { return _mm512_mask_sqrt_ps(a, 0xffff, a); }
+    // 1 where x >= edge, 0 elsewhere, like glsl step()
+    static Float step(Float edge, Float x) { return _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(x, edge, _CMP_GE_OQ), _mm512_set1_ps(1.0f)); }
+    // out = a0 b0 a1 b1 ..., 2 * WIDTH floats
+    static void storeInterleaved(float* p, Float a, Float b) {
+        const __m512i low = _mm512_setr_epi32(0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23);
+        const __m512i high = _mm512_setr_epi32(8, 24, 9, 25, 10, 26, 11, 27, 12, 28, 13, 29, 14, 30, 15, 31);
+        _mm512_storeu_ps(p, _mm512_permutex2var_ps(a, low, b));
+        _mm512_storeu_ps(p + 16, _mm512_permutex2var_ps(a, high, b));
+    }
+
+    static Int setInt(int a) { return _mm512_set1_epi32(a); }
+    static Int truncToInt(Float a) { return _mm512_mask_cvttps_epi32(_mm512_setzero_si512(), 0xffff, a); }
+    static Int addInt(Int a, Int b) { return _mm512_add_epi32(a, b); }
+    static Int mulInt(Int a, Int b) { return _mm512_mullo_epi32(a, b); }
+    static Int andInt(Int a, Int b) { return _mm512_and_si512(a, b); }
+    static Int orInt(Int a, Int b) { return _mm512_or_si512(a, b); }
+    static Int xorInt(Int a, Int b) { return _mm512_xor_si512(a, b); }
+    static Int shiftLeft(Int a, int bits) { return _mm512_mask_slli_epi32(_mm512_setzero_si512(), 0xffff, a, bits); }
+    static Int shiftRight(Int a, int bits) { return _mm512_mask_srli_epi32(_mm512_setzero_si512(), 0xffff, a, bits); }
+    static Int gatherInt(const int* table, Int index) { return _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), 0xffff, index, table, 4); }
+    static Float gatherFloat(const float* table, Int index) { return _mm512_mask_i32gather_ps(_mm512_setzero_ps(), 0xffff, index, table, 4); }
+
+    // odd if bit 0 of q is set, even otherwise
+    static Float selectBit0(Int q, Float even, Float odd) {
+        return _mm512_mask_blend_ps(_mm512_test_epi32_mask(q, _mm512_set1_epi32(1)), even, odd);
+    }
+
+    static Float negateIfBit1(Int q, Float a) {
+        Int sign = _mm512_mask_slli_epi32(_mm512_setzero_si512(), 0xffff, _mm512_and_si512(q, _mm512_set1_epi32(2)), 30);
+        return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(a), sign));
+    }
+};
+
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cmath>
+
+// one lane wide version of the Lanes structs, so kernels written against
+// Lanes also build for the scalar fallback and on non-x86 targets
+
+// anonymous so the per-isa definitions never get merged by the linker
+namespace {
+
+struct Lanes {
+
+    typedef float Float;
+    typedef int Int;
+
+    static const int WIDTH = 1;
+
+    static Float load(const float* p) { return *p; }
+    static void store(float* p, Float a) { *p = a; }
+    static Float floor(Float a) { return std::floor(a); }
+    static Float toFloat(Int a) { return float(a); }
+
+    static Float set(float a) { return a; }
+    // same operand order as minps/maxps, so +-0 and NaN come out the same as the wide targets
+    static Float min(Float a, Float b) { return a < b ? a : b; }
+    static Float max(Float a, Float b) { return a > b ? a : b; }
+    static Float sqrt(Float a) { return std::sqrt(a); }
+    static Float step(Float edge, Float x) { return x >= edge ? 1.0f : 0.0f; }
+    static void storeInterleaved(float* p, Float a, Float b) { p[0] = a; p[1] = b; }
+
+    static Int setInt(int a) { return a; }
+    static Int truncToInt(Float a) { return int(a); }
+    static Int addInt(Int a, Int b) { return a + b; }
+    static Int mulInt(Int a, Int b) { return a * b; }
+    static Float gatherFloat(const float* table, Int index) { return table[index]; }
+};
+
+}
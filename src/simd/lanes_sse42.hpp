@@ -0,0 +1,70 @@
+#pragma once
+
+#include <immintrin.h>
+
+// SSE4.2 lane operations the kernel .inl files are written against. Only include
+// from a translation unit built with the matching -m flag (see CMakeLists.txt)
+
+// anonymous so the per-isa definitions never get merged by the linker
+namespace {
+
+struct Lanes {
+
+    typedef __m128 Float;
+    typedef __m128i Int;
+
+    static const int WIDTH = 4;
+
+    static Float load(const float* p) { return _mm_loadu_ps(p); }
+    static void store(float* p, Float a) { _mm_storeu_ps(p, a); }
+    static Float floor(Float a) { return _mm_floor_ps(a); }
+    static Int roundToInt(Float a) { return _mm_cvtps_epi32(a); }
+    static Float toFloat(Int a) { return _mm_cvtepi32_ps(a); }
+
+    static Float set(float a) { return _mm_set1_ps(a); }
+    static Float min(Float a, Float b) { return _mm_min_ps(a, b); }
+    static Float max(Float a, Float b) { return _mm_max_ps(a, b); }
+    static Float sqrt(Float a) { return _mm_sqrt_ps(a); }
+    // 1 where x >= edge, 0 elsewhere, like glsl step()
+    static Float step(Float edge, Float x) { return _mm_and_ps(_mm_cmpge_ps(x, edge), _mm_set1_ps(1.0f)); }
+    // out = a0 b0 a1 b1 ..., 2 * WIDTH floats
+    static void storeInterleaved(float* p, Float a, Float b) {
+        _mm_storeu_ps(p, _mm_unpacklo_ps(a, b));
+        _mm_storeu_ps(p + 4, _mm_unpackhi_ps(a, b));
+    }
+
+    static Int setInt(int a) { return _mm_set1_epi32(a); }
+    static Int truncToInt(Float a) { return _mm_cvttps_epi32(a); }
+    static Int addInt(Int a, Int b) { return _mm_add_epi32(a, b); }
+    static Int mulInt(Int a, Int b) { return _mm_mullo_epi32(a, b); }
+    static Int andInt(Int a, Int b) { return _mm_and_si128(a, b); }
+    static Int orInt(Int a, Int b) { return _mm_or_si128(a, b); }
+    static Int xorInt(Int a, Int b) { return _mm_xor_si128(a, b); }
+    static Int shiftLeft(Int a, int bits) { return _mm_slli_epi32(a, bits); }
+    static Int shiftRight(Int a, int bits) { return _mm_srli_epi32(a, bits); }
+
+    // no gather instruction before avx2
+    static Int gatherInt(const int* table, Int index) {
+        alignas(16) int i[WIDTH];
+        _mm_store_si128((Int*)i, index);
+        return _mm_setr_epi32(table[i[0]], table[i[1]], table[i[2]], table[i[3]]);
+    }
+    static Float gatherFloat(const float* table, Int index) {
+        alignas(16) int i[WIDTH];
+        _mm_store_si128((Int*)i, index);
+        return _mm_setr_ps(table[i[0]], table[i[1]], table[i[2]], table[i[3]]);
+    }
+
+    // odd if bit 0 of q is set, even otherwise
+    static Float selectBit0(Int q, Float even, Float odd) {
+        Int bit = _mm_and_si128(q, _mm_set1_epi32(1));
+        return _mm_blendv_ps(even, odd, _mm_castsi128_ps(_mm_cmpeq_epi32(bit, _mm_set1_epi32(1))));
+    }
+
+    static Float negateIfBit1(Int q, Float a) {
+        Int sign = _mm_slli_epi32(_mm_and_si128(q, _mm_set1_epi32(2)), 30);
+        return _mm_castsi128_ps(_mm_xor_si128(_mm_castps_si128(a), sign));
+    }
+};
+
+}
@@ -0,0 +1,16 @@
+#include "lanes_avx2.hpp"
+#include "noise_kernels.hpp"
+
+#include "noise_kernels.inl"
+
+void perlinBatchAVX2(const float* xs, const float* ys, float* out, int count, const Noise_Kernel_Params& params) {
+    perlinBatchLanes(xs, ys, out, count, params);
+}
+
+void simplexBatchAVX2(const float* xs, const float* ys, float* out, int count, const Noise_Kernel_Params& params) {
+    simplexBatchLanes(xs, ys, out, count, params);
+}
+
+void worleyBatchAVX2(const float* xs, const float* ys, float* f1, float* f2, int count, const Noise_Kernel_Params& params) {
+    worleyBatchLanes(xs, ys, f1, f2, count, params);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "hash.hpp"
+
+// per instruction set entry points for the batch noise kernels, each built in
+// its own translation unit with matching -m flags (see CMakeLists.txt). Only
+// call one after simdTargetSupported() says the cpu can run it.
+
+// plain copy of the Noise state the kernels need, so they don't pull in glm
+struct Noise_Kernel_Params {
+    Hash_Type hashType;
+    unsigned int seed;
+    float timeOffset;
+    float rotationCos;
+    float rotationSin;
+    const int* perm;
+};
+
+#ifdef TERRAIN_SIMD_X86
+
+void perlinBatchSSE42(const float* xs, const float* ys, float* out, int count, const Noise_Kernel_Params& params);
+void perlinBatchAVX2(const float* xs, const float* ys, float* out, int count, const Noise_Kernel_Params& params);
+void perlinBatchAVX512(const float* xs, const float* ys, float* out, int count, const Noise_Kernel_Params& params);
+
+void simplexBatchSSE42(const float* xs, const float* ys, float* out, int count, const Noise_Kernel_Params& params);
+void simplexBatchAVX2(const float* xs, const float* ys, float* out, int count, const Noise_Kernel_Params& params);
+void simplexBatchAVX512(const float* xs, const float* ys, float* out, int count, const Noise_Kernel_Params& params);
+
+// xs/ys are already in cell units (st * VORONOI_SCALE)
+void worleyBatchSSE42(const float* xs, const float* ys, float* f1, float* f2, int count, const Noise_Kernel_Params& params);
+void worleyBatchAVX2(const float* xs, const float* ys, float* f1, float* f2, int count, const Noise_Kernel_Params& params);
+void worleyBatchAVX512(const float* xs, const float* ys, float* f1, float* f2, int count, const Noise_Kernel_Params& params);
+
+#endif
@@ -0,0 +1,318 @@
+// lane generic noise kernels, included by noise_sse42.cpp / noise_avx2.cpp /
+// noise_avx512.cpp after they define a Lanes struct for their instruction set.
+//
+// Every operation here is done in the same order as the scalar code in
+// src/noise.cpp and the files are built with -ffp-contract=off, so all
+// targets produce the same bits as Noise::perlin().
+//
+// Only <immintrin.h> and hash.hpp (constants only) are included on purpose, an
+// inline function from a shared header compiled with wider -m flags could
+// otherwise be picked by the linker for the whole program.
+
+#define NOISE_TWO_OVER_PI 0.636619772367581343f
+#define NOISE_PIO2_1 1.5703125f
+#define NOISE_PIO2_2 4.837512969970703125e-4f
+#define NOISE_PIO2_3 7.54978995489188216e-8f
+
+// must match WORLEY_JITTER and the SIMPLEX_* constants in include/noise.hpp, which isn't included here (see above)
+#define WORLEY_JITTER 0.35355339f
+#define SIMPLEX_SKEW 0.36602540378f
+#define SIMPLEX_UNSKEW 0.21132486541f
+#define SIMPLEX_UNSKEW_2 0.42264973081f
+#define SIMPLEX_SCALE 40.0f
+
+typedef Lanes::Float LFloat;
+typedef Lanes::Int LInt;
+
+static inline LFloat laneSin(LFloat x) {
+
+    LInt q = Lanes::roundToInt(x * NOISE_TWO_OVER_PI);
+    LFloat qf = Lanes::toFloat(q);
+
+    LFloat r = ((x - qf * NOISE_PIO2_1) - qf * NOISE_PIO2_2) - qf * NOISE_PIO2_3;
+    LFloat z = r * r;
+
+    LFloat s = ((-1.9515295891e-4f * z + 8.3321608736e-3f) * z - 1.6666654611e-1f) * z * r + r;
+    LFloat c = ((2.443315711809948e-5f * z - 1.388731625493765e-3f) * z + 4.166664568298827e-2f) * z * z - 0.5f * z + 1.0f;
+
+    return Lanes::negateIfBit1(q, Lanes::selectBit0(q, s, c));
+}
+
+static inline LFloat laneFract(LFloat x) {
+    return x - Lanes::floor(x);
+}
+
+static inline LFloat laneFade(LFloat t) {
+    return ((6.0f * t - 15.0f) * t + 10.0f) * t * t * t;
+}
+
+static inline LFloat laneMix(LFloat x, LFloat y, LFloat a) {
+    return x * (1.0f - a) + y * a;
+}
+
+static inline void laneRand2Sin(LFloat px, LFloat py, float timeOffset, LFloat& gx, LFloat& gy) {
+
+    LFloat a = laneFract(laneSin((px + 12.0422f) * 127.1f + (py + 12.0422f) * 311.7f) * 43758.5453f);
+    LFloat b = laneFract(laneSin((px + 5.73223f) * 269.5f + (py + 5.73223f) * 183.3f) * 43758.5453f);
+
+    gx = laneSin(laneSin(a) * 43758.5453f + timeOffset);
+    gy = laneSin(laneSin(b) * 43758.5453f + timeOffset);
+}
+
+static inline LFloat laneHashUnit(LInt bits16) {
+    return Lanes::toFloat(bits16) * HASH_UNIT_SCALE - 1.0f;
+}
+
+static inline void laneHashPCG(LInt ix, LInt iy, unsigned int seed, LFloat& gx, LFloat& gy) {
+
+    const LInt multiplier = Lanes::setInt(int(PCG_MULTIPLIER));
+    const LInt increment = Lanes::setInt(int(PCG_INCREMENT));
+
+    LInt x = Lanes::addInt(Lanes::mulInt(ix, multiplier), increment);
+    LInt y = Lanes::addInt(Lanes::mulInt(Lanes::xorInt(iy, Lanes::setInt(int(seed))), multiplier), increment);
+
+    x = Lanes::addInt(x, Lanes::mulInt(y, multiplier));
+    y = Lanes::addInt(y, Lanes::mulInt(x, multiplier));
+    x = Lanes::xorInt(x, Lanes::shiftRight(x, 16));
+    y = Lanes::xorInt(y, Lanes::shiftRight(y, 16));
+    x = Lanes::addInt(x, Lanes::mulInt(y, multiplier));
+    y = Lanes::addInt(y, Lanes::mulInt(x, multiplier));
+    x = Lanes::xorInt(x, Lanes::shiftRight(x, 16));
+    y = Lanes::xorInt(y, Lanes::shiftRight(y, 16));
+
+    gx = laneHashUnit(Lanes::shiftRight(x, 16));
+    gy = laneHashUnit(Lanes::shiftRight(y, 16));
+}
+
+static inline LInt laneRotateLeft(LInt h, int bits) {
+    return Lanes::orInt(Lanes::shiftLeft(h, bits), Lanes::shiftRight(h, 32 - bits));
+}
+
+static inline void laneHashXX(LInt ix, LInt iy, unsigned int seed, LFloat& gx, LFloat& gy) {
+
+    const LInt prime3 = Lanes::setInt(int(XXHASH_PRIME3));
+    const LInt prime4 = Lanes::setInt(int(XXHASH_PRIME4));
+
+    LInt h = Lanes::setInt(int(seed + XXHASH_PRIME5 + 8u));
+    h = Lanes::addInt(h, Lanes::mulInt(ix, prime3));
+    h = Lanes::mulInt(laneRotateLeft(h, 17), prime4);
+    h = Lanes::addInt(h, Lanes::mulInt(iy, prime3));
+    h = Lanes::mulInt(laneRotateLeft(h, 17), prime4);
+
+    h = Lanes::xorInt(h, Lanes::shiftRight(h, 15));
+    h = Lanes::mulInt(h, Lanes::setInt(int(XXHASH_PRIME2)));
+    h = Lanes::xorInt(h, Lanes::shiftRight(h, 13));
+    h = Lanes::mulInt(h, prime3);
+    h = Lanes::xorInt(h, Lanes::shiftRight(h, 16));
+
+    gx = laneHashUnit(Lanes::andInt(h, Lanes::setInt(0xffff)));
+    gy = laneHashUnit(Lanes::shiftRight(h, 16));
+}
+
+static inline void laneHashPermutation(LInt ix, LInt iy, const int* perm, LFloat& gx, LFloat& gy) {
+
+    const LInt mask = Lanes::setInt(PERM_SIZE - 1);
+
+    LInt h = Lanes::gatherInt(perm, Lanes::andInt(ix, mask));
+    h = Lanes::gatherInt(perm, Lanes::andInt(Lanes::addInt(h, iy), mask));
+    h = Lanes::andInt(h, Lanes::setInt(7));
+
+    gx = Lanes::gatherFloat(PERM_GRAD_X, h);
+    gy = Lanes::gatherFloat(PERM_GRAD_Y, h);
+}
+
+// gradient at integer lattice point (px, py), same as Noise::rand2
+static inline void laneRand2(LFloat px, LFloat py, const Noise_Kernel_Params& params, LFloat& gx, LFloat& gy) {
+
+    if (params.hashType == HASH_SIN) {
+        laneRand2Sin(px, py, params.timeOffset, gx, gy);
+        return;
+    }
+
+    LInt ix = Lanes::truncToInt(px);
+    LInt iy = Lanes::truncToInt(py);
+    LFloat hx, hy;
+
+    if (params.hashType == HASH_PCG) {
+        laneHashPCG(ix, iy, params.seed, hx, hy);
+    } else if (params.hashType == HASH_XXHASH) {
+        laneHashXX(ix, iy, params.seed, hx, hy);
+    } else {
+        laneHashPermutation(ix, iy, params.perm, hx, hy);
+    }
+
+    // animate by rotating the gradient instead of hashing timeOffset
+    gx = hx * params.rotationCos - hy * params.rotationSin;
+    gy = hx * params.rotationSin + hy * params.rotationCos;
+}
+
+static inline LFloat lanePerlin(LFloat x, LFloat y, const Noise_Kernel_Params& params) {
+
+    LFloat gridX = Lanes::floor(x);
+    LFloat gridY = Lanes::floor(y);
+    LFloat u = x - gridX;
+    LFloat v = y - gridY;
+
+    LFloat gridX1 = gridX + 1.0f;
+    LFloat gridY1 = gridY + 1.0f;
+
+    LFloat blX, blY, brX, brY, tlX, tlY, trX, trY;
+    laneRand2(gridX,  gridY,  params, blX, blY);
+    laneRand2(gridX1, gridY,  params, brX, brY);
+    laneRand2(gridX,  gridY1, params, tlX, tlY);
+    laneRand2(gridX1, gridY1, params, trX, trY);
+
+    LFloat u1 = u - 1.0f;
+    LFloat v1 = v - 1.0f;
+
+    LFloat dotBottomLeft  = u  * blX + v  * blY;
+    LFloat dotBottomRight = u1 * brX + v  * brY;
+    LFloat dotTopLeft     = u  * tlX + v1 * tlY;
+    LFloat dotTopRight    = u1 * trX + v1 * trY;
+
+    LFloat fu = laneFade(u);
+    LFloat fv = laneFade(v);
+
+    return laneMix(laneMix(dotBottomLeft, dotBottomRight, fu), laneMix(dotTopLeft, dotTopRight, fu), fv);
+}
+
+static inline LFloat laneSimplexCorner(LFloat dx, LFloat dy, LFloat gx, LFloat gy) {
+
+    LFloat falloff = Lanes::max(0.5f - (dx * dx + dy * dy), Lanes::set(0.0f));
+    falloff = falloff * falloff;
+    return falloff * falloff * (gx * dx + gy * dy);
+}
+
+// same operations as Noise::simplex()
+static inline LFloat laneSimplex(LFloat x, LFloat y, const Noise_Kernel_Params& params) {
+
+    LFloat skew = (x + y) * SIMPLEX_SKEW;
+    LFloat cellX = Lanes::floor(x + skew);
+    LFloat cellY = Lanes::floor(y + skew);
+    LFloat unskew = (cellX + cellY) * SIMPLEX_UNSKEW;
+
+    LFloat x0 = x - (cellX - unskew);
+    LFloat y0 = y - (cellY - unskew);
+
+    LFloat stepX = Lanes::step(y0, x0);
+    LFloat stepY = 1.0f - stepX;
+
+    LFloat x1 = (x0 - stepX) + SIMPLEX_UNSKEW;
+    LFloat y1 = (y0 - stepY) + SIMPLEX_UNSKEW;
+    LFloat x2 = (x0 - 1.0f) + SIMPLEX_UNSKEW_2;
+    LFloat y2 = (y0 - 1.0f) + SIMPLEX_UNSKEW_2;
+
+    LFloat g0x, g0y, g1x, g1y, g2x, g2y;
+    laneRand2(cellX, cellY, params, g0x, g0y);
+    laneRand2(cellX + stepX, cellY + stepY, params, g1x, g1y);
+    laneRand2(cellX + 1.0f, cellY + 1.0f, params, g2x, g2y);
+
+    LFloat n0 = laneSimplexCorner(x0, y0, g0x, g0y);
+    LFloat n1 = laneSimplexCorner(x1, y1, g1x, g1y);
+    LFloat n2 = laneSimplexCorner(x2, y2, g2x, g2y);
+
+    return ((n0 + n1) + n2) * SIMPLEX_SCALE;
+}
+
+// same operations as Noise::worley() after its st * VORONOI_SCALE
+static inline void laneWorley(LFloat x, LFloat y, const Noise_Kernel_Params& params, LFloat& f1, LFloat& f2) {
+
+    LFloat cellX = Lanes::floor(x);
+    LFloat cellY = Lanes::floor(y);
+    LFloat fx = x - cellX;
+    LFloat fy = y - cellY;
+
+    f1 = Lanes::set(8.0f);
+    f2 = Lanes::set(8.0f);
+
+    for (int j = -1; j <= 1; j++) {
+        for (int i = -1; i <= 1; i++) {
+
+            LFloat offsetX, offsetY;
+            laneRand2(cellX + float(i), cellY + float(j), params, offsetX, offsetY);
+
+            LFloat dx = ((float(i) + 0.5f) + offsetX * WORLEY_JITTER) - fx;
+            LFloat dy = ((float(j) + 0.5f) + offsetY * WORLEY_JITTER) - fy;
+            LFloat dist = dx * dx + dy * dy;
+
+            f2 = Lanes::min(f2, Lanes::max(f1, dist));
+            f1 = Lanes::min(f1, dist);
+        }
+    }
+
+    f1 = Lanes::sqrt(f1);
+    f2 = Lanes::sqrt(f2);
+}
+
+// out[i] = kernel(xs[i], ys[i])
+template <LFloat (*kernel)(LFloat, LFloat, const Noise_Kernel_Params&)>
+static void noiseBatchLanes(const float* xs, const float* ys, float* out, int count, const Noise_Kernel_Params& params) {
+
+    int i = 0;
+
+    for (; i + Lanes::WIDTH <= count; i += Lanes::WIDTH) {
+        Lanes::store(out + i, kernel(Lanes::load(xs + i), Lanes::load(ys + i), params));
+    }
+
+    if (i == count) {
+        return;
+    }
+
+    // pad the tail out to a full vector rather than keeping a scalar copy of the kernel
+    float tailX[Lanes::WIDTH] = {};
+    float tailY[Lanes::WIDTH] = {};
+    float tailOut[Lanes::WIDTH];
+
+    for (int j = 0; i + j < count; j++) {
+        tailX[j] = xs[i + j];
+        tailY[j] = ys[i + j];
+    }
+
+    Lanes::store(tailOut, kernel(Lanes::load(tailX), Lanes::load(tailY), params));
+
+    for (int j = 0; i + j < count; j++) {
+        out[i + j] = tailOut[j];
+    }
+}
+
+static void perlinBatchLanes(const float* xs, const float* ys, float* out, int count, const Noise_Kernel_Params& params) {
+    noiseBatchLanes<lanePerlin>(xs, ys, out, count, params);
+}
+
+static void simplexBatchLanes(const float* xs, const float* ys, float* out, int count, const Noise_Kernel_Params& params) {
+    noiseBatchLanes<laneSimplex>(xs, ys, out, count, params);
+}
+
+static void worleyBatchLanes(const float* xs, const float* ys, float* f1, float* f2, int count, const Noise_Kernel_Params& params) {
+
+    int i = 0;
+    LFloat laneF1, laneF2;
+
+    for (; i + Lanes::WIDTH <= count; i += Lanes::WIDTH) {
+        laneWorley(Lanes::load(xs + i), Lanes::load(ys + i), params, laneF1, laneF2);
+        Lanes::store(f1 + i, laneF1);
+        Lanes::store(f2 + i, laneF2);
+    }
+
+    if (i == count) {
+        return;
+    }
+
+    float tailX[Lanes::WIDTH] = {};
+    float tailY[Lanes::WIDTH] = {};
+    float tailF1[Lanes::WIDTH], tailF2[Lanes::WIDTH];
+
+    for (int j = 0; i + j < count; j++) {
+        tailX[j] = xs[i + j];
+        tailY[j] = ys[i + j];
+    }
+
+    laneWorley(Lanes::load(tailX), Lanes::load(tailY), params, laneF1, laneF2);
+    Lanes::store(tailF1, laneF1);
+    Lanes::store(tailF2, laneF2);
+
+    for (int j = 0; i + j < count; j++) {
+        f1[i + j] = tailF1[j];
+        f2[i + j] = tailF2[j];
+    }
+}
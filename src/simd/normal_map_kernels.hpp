@@ -0,0 +1,16 @@
+#pragma once
+
+// per instruction set normal map rows for generateNormalMap, built like the
+// noise kernels (see noise_kernels.hpp). The scalar path in normal_map.cpp
+// does the edges, tails and the whole row without simd.
+
+#ifdef TERRAIN_SIMD_X86
+
+// writes the (x, z) normals of the interior texels of one row from x = 1
+// onwards in whole vectors and returns the first x it didn't get to. scale is
+// heightScale / (2 * texelSize)
+int normalMapRowSSE42(const float* below, const float* row, const float* above, float* out, int width, float scale);
+int normalMapRowAVX2(const float* below, const float* row, const float* above, float* out, int width, float scale);
+int normalMapRowAVX512(const float* below, const float* row, const float* above, float* out, int width, float scale);
+
+#endif
@@ -0,0 +1,20 @@
+// lane generic normal map rows, included by the normal_map_*.cpp files after
+// their Lanes header. Same operations in the same order as texelNormal in
+// normal_map.cpp, so every target gives the same bits
+
+typedef Lanes::Float LFloat;
+
+static int normalMapRowLanes(const float* below, const float* row, const float* above, float* out, int width, float scale) {
+
+    int x = 1;
+    for (; x + Lanes::WIDTH <= width - 1; x += Lanes::WIDTH) {
+
+        LFloat slopeX = (Lanes::load(row + x - 1) - Lanes::load(row + x + 1)) * scale;
+        LFloat slopeZ = (Lanes::load(below + x) - Lanes::load(above + x)) * scale;
+
+        LFloat invLength = 1.0f / Lanes::sqrt((slopeX * slopeX + slopeZ * slopeZ) + 1.0f);
+        Lanes::storeInterleaved(out + 2 * x, slopeX * invLength, slopeZ * invLength);
+    }
+
+    return x;
+}
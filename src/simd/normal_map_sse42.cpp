@@ -0,0 +1,8 @@
+#include "lanes_sse42.hpp"
+#include "normal_map_kernels.hpp"
+
+#include "normal_map_kernels.inl"
+
+int normalMapRowSSE42(const float* below, const float* row, const float* above, float* out, int width, float scale) {
+    return normalMapRowLanes(below, row, above, out, width, scale);
+}
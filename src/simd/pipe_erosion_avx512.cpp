@@ -0,0 +1,10 @@
+#include <cstddef>
+
+#include "lanes_avx512.hpp"
+#include "pipe_erosion_kernels.hpp"
+
+#include "pipe_erosion_kernels.inl"
+
+void pipeErosionRowsAVX512(Pipe_Sweep sweep, const Pipe_Kernel_State& state, int rowBegin, int rowEnd) {
+    pipeErosionRowsLanes(sweep, state, rowBegin, rowEnd);
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+// per instruction set entry points for the pipe model erosion sweeps, built
+// like the noise kernels (see noise_kernels.hpp). The scalar one is built
+// from the same source and is always available.
+
+// the four passes of one pipe model iteration, each needs the previous one
+// finished over the whole field before it can start
+enum Pipe_Sweep {
+    PIPE_SWEEP_FLUX,        // outflow flux to the four neighbours from the water surface difference
+    PIPE_SWEEP_WATER,       // net flux into water depth, velocity and sediment capacity
+    PIPE_SWEEP_EROSION,     // dissolve or deposit towards capacity, evaporate
+    PIPE_SWEEP_ADVECTION    // carry sediment along the velocity field into sedimentNext
+};
+
+// water depth of every ghost cell, high enough that water never flows out of
+// the field but small enough that the flux sums stay finite
+#define PIPE_GHOST_WATER 1e30f
+
+// plain view of PipeErosion's arrays and the per step constants. Every array is
+// (height + 2) rows of stride floats, cell (x, y) of the field lives at
+// (y + 1) * stride + x + 1 and everything around it is a ghost cell
+struct Pipe_Kernel_State {
+    int width;
+    int height;
+    int stride;
+
+    float* terrain;
+    float* water;
+    float* sediment;
+    float* sedimentNext;
+    float* fluxLeft;
+    float* fluxRight;
+    float* fluxBottom;
+    float* fluxTop;
+    float* velocityX;
+    float* velocityY;
+    float* capacity;
+
+    const float* mask;      // 1 for field cells, 0 for ghosts
+    const float* column;    // x index of each column as a float
+
+    float timeStep;
+    float rainStep;         // water added per cell per step
+    float fluxScale;        // timeStep * pipeArea * gravity / pipeLength
+    float cellArea;
+    float pipeLength;
+    float sedimentCapacity;
+    float minTilt;
+    float dissolveRate;
+    float depositRate;
+    float evaporation;      // fraction of water lost per step
+};
+
+// runs sweep over padded rows [rowBegin, rowEnd), which must be within [1, height]
+void pipeErosionRowsScalar(Pipe_Sweep sweep, const Pipe_Kernel_State& state, int rowBegin, int rowEnd);
+
+#ifdef TERRAIN_SIMD_X86
+
+void pipeErosionRowsSSE42(Pipe_Sweep sweep, const Pipe_Kernel_State& state, int rowBegin, int rowEnd);
+void pipeErosionRowsAVX2(Pipe_Sweep sweep, const Pipe_Kernel_State& state, int rowBegin, int rowEnd);
+void pipeErosionRowsAVX512(Pipe_Sweep sweep, const Pipe_Kernel_State& state, int rowBegin, int rowEnd);
+
+#endif
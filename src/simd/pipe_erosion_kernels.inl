@@ -0,0 +1,177 @@
+// lane generic pipe model erosion sweeps (Mei et al., "Fast Hydraulic Erosion
+// Simulation and Visualization on GPU"), included by the pipe_erosion_*.cpp
+// files after their Lanes header. Rows are swept a whole stride at a time;
+// ghost cells are computed like any other and then multiplied by a mask of 0,
+// which keeps the loops free of edge cases.
+//
+// Ghost cells hold PIPE_GHOST_WATER so no water ever flows out of the field,
+// and ghost terrain is a copy of the nearest edge so slopes stay sensible.
+
+#define PIPE_MIN_DEPTH 1e-3f
+#define PIPE_MIN_FLUX 1e-20f
+
+typedef Lanes::Float LFloat;
+typedef Lanes::Int LInt;
+
+static void pipeFluxRow(const Pipe_Kernel_State& s, int y) {
+
+    const size_t row = size_t(y) * s.stride;
+    const float* b = s.terrain + row;
+    const float* d = s.water + row;
+    const int up = s.stride;
+
+    const LFloat zero = Lanes::set(0.0f);
+    const LFloat one = Lanes::set(1.0f);
+
+    for (int x = 0; x < s.stride; x += Lanes::WIDTH) {
+
+        // rain is the same everywhere so it cancels out of the differences
+        LFloat surface = Lanes::load(b + x) + Lanes::load(d + x);
+        LFloat left    = Lanes::load(b + x - 1) + Lanes::load(d + x - 1);
+        LFloat right   = Lanes::load(b + x + 1) + Lanes::load(d + x + 1);
+        LFloat bottom  = Lanes::load(b + x - up) + Lanes::load(d + x - up);
+        LFloat top     = Lanes::load(b + x + up) + Lanes::load(d + x + up);
+
+        LFloat fl = Lanes::max(zero, Lanes::load(s.fluxLeft + row + x) + (surface - left) * s.fluxScale);
+        LFloat fr = Lanes::max(zero, Lanes::load(s.fluxRight + row + x) + (surface - right) * s.fluxScale);
+        LFloat fb = Lanes::max(zero, Lanes::load(s.fluxBottom + row + x) + (surface - bottom) * s.fluxScale);
+        LFloat ft = Lanes::max(zero, Lanes::load(s.fluxTop + row + x) + (surface - top) * s.fluxScale);
+
+        // never let more flow out in one step than the cell holds
+        LFloat total = fl + fr + fb + ft;
+        LFloat depth = Lanes::load(d + x) + s.rainStep;
+        LFloat scale = Lanes::min(one, depth * s.cellArea / Lanes::max(total * s.timeStep, Lanes::set(PIPE_MIN_FLUX)));
+        scale = scale * Lanes::load(s.mask + x);
+
+        Lanes::store(s.fluxLeft + row + x, fl * scale);
+        Lanes::store(s.fluxRight + row + x, fr * scale);
+        Lanes::store(s.fluxBottom + row + x, fb * scale);
+        Lanes::store(s.fluxTop + row + x, ft * scale);
+    }
+}
+
+static void pipeWaterRow(const Pipe_Kernel_State& s, int y) {
+
+    const size_t row = size_t(y) * s.stride;
+    const float* b = s.terrain + row;
+    const int up = s.stride;
+
+    const LFloat zero = Lanes::set(0.0f);
+    const LFloat one = Lanes::set(1.0f);
+
+    for (int x = 0; x < s.stride; x += Lanes::WIDTH) {
+
+        const size_t i = row + x;
+
+        LFloat fl = Lanes::load(s.fluxLeft + i);
+        LFloat fr = Lanes::load(s.fluxRight + i);
+        LFloat fb = Lanes::load(s.fluxBottom + i);
+        LFloat ft = Lanes::load(s.fluxTop + i);
+
+        LFloat inLeft   = Lanes::load(s.fluxRight + i - 1);
+        LFloat inRight  = Lanes::load(s.fluxLeft + i + 1);
+        LFloat inBottom = Lanes::load(s.fluxTop + i - up);
+        LFloat inTop    = Lanes::load(s.fluxBottom + i + up);
+
+        LFloat inflow = inLeft + inRight + inBottom + inTop;
+        LFloat outflow = fl + fr + fb + ft;
+
+        LFloat mask = Lanes::load(s.mask + x);
+        LFloat oldDepth = Lanes::load(s.water + i);
+        LFloat rained = oldDepth + s.rainStep;
+        LFloat newDepth = Lanes::max(zero, rained + (inflow - outflow) * (s.timeStep / s.cellArea));
+
+        // ghosts keep their depth, (newDepth - oldDepth) is exactly 0 for them
+        Lanes::store(s.water + i, oldDepth + (newDepth - oldDepth) * mask);
+
+        LFloat depth = Lanes::max((rained + newDepth) * 0.5f * s.pipeLength, Lanes::set(PIPE_MIN_DEPTH));
+        LFloat u = ((inLeft - fl) + (fr - inRight)) * 0.5f / depth * mask;
+        LFloat v = ((inBottom - fb) + (ft - inTop)) * 0.5f / depth * mask;
+        Lanes::store(s.velocityX + i, u);
+        Lanes::store(s.velocityY + i, v);
+
+        // sin of the terrain tilt from central differences
+        LFloat gx = (Lanes::load(b + x + 1) - Lanes::load(b + x - 1)) * (0.5f / s.pipeLength);
+        LFloat gy = (Lanes::load(b + x + up) - Lanes::load(b + x - up)) * (0.5f / s.pipeLength);
+        LFloat slope = gx * gx + gy * gy;
+        LFloat sinTilt = Lanes::max(Lanes::sqrt(slope / (one + slope)), Lanes::set(s.minTilt));
+
+        Lanes::store(s.capacity + i, sinTilt * Lanes::sqrt(u * u + v * v) * s.sedimentCapacity);
+    }
+}
+
+static void pipeErosionRow(const Pipe_Kernel_State& s, int y) {
+
+    const size_t row = size_t(y) * s.stride;
+    const LFloat zero = Lanes::set(0.0f);
+
+    for (int x = 0; x < s.stride; x += Lanes::WIDTH) {
+
+        const size_t i = row + x;
+
+        LFloat capacity = Lanes::load(s.capacity + i);
+        LFloat sediment = Lanes::load(s.sediment + i);
+
+        LFloat dissolve = Lanes::max(zero, capacity - sediment) * s.dissolveRate;
+        LFloat deposit = Lanes::max(zero, sediment - capacity) * s.depositRate;
+
+        Lanes::store(s.terrain + i, Lanes::load(s.terrain + i) - dissolve + deposit);
+        Lanes::store(s.sediment + i, sediment + dissolve - deposit);
+
+        LFloat water = Lanes::load(s.water + i);
+        Lanes::store(s.water + i, water - water * s.evaporation * Lanes::load(s.mask + x));
+    }
+}
+
+// semi-lagrangian: each cell takes the sediment found where its velocity says
+// the water came from, bilinearly sampled and clamped to the field
+static void pipeAdvectionRow(const Pipe_Kernel_State& s, int y) {
+
+    const size_t row = size_t(y) * s.stride;
+
+    const LFloat minCoord = Lanes::set(1.0f);
+    const LFloat maxX = Lanes::set(float(s.width));
+    const LFloat maxY = Lanes::set(float(s.height));
+    const LFloat lastCellX = Lanes::set(float(s.width - 1));
+    const LFloat lastCellY = Lanes::set(float(s.height - 1));
+    const LInt stride = Lanes::setInt(s.stride);
+    const LInt one = Lanes::setInt(1);
+
+    for (int x = 0; x < s.stride; x += Lanes::WIDTH) {
+
+        const size_t i = row + x;
+
+        LFloat px = Lanes::load(s.column + x) - Lanes::load(s.velocityX + i) * s.timeStep;
+        LFloat py = Lanes::set(float(y)) - Lanes::load(s.velocityY + i) * s.timeStep;
+        px = Lanes::max(minCoord, Lanes::min(maxX, px));
+        py = Lanes::max(minCoord, Lanes::min(maxY, py));
+
+        LFloat cellX = Lanes::min(Lanes::floor(px), lastCellX);
+        LFloat cellY = Lanes::min(Lanes::floor(py), lastCellY);
+        LFloat tx = px - cellX;
+        LFloat ty = py - cellY;
+
+        LInt index = Lanes::addInt(Lanes::mulInt(Lanes::truncToInt(cellY), stride), Lanes::truncToInt(cellX));
+        LFloat s00 = Lanes::gatherFloat(s.sediment, index);
+        LFloat s10 = Lanes::gatherFloat(s.sediment, Lanes::addInt(index, one));
+        LFloat s01 = Lanes::gatherFloat(s.sediment, Lanes::addInt(index, stride));
+        LFloat s11 = Lanes::gatherFloat(s.sediment, Lanes::addInt(Lanes::addInt(index, stride), one));
+
+        LFloat bottom = s00 * (1.0f - tx) + s10 * tx;
+        LFloat top = s01 * (1.0f - tx) + s11 * tx;
+
+        Lanes::store(s.sedimentNext + i, (bottom * (1.0f - ty) + top * ty) * Lanes::load(s.mask + x));
+    }
+}
+
+static void pipeErosionRowsLanes(Pipe_Sweep sweep, const Pipe_Kernel_State& state, int rowBegin, int rowEnd) {
+
+    for (int y = rowBegin; y < rowEnd; y++) {
+        switch (sweep) {
+            case PIPE_SWEEP_FLUX:      pipeFluxRow(state, y); break;
+            case PIPE_SWEEP_WATER:     pipeWaterRow(state, y); break;
+            case PIPE_SWEEP_EROSION:   pipeErosionRow(state, y); break;
+            case PIPE_SWEEP_ADVECTION: pipeAdvectionRow(state, y); break;
+        }
+    }
+}
@@ -0,0 +1,10 @@
+#include <cstddef>
+
+#include "lanes_scalar.hpp"
+#include "pipe_erosion_kernels.hpp"
+
+#include "pipe_erosion_kernels.inl"
+
+void pipeErosionRowsScalar(Pipe_Sweep sweep, const Pipe_Kernel_State& state, int rowBegin, int rowEnd) {
+    pipeErosionRowsLanes(sweep, state, rowBegin, rowEnd);
+}
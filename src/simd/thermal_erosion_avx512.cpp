@@ -0,0 +1,9 @@
+#include "lanes_avx512.hpp"
+#include "thermal_erosion_kernels.hpp"
+
+#include "thermal_erosion_kernels.inl"
+
+int thermalRelaxRowAVX512(const float* below, const float* row, const float* above, float* out, int width,
+                          float talus, float k, float& excess) {
+    return thermalRelaxRowLanes(below, row, above, out, width, talus, k, excess);
+}
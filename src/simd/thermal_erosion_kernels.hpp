@@ -0,0 +1,19 @@
+#pragma once
+
+// per instruction set talus relaxation rows for erodeThermal, built like the
+// noise kernels (see noise_kernels.hpp). There's no scalar entry point, the
+// scalar path in thermal_erosion.cpp relaxes every cell itself.
+
+#ifdef TERRAIN_SIMD_X86
+
+// relaxes the interior cells of one row from x = 1 onwards in whole vectors,
+// reading the rows either side, and returns the first x it didn't get to.
+// excess is raised to the largest amount any cell was over talus
+int thermalRelaxRowSSE42(const float* below, const float* row, const float* above, float* out, int width,
+                         float talus, float k, float& excess);
+int thermalRelaxRowAVX2(const float* below, const float* row, const float* above, float* out, int width,
+                        float talus, float k, float& excess);
+int thermalRelaxRowAVX512(const float* below, const float* row, const float* above, float* out, int width,
+                          float talus, float k, float& excess);
+
+#endif
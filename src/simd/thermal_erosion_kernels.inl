@@ -0,0 +1,45 @@
+// lane generic talus relaxation, included by the thermal_erosion_*.cpp files
+// after their Lanes header. Same operations in the same order as relaxCell in
+// thermal_erosion.cpp, so every target relaxes to the same bits
+
+typedef Lanes::Float LFloat;
+
+static inline LFloat laneTalusFlow(LFloat from, LFloat to, LFloat talus) {
+    return Lanes::max(from - to - talus, Lanes::set(0.0f));
+}
+
+static int thermalRelaxRowLanes(const float* below, const float* row, const float* above, float* out, int width,
+                                float talusIn, float k, float& excess) {
+
+    const LFloat talus = Lanes::set(talusIn);
+    LFloat laneExcess = Lanes::set(excess);
+
+    int x = 1;
+    for (; x + Lanes::WIDTH <= width - 1; x += Lanes::WIDTH) {
+
+        LFloat h = Lanes::load(row + x);
+        LFloat left = Lanes::load(row + x - 1);
+        LFloat right = Lanes::load(row + x + 1);
+        LFloat down = Lanes::load(below + x);
+        LFloat up = Lanes::load(above + x);
+
+        LFloat outLeft = laneTalusFlow(h, left, talus);
+        LFloat outRight = laneTalusFlow(h, right, talus);
+        LFloat outBelow = laneTalusFlow(h, down, talus);
+        LFloat outAbove = laneTalusFlow(h, up, talus);
+
+        LFloat in = laneTalusFlow(left, h, talus) + laneTalusFlow(right, h, talus) + laneTalusFlow(down, h, talus) + laneTalusFlow(up, h, talus);
+        LFloat outflow = outLeft + outRight + outBelow + outAbove;
+
+        laneExcess = Lanes::max(laneExcess, Lanes::max(Lanes::max(outLeft, outRight), Lanes::max(outBelow, outAbove)));
+        Lanes::store(out + x, h + (in - outflow) * k);
+    }
+
+    float lanes[Lanes::WIDTH];
+    Lanes::store(lanes, laneExcess);
+    for (int i = 0; i < Lanes::WIDTH; i++) {
+        excess = excess > lanes[i] ? excess : lanes[i];
+    }
+
+    return x;
+}
@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+#include <glad/glad.h>
+
+#include "heightfield.hpp"
+#include "job_pool.hpp"
+#include "texture_readback.hpp"
+
+// rows per job when a finished buffer is copied out across the pool
+#define TEXTURE_READBACK_BAND_ROWS 256
+// how long finish waits on a fence between checks, in nanoseconds
+#define TEXTURE_READBACK_WAIT 1000000000
+
+TextureReadback::TextureReadback(int widthIn, int heightIn, int bufferCount) {
+
+    width = widthIn;
+    height = heightIn;
+
+    const GLsizeiptr bytes = GLsizeiptr(width) * height * sizeof(float);
+
+    buffers.resize(std::max(bufferCount, 1));
+    for (Readback_Buffer& buffer : buffers) {
+        glGenBuffers(1, &buffer.pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, bytes, NULL, GL_STREAM_READ);
+        buffer.fence = nullptr;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+TextureReadback::~TextureReadback() {
+    for (Readback_Buffer& buffer : buffers) {
+        if (buffer.fence) {
+            glDeleteSync(GLsync(buffer.fence));
+        }
+        glDeleteBuffers(1, &buffer.pbo);
+    }
+}
+
+ReadbackFuture TextureReadback::request(unsigned int texture) {
+
+    auto free = std::find_if(buffers.begin(), buffers.end(), [](const Readback_Buffer& buffer) { return !buffer.result; });
+    if (free == buffers.end()) {
+        return ReadbackFuture();
+    }
+
+    // with a pack buffer bound the copy only has to be queued, nothing waits for it here
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, free->pbo);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RED, GL_FLOAT, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    // flushed so the fence is sure to signal without anyone waiting on it
+    free->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+
+    free->result = std::make_shared<Readback_Result>(width, height);
+    return ReadbackFuture(free->result);
+}
+
+int TextureReadback::poll(JobPool& pool) {
+
+    int completed = 0;
+
+    for (Readback_Buffer& buffer : buffers) {
+
+        if (!buffer.result) {
+            continue;
+        }
+
+        GLenum status = glClientWaitSync(GLsync(buffer.fence), 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED) {
+            continue;
+        }
+        if (status == GL_WAIT_FAILED) {
+            std::cout << "ERROR::TEXTURE_READBACK::WAIT_FAILED\n\t" << width << "x" << height << "\n";
+            buffer.result->failed = true;
+        }
+
+        glDeleteSync(GLsync(buffer.fence));
+        buffer.fence = nullptr;
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.pbo);
+        const float* mapped = static_cast<const float*>(
+            glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, GLsizeiptr(width) * height * sizeof(float), GL_MAP_READ_BIT));
+
+        if (mapped && !buffer.result->failed) {
+            Heightfield& field = buffer.result->field;
+            const int bands = (height + TEXTURE_READBACK_BAND_ROWS - 1) / TEXTURE_READBACK_BAND_ROWS;
+
+            pool.parallelFor(bands, [&](int band) {
+                int first = band * TEXTURE_READBACK_BAND_ROWS;
+                int rows = std::min(TEXTURE_READBACK_BAND_ROWS, height - first);
+                std::memcpy(field.row(first), mapped + size_t(first) * width, size_t(rows) * width * sizeof(float));
+            });
+            // false when the buffer's contents were lost while mapped (e.g. a mode switch)
+            if (glUnmapBuffer(GL_PIXEL_PACK_BUFFER) != GL_TRUE) {
+                std::cout << "ERROR::TEXTURE_READBACK::UNMAP_FAILED\n\t" << width << "x" << height << "\n";
+                buffer.result->failed = true;
+            }
+        } else if (mapped) {
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        } else {
+            std::cout << "ERROR::TEXTURE_READBACK::MAP_FAILED\n\t" << width << "x" << height << "\n";
+            buffer.result->failed = true;
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        // a failed copy still completes, so whoever is waiting isn't left waiting
+        // forever, but as failed() so its zeros aren't taken for the texture
+        buffer.result->ready = true;
+        buffer.result.reset();
+        completed++;
+    }
+
+    return completed;
+}
+
+int TextureReadback::finish(JobPool& pool) {
+
+    for (Readback_Buffer& buffer : buffers) {
+        while (buffer.fence &&
+               glClientWaitSync(GLsync(buffer.fence), GL_SYNC_FLUSH_COMMANDS_BIT, TEXTURE_READBACK_WAIT) == GL_TIMEOUT_EXPIRED) {
+        }
+    }
+    return poll(pool);
+}
+
+int TextureReadback::pending() const {
+    return int(std::count_if(buffers.begin(), buffers.end(), [](const Readback_Buffer& buffer) { return buffer.result != nullptr; }));
+}
@@ -0,0 +1,259 @@
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <vector>
+
+#include "heightfield.hpp"
+#include "job_pool.hpp"
+#include "simd.hpp"
+#include "simd/thermal_erosion_kernels.hpp"
+#include "thermal_erosion.hpp"
+
+#define THERMAL_DEGREES_TO_RADIANS 0.0174532925199432958f
+
+// runs rows(rowBegin, rowEnd) over the whole height in THERMAL_BAND_ROWS bands
+static void forEachBand(JobPool& pool, int height, const std::function<void(int, int, int)>& rows) {
+
+    int bands = (height + THERMAL_BAND_ROWS - 1) / THERMAL_BAND_ROWS;
+
+    pool.parallelFor(bands, [&](int band) {
+        int rowBegin = band * THERMAL_BAND_ROWS;
+        rows(band, rowBegin, std::min(height, rowBegin + THERMAL_BAND_ROWS));
+    });
+}
+
+// flow from a cell into a neighbour lower by more than talus. A pair of cells
+// works it out the same way from both sides, so what one loses the other gains
+static inline float talusFlow(float from, float to, float talus) {
+    return std::max(0.0f, from - to - talus);
+}
+
+static inline float relaxCell(float h, float left, float right, float below, float above, float talus, float k, float& excess) {
+
+    float outLeft = talusFlow(h, left, talus);
+    float outRight = talusFlow(h, right, talus);
+    float outBelow = talusFlow(h, below, talus);
+    float outAbove = talusFlow(h, above, talus);
+
+    float in = talusFlow(left, h, talus) + talusFlow(right, h, talus) + talusFlow(below, h, talus) + talusFlow(above, h, talus);
+    float out = outLeft + outRight + outBelow + outAbove;
+
+    excess = std::max(excess, std::max(std::max(outLeft, outRight), std::max(outBelow, outAbove)));
+    return h + (in - out) * k;
+}
+
+// interior cells of a row the SIMD kernels can take, returns the first x left to the scalar path
+static int relaxRowWide(Simd_Target target, const float* below, const float* row, const float* above, float* out, int width,
+                        float talus, float k, float& excess) {
+
+    switch (target) {
+#ifdef TERRAIN_SIMD_X86
+        case SIMD_SSE42:  return thermalRelaxRowSSE42(below, row, above, out, width, talus, k, excess);
+        case SIMD_AVX2:   return thermalRelaxRowAVX2(below, row, above, out, width, talus, k, excess);
+        case SIMD_AVX512: return thermalRelaxRowAVX512(below, row, above, out, width, talus, k, excess);
+#endif
+        default:          return 1;
+    }
+}
+
+// one jacobi pass from src into dst, edges clamp so nothing flows off the field.
+// Returns how far the steepest slope of src was over talus
+static float relaxPass(const Heightfield& src, Heightfield& dst, float talus, float k, Simd_Target target, JobPool& pool,
+                       std::vector<float>& bandExcess) {
+
+    const int width = src.width;
+    const int height = src.height;
+    bandExcess.assign((height + THERMAL_BAND_ROWS - 1) / THERMAL_BAND_ROWS, 0.0f);
+
+    forEachBand(pool, height, [&](int band, int rowBegin, int rowEnd) {
+
+        float excess = 0.0f;
+
+        for (int y = rowBegin; y < rowEnd; y++) {
+
+            const float* row = src.row(y);
+            const float* below = src.row(std::max(0, y - 1));
+            const float* above = src.row(std::min(height - 1, y + 1));
+            float* out = dst.row(y);
+
+            out[0] = relaxCell(row[0], row[0], row[1], below[0], above[0], talus, k, excess);
+            for (int x = relaxRowWide(target, below, row, above, out, width, talus, k, excess); x < width - 1; x++) {
+                out[x] = relaxCell(row[x], row[x - 1], row[x + 1], below[x], above[x], talus, k, excess);
+            }
+            out[width - 1] = relaxCell(row[width - 1], row[width - 2], row[width - 1], below[width - 1], above[width - 1], talus, k, excess);
+        }
+
+        bandExcess[band] = excess;
+    });
+
+    return *std::max_element(bandExcess.begin(), bandExcess.end());
+}
+
+// relaxes field until its steepest slope is within tolerance of talus, returns the passes applied.
+// The pass that finds field settled is only a check and isn't counted
+static int relaxLevel(Heightfield& field, float talus, const Thermal_Erosion_Params& params, JobPool& pool, float& maxExcess) {
+
+    Heightfield scratch(field.width, field.height);
+    std::vector<float> bandExcess;
+    const float k = 0.25f * std::min(1.0f, std::max(0.0f, params.rate));
+
+    int iterations = 0;
+    maxExcess = 0.0f;
+
+    while (iterations < params.maxIterations) {
+
+        maxExcess = relaxPass(field, scratch, talus, k, params.simdTarget, pool, bandExcess);
+
+        // src was already settled, keep it rather than the pass just run
+        if (maxExcess <= params.tolerance * talus) {
+            break;
+        }
+        field.data.swap(scratch.data);
+        iterations++;
+    }
+
+    return iterations;
+}
+
+// 2x2 box filter, an odd last row or column averages with itself
+static Heightfield downsample(const Heightfield& fine, JobPool& pool) {
+
+    Heightfield coarse((fine.width + 1) / 2, (fine.height + 1) / 2);
+
+    forEachBand(pool, coarse.height, [&](int, int rowBegin, int rowEnd) {
+        for (int y = rowBegin; y < rowEnd; y++) {
+
+            const float* row0 = fine.row(2 * y);
+            const float* row1 = fine.row(std::min(fine.height - 1, 2 * y + 1));
+            float* out = coarse.row(y);
+
+            for (int x = 0; x < coarse.width; x++) {
+                int x1 = std::min(fine.width - 1, 2 * x + 1);
+                out[x] = (row0[2 * x] + row0[x1] + row1[2 * x] + row1[x1]) * 0.25f;
+            }
+        }
+    });
+
+    return coarse;
+}
+
+// adds the bilinearly upsampled difference relaxed - original onto fine. The
+// coarse difference sums to zero, but clamped edges and odd sizes weight the
+// coarse texels unevenly once upsampled, so whatever that adds in total is
+// taken back off every texel to keep the height
+static void addCorrection(Heightfield& fine, const Heightfield& relaxed, const Heightfield& original, JobPool& pool) {
+
+    const int coarseWidth = relaxed.width;
+    const int coarseHeight = relaxed.height;
+
+    // fine texel x sits at coarse x / 2 - 0.25 (texel centres)
+    std::vector<int> cellX(fine.width);
+    std::vector<float> weightX(fine.width);
+    for (int x = 0; x < fine.width; x++) {
+        float cx = std::min(std::max(float(x) * 0.5f - 0.25f, 0.0f), float(coarseWidth - 1));
+        cellX[x] = std::min(int(cx), std::max(0, coarseWidth - 2));
+        weightX[x] = coarseWidth > 1 ? cx - float(cellX[x]) : 0.0f;
+    }
+
+    // how much of each coarse column and row ends up in the fine field
+    std::vector<double> totalX(coarseWidth, 0.0);
+    for (int x = 0; x < fine.width; x++) {
+        totalX[cellX[x]] += 1.0 - weightX[x];
+        totalX[std::min(coarseWidth - 1, cellX[x] + 1)] += weightX[x];
+    }
+    std::vector<double> totalY(coarseHeight, 0.0);
+    for (int y = 0; y < fine.height; y++) {
+        float cy = std::min(std::max(float(y) * 0.5f - 0.25f, 0.0f), float(coarseHeight - 1));
+        int y0 = std::min(int(cy), std::max(0, coarseHeight - 2));
+        totalY[y0] += 1.0 - (cy - float(y0));
+        totalY[std::min(coarseHeight - 1, y0 + 1)] += cy - float(y0);
+    }
+
+    double added = 0.0;
+    for (int y = 0; y < coarseHeight; y++) {
+        for (int x = 0; x < coarseWidth; x++) {
+            added += double(relaxed.at(x, y) - original.at(x, y)) * totalX[x] * totalY[y];
+        }
+    }
+    const float drift = float(added / (double(fine.width) * double(fine.height)));
+
+    forEachBand(pool, fine.height, [&](int, int rowBegin, int rowEnd) {
+        for (int y = rowBegin; y < rowEnd; y++) {
+
+            float cy = std::min(std::max(float(y) * 0.5f - 0.25f, 0.0f), float(coarseHeight - 1));
+            int y0 = std::min(int(cy), std::max(0, coarseHeight - 2));
+            int y1 = std::min(coarseHeight - 1, y0 + 1);
+            float ty = cy - float(y0);
+
+            const float* relaxed0 = relaxed.row(y0);
+            const float* relaxed1 = relaxed.row(y1);
+            const float* original0 = original.row(y0);
+            const float* original1 = original.row(y1);
+            float* out = fine.row(y);
+
+            for (int x = 0; x < fine.width; x++) {
+
+                int x0 = cellX[x];
+                int x1 = std::min(coarseWidth - 1, x0 + 1);
+                float tx = weightX[x];
+
+                float bottom = (relaxed0[x0] - original0[x0]) * (1.0f - tx) + (relaxed0[x1] - original0[x1]) * tx;
+                float top = (relaxed1[x0] - original1[x0]) * (1.0f - tx) + (relaxed1[x1] - original1[x1]) * tx;
+                out[x] += bottom * (1.0f - ty) + top * ty - drift;
+            }
+        }
+    });
+}
+
+Thermal_Erosion_Stats erodeThermal(Heightfield& field, const Thermal_Erosion_Params& params, JobPool& pool) {
+
+    Thermal_Erosion_Stats stats = { 1, 0, 0.0f, 0.0f };
+
+    if (field.width < 2 || field.height < 2) {
+        return stats;
+    }
+
+    // height difference between neighbouring texels at the talus angle
+    const float talus = std::tan(params.talusAngle * THERMAL_DEGREES_TO_RADIANS) / params.heightScale;
+    const float fieldArea = float(field.width) * float(field.height);
+    float maxExcess = 0.0f;
+
+    if (params.multigrid) {
+
+        // pyramid[0] is half resolution, each level after that half again
+        std::vector<Heightfield> pyramid;
+        const int minSize = std::max(2, params.coarsestSize);
+
+        while (true) {
+            const Heightfield& finer = pyramid.empty() ? field : pyramid.back();
+            if (finer.width / 2 < minSize || finer.height / 2 < minSize) {
+                break;
+            }
+            pyramid.push_back(downsample(finer, pool));
+        }
+
+        // a coarse texel is 2^level texels wide, so the same angle allows a 2^level larger drop.
+        // Settling coarse levels a little below talus leaves room for the detail
+        // they can't see, otherwise every bump the finer level adds back on a
+        // slope already at talus has to slide all the way down it again
+        const float coarseTalus = talus * params.coarseTalusScale;
+        for (int level = int(pyramid.size()) - 1; level >= 0; level--) {
+
+            Heightfield& coarse = pyramid[level];
+            Heightfield original = coarse;
+
+            int iterations = relaxLevel(coarse, coarseTalus * float(2 << level), params, pool, maxExcess);
+            stats.workIterations += float(iterations) * float(coarse.width) * float(coarse.height) / fieldArea;
+
+            addCorrection(level > 0 ? pyramid[level - 1] : field, coarse, original, pool);
+        }
+
+        stats.levels += int(pyramid.size());
+    }
+
+    stats.fineIterations = relaxLevel(field, talus, params, pool, maxExcess);
+    stats.workIterations += float(stats.fineIterations);
+    stats.maxExcess = maxExcess / talus;
+
+    return stats;
+}
@@ -0,0 +1,115 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "heightfield.hpp"
+#include "job_pool.hpp"
+#include "tile_cache.hpp"
+
+TileCache::TileCache(Noise_Type typeIn, int tileResIn, float texResIn, size_t memoryBudgetIn) {
+
+    type = typeIn;
+    tileRes = tileResIn;
+    texRes = texResIn;
+    memoryBudget = memoryBudgetIn;
+
+    hits = 0;
+    generated = 0;
+    evicted = 0;
+}
+
+int TileCache::request(Tile_Coord min, Tile_Coord max, const Noise& noise, JobPool& pool) {
+
+    std::vector<Tile_Coord> missing;
+
+    // touch everything in range first so it sits ahead of anything evictable
+    for (int y = min.y; y <= max.y; y++) {
+        for (int x = min.x; x <= max.x; x++) {
+
+            auto it = tiles.find({ x, y });
+            if (it == tiles.end()) {
+                missing.push_back({ x, y });
+            } else {
+                touch(it->second);
+                hits++;
+            }
+        }
+    }
+
+    auto inRange = [&](Tile_Coord coord) {
+        return coord.x >= min.x && coord.x <= max.x && coord.y >= min.y && coord.y <= max.y;
+    };
+
+    // evict before allocating so usage never goes over budget for out of range tiles
+    while (!lru.empty() && (tiles.size() + missing.size()) * tileBytes() > memoryBudget && !inRange(lru.back())) {
+        tiles.erase(lru.back());
+        lru.pop_back();
+        evicted++;
+    }
+
+    if (missing.empty()) {
+        return 0;
+    }
+
+    std::vector<Heightfield*> fields;
+    for (Tile_Coord coord : missing) {
+
+        Tile_Entry& entry = tiles[coord];
+        entry.field = std::make_unique<Heightfield>(tileRes, tileRes);
+        lru.push_front(coord);
+        entry.lruPos = lru.begin();
+
+        fields.push_back(entry.field.get());
+    }
+
+    // split each tile into row blocks too, so a single new strip of tiles still fills every core
+    int rowBlocks = (tileRes + HEIGHTFIELD_TILE_SIZE - 1) / HEIGHTFIELD_TILE_SIZE;
+
+    pool.parallelFor(int(missing.size()) * rowBlocks, [&](int job) {
+
+        int tile = job / rowBlocks;
+        int y0 = (job % rowBlocks) * HEIGHTFIELD_TILE_SIZE;
+
+        generateHeightfieldRegion(*fields[tile], noise, type, tileOrigin(missing[tile]), texRes,
+                                  0, y0, tileRes, std::min(HEIGHTFIELD_TILE_SIZE, tileRes - y0));
+    });
+
+    generated += missing.size();
+    return int(missing.size());
+}
+
+const Heightfield* TileCache::find(Tile_Coord coord) {
+
+    auto it = tiles.find(coord);
+    if (it == tiles.end()) {
+        return nullptr;
+    }
+
+    touch(it->second);
+    return it->second.field.get();
+}
+
+void TileCache::clear() {
+
+    tiles.clear();
+    lru.clear();
+
+    hits = 0;
+    generated = 0;
+    evicted = 0;
+}
+
+glm::vec2 TileCache::tileOrigin(Tile_Coord coord) const {
+    return glm::vec2(float(coord.x), float(coord.y)) * float(tileRes) / texRes;
+}
+
+Tile_Coord TileCache::tileAt(glm::vec2 st) const {
+    glm::vec2 tile = glm::floor(st * texRes / float(tileRes));
+    return { int(tile.x), int(tile.y) };
+}
+
+void TileCache::touch(Tile_Entry& entry) {
+    lru.splice(lru.begin(), lru, entry.lruPos);
+}
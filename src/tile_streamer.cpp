@@ -0,0 +1,164 @@
+#include <algorithm>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "normal_map.hpp"
+#include "tile_streamer.hpp"
+
+static int positiveMod(int a, int b) {
+    int m = a % b;
+    return m < 0 ? m + b : m;
+}
+
+// tiles a side of the window, enough for texRes texels wherever it starts
+static int windowTileCount(int tileRes, int texRes) {
+    return (texRes + tileRes - 1) / tileRes + 1;
+}
+
+TileStreamer::TileStreamer(Noise_Type type, int tileRes, int texRes, size_t memoryBudget, const Normal_Map_Params& normalParamsIn)
+    : normalParams(normalParamsIn), cache(type, tileRes, float(texRes), memoryBudget),
+      bounds(windowTileCount(tileRes, texRes) * tileRes, windowTileCount(tileRes, texRes) * tileRes),
+      paddedTile(tileRes + 2, tileRes + 2), paddedNormals(tileRes + 2, tileRes + 2) {
+
+    windowTiles = windowTileCount(tileRes, texRes);
+    texSize = windowTiles * tileRes;
+
+    heightMapOffset = glm::vec2(0.0f);
+    heightMapScale = float(texRes) / float(texSize);
+
+    slots.assign(windowTiles * windowTiles, { 0, 0 });
+    slotValid.assign(windowTiles * windowTiles, false);
+
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, texSize, texSize, 0, GL_RED, GL_FLOAT, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    glGenTextures(1, &normalTexture);
+    glBindTexture(GL_TEXTURE_2D, normalTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, texSize, texSize, 0, GL_RG, GL_FLOAT, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+TileStreamer::~TileStreamer() {
+    glDeleteTextures(1, &texture);
+    glDeleteTextures(1, &normalTexture);
+}
+
+int TileStreamer::update(glm::vec2 posOffset, const Noise& noise, JobPool& pool) {
+
+    Tile_Coord first = cache.tileAt(posOffset);
+    Tile_Coord last = { first.x + windowTiles - 1, first.y + windowTiles - 1 };
+
+    cache.request(first, last, noise, pool);
+
+    int uploaded = 0;
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    for (int y = first.y; y <= last.y; y++) {
+        for (int x = first.x; x <= last.x; x++) {
+
+            int slotX = positiveMod(x, windowTiles);
+            int slotY = positiveMod(y, windowTiles);
+            int slot = slotY * windowTiles + slotX;
+
+            if (slotValid[slot] && slots[slot] == Tile_Coord{ x, y }) {
+                continue;
+            }
+
+            const Heightfield* tile = cache.find({ x, y });
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, slotX * cache.tileRes, slotY * cache.tileRes,
+                            cache.tileRes, cache.tileRes, GL_RED, GL_FLOAT, tile->data.data());
+            bounds.update(*tile, slotX * cache.tileRes, slotY * cache.tileRes, pool);
+
+            padTile({ x, y }, *tile, noise);
+            generateNormalMap(paddedTile, paddedNormals, normalParams, pool);
+
+            // upload the interior, skipping the border
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, paddedNormals.width);
+            glPixelStorei(GL_UNPACK_SKIP_PIXELS, 1);
+            glPixelStorei(GL_UNPACK_SKIP_ROWS, 1);
+            glBindTexture(GL_TEXTURE_2D, normalTexture);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, slotX * cache.tileRes, slotY * cache.tileRes,
+                            cache.tileRes, cache.tileRes, GL_RG, GL_FLOAT, paddedNormals.data.data());
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+            glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+            glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+
+            slots[slot] = { x, y };
+            slotValid[slot] = true;
+            uploaded++;
+        }
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // posOffset in texels, wrapped into the toroidal texture
+    glm::vec2 texel = posOffset * cache.texRes;
+    heightMapOffset = (texel - glm::floor(texel / float(texSize)) * float(texSize)) / float(texSize);
+
+    return uploaded;
+}
+
+void TileStreamer::padTile(Tile_Coord coord, const Heightfield& tile, const Noise& noise) {
+
+    const int res = cache.tileRes;
+    const int worldX = coord.x * res;
+    const int worldY = coord.y * res;
+
+    for (int y = 0; y < res; y++) {
+        std::copy(tile.row(y), tile.row(y) + res, paddedTile.row(y + 1) + 1);
+    }
+
+    // border rows and columns come from the neighbouring tile when it's resident
+    // and are generated otherwise. Only the 4 edge neighbours are read, the
+    // corners of the border are never used by the central differences
+    const Heightfield* below = cache.find({ coord.x, coord.y - 1 });
+    const Heightfield* above = cache.find({ coord.x, coord.y + 1 });
+    const Heightfield* left = cache.find({ coord.x - 1, coord.y });
+    const Heightfield* right = cache.find({ coord.x + 1, coord.y });
+
+    if (below) {
+        std::copy(below->row(res - 1), below->row(res - 1) + res, paddedTile.row(0) + 1);
+    } else {
+        generateRow(paddedTile.row(0) + 1, worldX, worldY - 1, res, noise, cache.type, cache.texRes);
+    }
+
+    if (above) {
+        std::copy(above->row(0), above->row(0) + res, paddedTile.row(res + 1) + 1);
+    } else {
+        generateRow(paddedTile.row(res + 1) + 1, worldX, worldY + res, res, noise, cache.type, cache.texRes);
+    }
+
+    for (int y = 0; y < res; y++) {
+
+        float* row = paddedTile.row(y + 1);
+
+        if (left) {
+            row[0] = left->at(res - 1, y);
+        } else {
+            generateRow(row, worldX - 1, worldY + y, 1, noise, cache.type, cache.texRes);
+        }
+
+        if (right) {
+            row[res + 1] = right->at(0, y);
+        } else {
+            generateRow(row + res + 1, worldX + res, worldY + y, 1, noise, cache.type, cache.texRes);
+        }
+    }
+}
+
+void TileStreamer::invalidate() {
+    cache.clear();
+    slotValid.assign(slotValid.size(), false);
+}
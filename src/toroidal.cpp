@@ -0,0 +1,124 @@
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "heightfield.hpp"
+#include "job_pool.hpp"
+#include "toroidal.hpp"
+
+static int positiveMod(int a, int b) {
+    int m = a % b;
+    return m < 0 ? m + b : m;
+}
+
+// splits world rectangle [worldX, worldX + width) x [worldY, worldY + height)
+// (width, height <= size) at the seams of the ring
+static void addWrappedRect(std::vector<Toroidal_Rect>& rects, int worldX, int worldY, int width, int height, int size) {
+
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+
+    int ringX = positiveMod(worldX, size);
+    int ringY = positiveMod(worldY, size);
+
+    int widths[2] = { std::min(width, size - ringX), 0 };
+    int heights[2] = { std::min(height, size - ringY), 0 };
+    widths[1] = width - widths[0];
+    heights[1] = height - heights[0];
+
+    for (int j = 0; j < 2; j++) {
+        for (int i = 0; i < 2; i++) {
+
+            if (widths[i] == 0 || heights[j] == 0) {
+                continue;
+            }
+
+            Toroidal_Rect rect;
+            rect.x = i == 0 ? ringX : 0;
+            rect.y = j == 0 ? ringY : 0;
+            rect.width = widths[i];
+            rect.height = heights[j];
+            rect.worldX = worldX + (i == 0 ? 0 : widths[0]);
+            rect.worldY = worldY + (j == 0 ? 0 : heights[0]);
+            rects.push_back(rect);
+        }
+    }
+}
+
+std::vector<Toroidal_Rect> toroidalExposedRects(glm::ivec2 oldOrigin, glm::ivec2 newOrigin, int size, bool full) {
+
+    std::vector<Toroidal_Rect> rects;
+    glm::ivec2 delta = newOrigin - oldOrigin;
+
+    if (full || std::abs(delta.x) >= size || std::abs(delta.y) >= size) {
+        addWrappedRect(rects, newOrigin.x, newOrigin.y, size, size, size);
+        return rects;
+    }
+
+    // columns that came in on the left or right, over the whole new height
+    if (delta.x > 0) {
+        addWrappedRect(rects, oldOrigin.x + size, newOrigin.y, delta.x, size, size);
+    } else if (delta.x < 0) {
+        addWrappedRect(rects, newOrigin.x, newOrigin.y, -delta.x, size, size);
+    }
+
+    // rows that came in at the top or bottom, only over the columns not already covered
+    int keptX = std::max(oldOrigin.x, newOrigin.x);
+    int keptWidth = size - std::abs(delta.x);
+
+    if (delta.y > 0) {
+        addWrappedRect(rects, keptX, oldOrigin.y + size, keptWidth, delta.y, size);
+    } else if (delta.y < 0) {
+        addWrappedRect(rects, keptX, newOrigin.y, keptWidth, -delta.y, size);
+    }
+
+    return rects;
+}
+
+ToroidalHeightfield::ToroidalHeightfield(int size) : field(size, size) {
+    origin = glm::ivec2(0);
+    texelOffset = 0.5f;
+    valid = false;
+}
+
+std::vector<Toroidal_Rect> ToroidalHeightfield::scroll(glm::ivec2 newOrigin, const Noise& noise, Noise_Type type, float texRes, JobPool& pool) {
+
+    std::vector<Toroidal_Rect> rects = toroidalExposedRects(origin, newOrigin, field.width, !valid);
+
+    origin = newOrigin;
+    valid = true;
+
+    // one job per block of rows in each rectangle, strips are long and thin so
+    // splitting by rows keeps every core busy even for a one texel scroll
+    struct Row_Job {
+        int rect;
+        int firstRow;
+        int rowCount;
+    };
+
+    std::vector<Row_Job> jobs;
+    for (int r = 0; r < int(rects.size()); r++) {
+        for (int y = 0; y < rects[r].height; y += HEIGHTFIELD_TILE_SIZE) {
+            jobs.push_back({ r, y, std::min(HEIGHTFIELD_TILE_SIZE, rects[r].height - y) });
+        }
+    }
+
+    pool.parallelFor(int(jobs.size()), [&](int j) {
+
+        const Row_Job& job = jobs[j];
+        const Toroidal_Rect& rect = rects[job.rect];
+
+        for (int y = job.firstRow; y < job.firstRow + job.rowCount; y++) {
+            generateRow(field.row(rect.y + y) + rect.x, rect.worldX, rect.worldY + y, rect.width, noise, type, texRes, texelOffset);
+        }
+    });
+
+    return rects;
+}
+
+float ToroidalHeightfield::at(int worldX, int worldY) const {
+    return field.at(positiveMod(worldX, field.width), positiveMod(worldY, field.height));
+}
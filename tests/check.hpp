@@ -0,0 +1,23 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+
+// what the test executables report through: check() prints every condition
+// that doesn't hold and counts it, checkResult() prints the summary and gives
+// main's exit code for ctest
+
+inline int checkFailures = 0;
+
+inline void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cout << "FAILED: " << what << "\n";
+        checkFailures++;
+    }
+}
+
+// "NAME passed" or "NAME failed N checks", 0 only when every check held
+inline int checkResult(const std::string& name) {
+    std::cout << name << (checkFailures ? " failed " + std::to_string(checkFailures) + " checks\n" : " passed\n");
+    return checkFailures ? 1 : 0;
+}
@@ -0,0 +1,70 @@
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+#include "diamond_square.hpp"
+#include "heightfield.hpp"
+#include "job_pool.hpp"
+
+// diamond_square
+// a seed has to give the same field on any thread count, tileable fields have
+// to repeat their first row and column in the last, a different seed has to
+// give a different field and sizes other than 2^n + 1 squares are refused
+
+// several DIAMOND_SQUARE_BLOCKs per side, so levels split into more than one job
+#define DIAMOND_SQUARE_TEST_SIZE 513
+
+static Heightfield generate(const Diamond_Square_Params& params, int threads) {
+    JobPool pool(threads);
+    Heightfield field(DIAMOND_SQUARE_TEST_SIZE, DIAMOND_SQUARE_TEST_SIZE);
+    check(generateDiamondSquare(field, params, pool), "generates " + std::to_string(DIAMOND_SQUARE_TEST_SIZE) + " squared");
+    return field;
+}
+
+int main() {
+
+    Diamond_Square_Params params;
+    params.seed = 1234u;
+
+    const Heightfield reference = generate(params, 1);
+
+    bool finite = true;
+    for (float value : reference.data) {
+        finite = finite && std::isfinite(value);
+    }
+    check(finite, "output is finite");
+
+    for (int threads = 2; threads <= 4; threads++) {
+        check(generate(params, threads).data == reference.data, "same field on " + std::to_string(threads) + " threads");
+    }
+
+    const int last = DIAMOND_SQUARE_TEST_SIZE - 1;
+    bool edgesRepeat = true;
+    for (int i = 0; i < DIAMOND_SQUARE_TEST_SIZE; i++) {
+        edgesRepeat = edgesRepeat && reference.at(i, last) == reference.at(i, 0) && reference.at(last, i) == reference.at(0, i);
+    }
+    check(edgesRepeat, "tileable field repeats its first row and column");
+
+    Diamond_Square_Params reseeded = params;
+    reseeded.seed = params.seed + 1u;
+    check(generate(reseeded, 1).data != reference.data, "another seed gives another field");
+
+    Diamond_Square_Params clamped = params;
+    clamped.tileable = false;
+    Heightfield untiled = generate(clamped, 2);
+    check(untiled.data == generate(clamped, 1).data, "untileable field is the same on any thread count");
+    check(untiled.data != reference.data, "untileable field differs from the tileable one");
+
+    JobPool pool(1);
+    const int invalid[][2] = { { 2, 2 }, { 4, 4 }, { 16, 16 }, { 17, 33 }, { 33, 17 }, { 1, 1 } };
+    for (const auto& size : invalid) {
+        Heightfield field(size[0], size[1]);
+        check(!generateDiamondSquare(field, params, pool),
+              "refuses " + std::to_string(size[0]) + "x" + std::to_string(size[1]));
+    }
+    Heightfield smallest(DIAMOND_SQUARE_MIN_SIZE, DIAMOND_SQUARE_MIN_SIZE);
+    check(generateDiamondSquare(smallest, params, pool), "accepts the smallest size");
+
+    return checkResult("diamond-square");
+}
@@ -0,0 +1,49 @@
+#include <string>
+
+#include "check.hpp"
+#include "droplet_erosion.hpp"
+#include "heightfield.hpp"
+#include "job_pool.hpp"
+#include "noise.hpp"
+
+// droplet_erosion
+// the deterministic schedule has to leave the same heights for a seed on any
+// number of threads. The field is sized so neither side is a multiple of
+// EROSION_TILE_SIZE, so the edge tiles are partial
+
+#define DROPLET_TEST_WIDTH 301
+#define DROPLET_TEST_HEIGHT 257
+#define DROPLET_TEST_DROPLETS 20000
+
+static Heightfield erode(const Heightfield& source, const Erosion_Params& params, int threads) {
+    JobPool pool(threads);
+    Heightfield field = source;
+    erodeDroplets(field, params, pool);
+    return field;
+}
+
+int main() {
+
+    Noise noise;
+    JobPool sourcePool(1);
+    Heightfield source(DROPLET_TEST_WIDTH, DROPLET_TEST_HEIGHT);
+    generateHeightfieldTiled(source, noise, NOISE_RIDGE, glm::vec2(0.0f), 256.0f, sourcePool);
+
+    Erosion_Params params;
+    params.dropletCount = DROPLET_TEST_DROPLETS;
+    params.seed = 1234u;
+    params.deterministic = true;
+
+    const Heightfield reference = erode(source, params, 1);
+    check(reference.data != source.data, "erosion changes the heights");
+
+    for (int threads = 2; threads <= 4; threads++) {
+        check(erode(source, params, threads).data == reference.data, "same heights on " + std::to_string(threads) + " threads");
+    }
+
+    Erosion_Params reseeded = params;
+    reseeded.seed = params.seed + 1u;
+    check(erode(source, reseeded, 2).data != reference.data, "another seed gives other heights");
+
+    return checkResult("droplet erosion");
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "hash.hpp"
+#include "noise.hpp"
+
+// the noisegen variants noise_parity checks the cpu port against, shared with
+// noise_references which renders them. Every noise type on the default hash,
+// the fractals on the simplex basis, and fbm on each of the other integer
+// hashes. HASH_SIN is left out: it scales the last bits of the driver's sin()
+// by 43758, so it only ever matches the GPU it was rendered on
+
+// texels a side of each reference, sampled at TEX_RES = NOISE_REFERENCE_RES so
+// one reference spans a unit of st
+#define NOISE_REFERENCE_RES 64
+// away from the origin, where lattice and cell coordinates go negative
+#define NOISE_REFERENCE_OFFSET glm::vec2(-1.37f, 2.61f)
+// not a multiple of the lattice period, so the gradients are rotated
+#define NOISE_REFERENCE_TIME 0.7f
+#define NOISE_REFERENCE_SEED 12345u
+
+struct Noise_Case {
+    Noise_Type type;
+    Noise_Basis basisType;
+    Hash_Type hashType;
+
+    // file name the reference is stored under, without the extension
+    std::string name() const {
+        return std::string(noiseTypeName(type)) + "_" + noiseBasisName(basisType) + "_" + hashTypeName(hashType);
+    }
+};
+
+inline std::vector<Noise_Case> noiseCases() {
+
+    std::vector<Noise_Case> cases;
+
+    for (int type = 0; type < NOISE_TYPE_COUNT; type++) {
+        cases.push_back({ Noise_Type(type), NOISE_BASIS_PERLIN, HASH_PCG });
+    }
+    for (Noise_Type type : { NOISE_FBM, NOISE_RIDGE, NOISE_TURBULENCE, NOISE_DOMAIN_WARP_FBM }) {
+        cases.push_back({ type, NOISE_BASIS_SIMPLEX, HASH_PCG });
+    }
+    for (Hash_Type hash : { HASH_XXHASH, HASH_PERMUTATION }) {
+        cases.push_back({ NOISE_FBM, NOISE_BASIS_PERLIN, hash });
+    }
+
+    return cases;
+}
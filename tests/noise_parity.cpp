@@ -0,0 +1,92 @@
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "heightfield.hpp"
+#include "noise.hpp"
+#include "noise_cases.hpp"
+
+// noise_parity REFERENCE_DIR
+// generates every noise case with generateHeightfield and compares it with the
+// noisegen.frag render of it in REFERENCE_DIR/<case>.pfm. The port is the same
+// arithmetic as the shader but GPUs are free to fuse and reorder it, so values
+// only have to agree within NOISE_PARITY_TOLERANCE. Fails on any texel past it
+
+// largest difference any texel may have, in the noise's own units (heights span about [0, 1])
+#define NOISE_PARITY_TOLERANCE 1e-3f
+
+// a little endian greyscale PFM of width x height, as HeightmapWriter writes them
+static bool readPfm(const std::string& path, Heightfield& field) {
+
+    std::ifstream file(path, std::ios::binary);
+    std::string magic;
+    int width = 0, height = 0;
+    float scale = 0.0f;
+    file >> magic >> width >> height >> scale;
+    file.get();
+
+    if (!file || magic != "Pf" || width != field.width || height != field.height || scale >= 0.0f) {
+        std::cout << "ERROR::NOISE_PARITY::REFERENCE_NOT_READ\n\t" << path << "\n";
+        return false;
+    }
+
+    // bottom row first, the same as Heightfield
+    file.read(reinterpret_cast<char*>(field.data.data()), std::streamsize(field.data.size() * sizeof(float)));
+    if (!file) {
+        std::cout << "ERROR::NOISE_PARITY::REFERENCE_NOT_READ\n\t" << path << "\n";
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+
+    if (argc != 2) {
+        std::cout << "usage: noise_parity REFERENCE_DIR\n";
+        return -1;
+    }
+
+    const int res = NOISE_REFERENCE_RES;
+    Heightfield reference(res, res);
+    Heightfield field(res, res);
+    int failed = 0;
+
+    for (const Noise_Case& noiseCase : noiseCases()) {
+
+        if (!readPfm(std::string(argv[1]) + "/" + noiseCase.name() + ".pfm", reference)) {
+            failed++;
+            continue;
+        }
+
+        Noise noise(NOISE_REFERENCE_TIME, noiseCase.hashType, NOISE_REFERENCE_SEED);
+        noise.basisType = noiseCase.basisType;
+        generateHeightfield(field, noise, noiseCase.type, NOISE_REFERENCE_OFFSET, float(res));
+
+        float maxError = 0.0f;
+        double sumError = 0.0;
+        int worst = 0;
+        for (size_t i = 0; i < field.data.size(); i++) {
+            float error = std::abs(field.data[i] - reference.data[i]);
+            sumError += error;
+            // NaN compares false, so it's counted as a failure below rather than lost here
+            if (!(error <= maxError)) {
+                maxError = error;
+                worst = int(i);
+            }
+        }
+
+        bool pass = maxError <= NOISE_PARITY_TOLERANCE;
+        failed += pass ? 0 : 1;
+
+        std::printf("%-40s max %.3g mean %.3g%s\n", noiseCase.name().c_str(), maxError, sumError / field.data.size(),
+                    pass ? "" : "\tFAILED");
+        if (!pass) {
+            std::printf("\ttexel (%d, %d): cpu %.9g, shader %.9g\n", worst % res, worst / res, field.data[worst], reference.data[worst]);
+        }
+    }
+
+    std::cout << (failed ? "noise parity failed for " + std::to_string(failed) + " cases\n" : "noise parity passed\n");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,107 @@
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+#include <glad/glad.h>
+
+#include "heightfield.hpp"
+#include "heightmap_export.hpp"
+#include "noise.hpp"
+#include "noise_cases.hpp"
+#include "offscreen_context.hpp"
+#include "shader.hpp"
+
+// noise_references BUILD_DIR OUT_DIR
+// renders every noise case through noisegen.frag off-screen and writes each
+// to OUT_DIR/<case>.pfm, the references noise_parity compares the cpu port
+// against. BUILD_DIR is where CMake copied the shaders to. Checked in
+// references under tests/data/noisegen come from this
+
+int main(int argc, char* argv[]) {
+
+    if (argc != 3) {
+        std::cout << "usage: noise_references BUILD_DIR OUT_DIR\n";
+        return -1;
+    }
+
+    const std::string buildPath = std::string(argv[1]) + "/";
+    const std::string outDir = argv[2];
+
+    OffscreenContext context;
+    if (!context.valid) {
+        return -1;
+    }
+    if (!gladLoadGLLoader((GLADloadproc)OffscreenContext::getProcAddress)) {
+        std::cout << "Failed to initialise GLAD\n";
+        return -1;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(outDir, error);
+    if (error) {
+        std::cout << "ERROR::NOISE_REFERENCES::DIRECTORY_NOT_CREATED\n\t" << outDir << ": " << error.message() << "\n";
+        return -1;
+    }
+
+    const int res = NOISE_REFERENCE_RES;
+
+    unsigned int fbo, texture, vao;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, res, res, 0, GL_RED, GL_FLOAT, NULL);
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "ERROR::FRAMEBUFFER:: Reference framebuffer is not complete!\n";
+        return -1;
+    }
+
+    // a fullscreen quad as two triangles, only positions are read
+    const float quad[12] = { -1.0f, -1.0f, 1.0f, -1.0f, 1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, -1.0f, 1.0f };
+    unsigned int vbo;
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    glViewport(0, 0, res, res);
+    Heightfield field(res, res);
+
+    for (const Noise_Case& noiseCase : noiseCases()) {
+
+        Noise noise(NOISE_REFERENCE_TIME, noiseCase.hashType, NOISE_REFERENCE_SEED);
+
+        // the same variant defines and uniforms main.cpp's selectNoiseGenVariant sets
+        Shader shader(buildPath, "noisegen", { { "NOISE_TYPE",    std::to_string(int(noiseCase.type)) },
+                                               { "NOISE_OCTAVES", std::to_string(NOISE_OCTAVES) },
+                                               { "HASH_TYPE",     std::to_string(int(noiseCase.hashType)) },
+                                               { "NOISE_BASIS",   std::to_string(int(noiseCase.basisType)) } });
+        shader.use();
+        shader.setInt("seed", int(noise.seed));
+        shader.setIntArray("perm", noise.perm, PERM_SIZE);
+        shader.setFloat("TEX_RES", float(res));
+        shader.setFloat("timeOffset", noise.timeOffset);
+        shader.setVec2("gradRotation", noise.gradRotation);
+        shader.setVec2("posOffset", NOISE_REFERENCE_OFFSET);
+        shader.setVec2("texelOffset", glm::vec2(0.0f));
+
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glReadPixels(0, 0, res, res, GL_RED, GL_FLOAT, field.data.data());
+
+        const std::string path = outDir + "/" + noiseCase.name() + ".pfm";
+        if (!exportHeightmap(path, HEIGHTMAP_PFM, field)) {
+            return -1;
+        }
+        glDeleteProgram(shader.ID);
+    }
+
+    std::cout << "wrote " << noiseCases().size() << " references from " << glGetString(GL_RENDERER) << " into " << outDir << "\n";
+    return 0;
+}
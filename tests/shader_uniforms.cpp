@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "check.hpp"
+#include "shader.hpp"
+
+// shader_uniforms
+// points glad's function table at stubs that fake a linked program and count
+// driver calls, then checks Shader looks every uniform location up once when
+// it's built and never again: setting uniforms by location or by name only
+// reaches the driver through glUniform*. Needs no GL context or GPU
+
+struct Stub_Uniform {
+    const char* name;
+    GLint size;
+    GLenum type;
+    GLint location;
+};
+
+// what glGetActiveUniform reports, arrays as "name[0]" like real drivers
+static const Stub_Uniform STUB_UNIFORMS[] = {
+    { "view",              1, GL_FLOAT_MAT4, 3 },
+    { "viewPos",           1, GL_FLOAT_VEC3, 7 },
+    { "amplitude",         1, GL_FLOAT,      11 },
+    { "morphConstants[0]", 8, GL_FLOAT_VEC2, 20 },
+};
+static const int STUB_UNIFORM_COUNT = int(sizeof(STUB_UNIFORMS) / sizeof(STUB_UNIFORMS[0]));
+
+static int getUniformLocationCalls = 0;
+static int getActiveUniformCalls = 0;
+static int uniformCalls = 0;
+static GLint lastUniformLocation = -2;
+
+static GLint APIENTRY stubGetUniformLocation(GLuint, const GLchar* name) {
+    getUniformLocationCalls++;
+    for (const Stub_Uniform& uniform : STUB_UNIFORMS) {
+        if (std::strcmp(uniform.name, name) == 0) {
+            return uniform.location;
+        }
+    }
+    return -1;
+}
+
+static void APIENTRY stubGetActiveUniform(GLuint, GLuint index, GLsizei bufSize, GLsizei* length, GLint* size, GLenum* type, GLchar* name) {
+    getActiveUniformCalls++;
+    const Stub_Uniform& uniform = STUB_UNIFORMS[index];
+    GLsizei written = std::min(GLsizei(std::strlen(uniform.name)), bufSize - 1);
+    std::memcpy(name, uniform.name, size_t(written));
+    name[written] = '\0';
+    *length = written;
+    *size = uniform.size;
+    *type = uniform.type;
+}
+
+static void APIENTRY stubGetProgramiv(GLuint, GLenum pname, GLint* params) {
+    switch (pname) {
+        case GL_ACTIVE_UNIFORMS:           *params = STUB_UNIFORM_COUNT; break;
+        case GL_ACTIVE_UNIFORM_MAX_LENGTH: *params = 32; break;
+        default:                           *params = 1; break;
+    }
+}
+
+static void APIENTRY stubGetShaderiv(GLuint, GLenum, GLint* params) { *params = 1; }
+static const GLubyte* APIENTRY stubGetString(GLenum) { return (const GLubyte*)"stub"; }
+static GLuint APIENTRY stubCreateProgram() { return 1; }
+static GLuint APIENTRY stubCreateShader(GLenum) { return 2; }
+static void APIENTRY stubShaderSource(GLuint, GLsizei, const GLchar* const*, const GLint*) {}
+static void APIENTRY stubShader(GLuint) {}
+static void APIENTRY stubAttachShader(GLuint, GLuint) {}
+
+static void APIENTRY stubUniform1i(GLint location, GLint) { uniformCalls++; lastUniformLocation = location; }
+static void APIENTRY stubUniform1f(GLint location, GLfloat) { uniformCalls++; lastUniformLocation = location; }
+static void APIENTRY stubUniformfv(GLint location, GLsizei, const GLfloat*) { uniformCalls++; lastUniformLocation = location; }
+static void APIENTRY stubUniformMatrixfv(GLint location, GLsizei, GLboolean, const GLfloat*) { uniformCalls++; lastUniformLocation = location; }
+
+static void installStubs() {
+    glad_glGetString = stubGetString;
+    glad_glCreateProgram = stubCreateProgram;
+    glad_glCreateShader = stubCreateShader;
+    glad_glShaderSource = stubShaderSource;
+    glad_glCompileShader = stubShader;
+    glad_glGetShaderiv = stubGetShaderiv;
+    glad_glAttachShader = stubAttachShader;
+    glad_glLinkProgram = stubShader;
+    glad_glGetProgramiv = stubGetProgramiv;
+    glad_glDeleteShader = stubShader;
+    glad_glUseProgram = stubShader;
+    glad_glGetActiveUniform = stubGetActiveUniform;
+    glad_glGetUniformLocation = stubGetUniformLocation;
+    glad_glUniform1i = stubUniform1i;
+    glad_glUniform1f = stubUniform1f;
+    glad_glUniform2fv = stubUniformfv;
+    glad_glUniform3fv = stubUniformfv;
+    glad_glUniformMatrix4fv = stubUniformMatrixfv;
+    // no program binaries, so the cache never asks for them
+    GLAD_GL_ARB_get_program_binary = 0;
+}
+
+int main() {
+
+    installStubs();
+
+    // Shader reads its stages from disk, the stubs ignore what's in them
+    const std::filesystem::path buildPath = std::filesystem::temp_directory_path() / "terrain-gen-shader-uniforms";
+    std::filesystem::create_directories(buildPath / "shaders" / "stub");
+    std::ofstream(buildPath / "shaders" / "stub" / "stub.vert") << "#version 330 core\nvoid main() {}\n";
+    std::ofstream(buildPath / "shaders" / "stub" / "stub.frag") << "#version 330 core\nvoid main() {}\n";
+
+    Shader shader(buildPath.string() + "/", "stub");
+
+    // link time introspection: each active uniform listed and located exactly once
+    check(getActiveUniformCalls == STUB_UNIFORM_COUNT, "glGetActiveUniform once per active uniform at link");
+    check(getUniformLocationCalls == STUB_UNIFORM_COUNT, "glGetUniformLocation once per active uniform at link");
+
+    getUniformLocationCalls = 0;
+    getActiveUniformCalls = 0;
+    uniformCalls = 0;
+
+    const int viewLoc = shader.getUniformLocation("view");
+    const int viewPosLoc = shader.getUniformLocation("viewPos");
+    check(viewLoc == 3 && viewPosLoc == 7, "cached locations are the driver's");
+    check(shader.getUniformLocation("morphConstants") == 20 && shader.getUniformLocation("morphConstants[0]") == 20,
+          "arrays found by plain and [0] name");
+    check(shader.getUniformLocation("missing") == -1, "unknown names are -1");
+
+    const int repeats = 100;
+    const glm::vec2 morphConstants[8] = {};
+    int expectedUniformCalls = 0;
+
+    for (int i = 0; i < repeats; i++) {
+
+        // by location, the per frame path
+        shader.setMat4(viewLoc, glm::mat4(1.0f));
+        shader.setVec3(viewPosLoc, glm::vec3(float(i)));
+        check(lastUniformLocation == viewPosLoc, "set by location passes the location through");
+
+        // by cached name
+        shader.setFloat("amplitude", 10.0f);
+        check(lastUniformLocation == 11, "set by name uses the cached location");
+        shader.setVec2Array("morphConstants", morphConstants, 8);
+        shader.setInt("missing", 1);
+        check(lastUniformLocation == -1, "unknown names set location -1");
+
+        expectedUniformCalls += 5;
+    }
+
+    check(getUniformLocationCalls == 0, "no glGetUniformLocation after link (" + std::to_string(getUniformLocationCalls) + " calls)");
+    check(getActiveUniformCalls == 0, "no glGetActiveUniform after link");
+    check(uniformCalls == expectedUniformCalls, "one glUniform* call per set");
+
+    std::error_code error;
+    std::filesystem::remove_all(buildPath, error);
+
+    return checkResult("shader uniforms");
+}
@@ -0,0 +1,88 @@
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+#include "heightfield.hpp"
+#include "job_pool.hpp"
+#include "noise.hpp"
+#include "simd.hpp"
+#include "thermal_erosion.hpp"
+
+// thermal_erosion
+// relaxes a ridge field and checks that material is only moved (the total
+// height is kept), that every simd target and thread count gives the same
+// heights, and that the multigrid schedule settles to the tolerance in fewer
+// full resolution passes than plain relaxation
+
+#define THERMAL_TEST_WIDTH 513
+#define THERMAL_TEST_HEIGHT 385
+
+// relative change allowed in the summed heights, float rounding of the moves only
+#define THERMAL_TEST_SUM_TOLERANCE 1e-6
+
+static double sum(const Heightfield& field) {
+    double total = 0.0;
+    for (float value : field.data) {
+        total += value;
+    }
+    return total;
+}
+
+int main() {
+
+    Noise noise;
+    JobPool sourcePool(1);
+    Heightfield source(THERMAL_TEST_WIDTH, THERMAL_TEST_HEIGHT);
+    generateHeightfieldTiled(source, noise, NOISE_RIDGE, glm::vec2(0.0f), 256.0f, sourcePool);
+
+    Thermal_Erosion_Params params;
+    params.coarsestSize = 32;
+    params.heightScale = 64.0f;
+
+    // scalar on one thread is the reference the rest have to match
+    Heightfield reference = source;
+    params.simdTarget = SIMD_SCALAR;
+    Thermal_Erosion_Stats multigrid = erodeThermal(reference, params, sourcePool);
+
+    double sourceSum = sum(source);
+    check(std::abs(sum(reference) - sourceSum) <= THERMAL_TEST_SUM_TOLERANCE * std::abs(sourceSum), "total height is kept");
+    check(reference.data != source.data, "relaxation changes the heights");
+    check(multigrid.levels > 1, "multigrid runs more than one level");
+    check(multigrid.maxExcess <= params.tolerance,
+          "multigrid settles to the tolerance (max excess " + std::to_string(multigrid.maxExcess) + ")");
+
+    for (int t = 0; t < SIMD_TARGET_COUNT; t++) {
+
+        if (!simdTargetSupported(Simd_Target(t))) {
+            std::cout << simdTargetName(Simd_Target(t)) << " not supported, skipped\n";
+            continue;
+        }
+
+        for (int threads = 1; threads <= 4; threads++) {
+            JobPool pool(threads);
+            Heightfield field = source;
+            Thermal_Erosion_Params targetParams = params;
+            targetParams.simdTarget = Simd_Target(t);
+            erodeThermal(field, targetParams, pool);
+            check(field.data == reference.data,
+                  std::string(simdTargetName(Simd_Target(t))) + " on " + std::to_string(threads) + " threads matches scalar");
+        }
+    }
+
+    // the same field relaxed without the coarse levels
+    Heightfield naiveField = source;
+    Thermal_Erosion_Params naiveParams = params;
+    naiveParams.multigrid = false;
+    naiveParams.simdTarget = detectSimdTarget();
+    Thermal_Erosion_Stats naive = erodeThermal(naiveField, naiveParams, sourcePool);
+
+    check(naive.levels == 1, "naive relaxation runs one level");
+    check(naive.maxExcess <= params.tolerance, "naive relaxation settles to the tolerance");
+    check(multigrid.fineIterations < naive.fineIterations,
+          "multigrid needs fewer full resolution passes (" + std::to_string(multigrid.fineIterations) + " against " +
+              std::to_string(naive.fineIterations) + ")");
+
+    return checkResult("thermal erosion");
+}